@@ -0,0 +1,153 @@
+// Microbenchmark: per-inference latency of the Mlp/DenseLayer kernels against
+// the previous nested-QVector forward passes of AIEngine and LearningModule,
+// and of the float32/int8 QuantizedMlp with its threshold agreement.
+//
+// Usage: DenseLayerBenchmark [iterations]
+
+#include "DenseLayer.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QTextStream>
+#include <cmath>
+
+namespace {
+
+double legacySigmoid(double x)
+{
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+// Previous network layout: one QVector per layer, row-major, bounds-checked indexing
+struct LegacyMlp {
+    QVector<int> sizes;
+    QVector<QVector<double>> weights;
+    QVector<QVector<double>> biases;
+
+    explicit LegacyMlp(const Mlp &network)
+    {
+        sizes.append(network.inputSize());
+        for (int l = 0; l < network.layerCount(); ++l) {
+            const DenseLayer &layer = network.layer(l);
+            sizes.append(layer.outputCount());
+            weights.append(layer.weightsToVector());
+            QVector<double> bias;
+            for (int i = 0; i < layer.outputCount(); ++i) {
+                bias.append(layer.bias(i));
+            }
+            biases.append(bias);
+        }
+    }
+
+    QVector<double> forward(const QVector<double> &input) const
+    {
+        QVector<double> current = input;
+        for (int l = 0; l < weights.size(); ++l) {
+            const int inputs = sizes[l];
+            QVector<double> next(sizes[l + 1]);
+            for (int i = 0; i < next.size(); ++i) {
+                double sum = biases[l][i];
+                for (int j = 0; j < inputs; ++j) {
+                    sum += weights[l][i * inputs + j] * current[j];
+                }
+                next[i] = legacySigmoid(sum);
+            }
+            current = next;
+        }
+        return current;
+    }
+};
+
+template <typename Function>
+double nanosPerCall(int iterations, Function function)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        function();
+    }
+    return static_cast<double>(timer.nsecsElapsed()) / iterations;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const int iterations = argc > 1 ? QString(argv[1]).toInt() : 100000;
+
+    const QList<QPair<QString, QVector<int>>> shapes = {
+        {"AIEngine 100-50", {100, 50}},
+        {"LearningModule 50-25-10", {50, 25, 10}},
+        {"wide 512-256-64", {512, 256, 64}}
+    };
+
+    out << "kernel: " << DenseLayer::kernelName() << "\n\n";
+    out << "network                   legacy_ns  dense_ns  speedup  max_abs_diff  f32_ns   i8_ns  i8_max_err  i8_agree\n";
+
+    volatile double sink = 0.0;
+    for (const auto &shape : shapes) {
+        Mlp network(shape.second);
+        network.randomize(1.0);
+        const LegacyMlp legacy(network);
+
+        QVector<double> input(network.inputSize());
+        for (double &value : input) {
+            value = QRandomGenerator::global()->generateDouble();
+        }
+
+        const QVector<double> expected = legacy.forward(input);
+        const QVector<double> actual = network.forward(input);
+        double maxDiff = 0.0;
+        for (int i = 0; i < expected.size(); ++i) {
+            maxDiff = qMax(maxDiff, std::abs(expected[i] - actual[i]));
+        }
+
+        const int rounds = qMax(1, iterations * 100 / (shape.second[0] * shape.second[1]));
+        const double legacyNs = nanosPerCall(rounds, [&]() {
+            sink = sink + legacy.forward(input)[0];
+        });
+        const double denseNs = nanosPerCall(rounds, [&]() {
+            sink = sink + network.forward(input)[0];
+        });
+
+        QuantizedMlp float32;
+        float32.build(network, InferencePrecision::Float32);
+        QuantizedMlp int8;
+        int8.build(network, InferencePrecision::Int8);
+        const double floatNs = nanosPerCall(rounds, [&]() {
+            sink = sink + float32.forward(input)[0];
+        });
+        const double int8Ns = nanosPerCall(rounds, [&]() {
+            sink = sink + int8.forward(input)[0];
+        });
+
+        // Parity on random inputs against the thresholds both engines use
+        QVector<QVector<double>> samples;
+        for (int s = 0; s < 256; ++s) {
+            QVector<double> sample(network.inputSize());
+            for (double &value : sample) {
+                value = QRandomGenerator::global()->generateDouble();
+            }
+            samples.append(sample);
+        }
+        const InferenceParity parity = QuantizedMlp::compare(network, int8, samples,
+                                                             {0.3, 0.4, 0.5, 0.6, 0.7, 0.8});
+
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9\n")
+                   .arg(shape.first, -24)
+                   .arg(legacyNs, 10, 'f', 0)
+                   .arg(denseNs, 9, 'f', 0)
+                   .arg(legacyNs / denseNs, 7, 'f', 2)
+                   .arg(maxDiff, 13, 'g', 3)
+                   .arg(floatNs, 7, 'f', 0)
+                   .arg(int8Ns, 7, 'f', 0)
+                   .arg(parity.maxAbsError, 11, 'g', 3)
+                   .arg(parity.thresholdAgreement, 9, 'f', 4);
+    }
+
+    return 0;
+}
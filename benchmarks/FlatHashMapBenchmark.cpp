@@ -0,0 +1,208 @@
+// Benchmark for FlatHashMap against the QMap<QString, double> layout it
+// replaces (and QHash for reference): insert throughput, lookups of present
+// keys, present keys as views into one shared text (how tokens arrive from a
+// TokenList) and misses.
+//
+// Usage: FlatHashMapBenchmark [max_keys]
+// Default checkpoints are 10k, 100k and 1M keys.
+
+#include "FlatHashMap.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QSet>
+#include <QtCore/QTextStream>
+#include <QtCore/QVector>
+#include <algorithm>
+
+namespace {
+
+const int LookupCount = 1000000;
+
+struct KeySet {
+    QVector<QString> keys;           // Distinct, insertion order
+    QVector<QString> misses;         // Never a key (contain a '_')
+    QString text;                    // All keys joined by spaces
+    QVector<QStringView> views;      // keys[i] as a view into text
+};
+
+QString randomKey(QRandomGenerator &random)
+{
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    QString key;
+    const int length = random.bounded(4, 13);
+    for (int i = 0; i < length; ++i) {
+        key += QLatin1Char(letters[random.bounded(26)]);
+    }
+    return key;
+}
+
+KeySet makeKeys(int count)
+{
+    QRandomGenerator random(11);
+    QSet<QString> seen;
+    KeySet set;
+    while (set.keys.size() < count) {
+        const QString key = randomKey(random);
+        if (!seen.contains(key)) {
+            seen.insert(key);
+            set.keys.append(key);
+        }
+    }
+    while (set.misses.size() < LookupCount / 10) {
+        const QString key = randomKey(random) + QLatin1Char('_');
+        set.misses.append(key);
+    }
+
+    QVector<int> starts;
+    for (const QString &key : std::as_const(set.keys)) {
+        starts.append(static_cast<int>(set.text.size()));
+        set.text += key;
+        set.text += QLatin1Char(' ');
+    }
+    for (int i = 0; i < set.keys.size(); ++i) {
+        set.views.append(QStringView(set.text).mid(starts[i], set.keys[i].size()));
+    }
+    return set;
+}
+
+// Lookup order: random positions, fixed per checkpoint
+QVector<int> lookupOrder(int keyCount)
+{
+    QRandomGenerator random(13);
+    QVector<int> order(LookupCount);
+    for (int &index : order) {
+        index = random.bounded(keyCount);
+    }
+    return order;
+}
+
+double nsPerOperation(const QElapsedTimer &timer, int operations)
+{
+    return static_cast<double>(timer.nsecsElapsed()) / operations;
+}
+
+struct Timings {
+    double insertNs = 0.0;
+    double hitNs = 0.0;
+    double viewNs = 0.0;             // Qt containers convert the view to a QString
+    double missNs = 0.0;
+    double checksum = 0.0;           // Keeps the lookups from being optimised away
+};
+
+Timings runFlat(const KeySet &set, const QVector<int> &order)
+{
+    Timings timings;
+    QElapsedTimer timer;
+    FlatHashMap<double> map;
+
+    timer.start();
+    for (int i = 0; i < set.keys.size(); ++i) {
+        map.insert(set.keys[i], i);
+    }
+    timings.insertNs = nsPerOperation(timer, set.keys.size());
+
+    timer.restart();
+    for (int index : order) {
+        timings.checksum += map.value(set.keys[index]);
+    }
+    timings.hitNs = nsPerOperation(timer, order.size());
+
+    timer.restart();
+    for (int index : order) {
+        timings.checksum += map.value(set.views[index]);
+    }
+    timings.viewNs = nsPerOperation(timer, order.size());
+
+    timer.restart();
+    for (const QString &key : set.misses) {
+        timings.checksum += map.value(key, -1.0);
+    }
+    timings.missNs = nsPerOperation(timer, set.misses.size());
+    return timings;
+}
+
+template <typename Map>
+Timings runQt(const KeySet &set, const QVector<int> &order)
+{
+    Timings timings;
+    QElapsedTimer timer;
+    Map map;
+
+    timer.start();
+    for (int i = 0; i < set.keys.size(); ++i) {
+        map.insert(set.keys[i], i);
+    }
+    timings.insertNs = nsPerOperation(timer, set.keys.size());
+
+    timer.restart();
+    for (int index : order) {
+        timings.checksum += map.value(set.keys[index]);
+    }
+    timings.hitNs = nsPerOperation(timer, order.size());
+
+    // No view lookup: the token has to become a QString first
+    timer.restart();
+    for (int index : order) {
+        timings.checksum += map.value(set.views[index].toString());
+    }
+    timings.viewNs = nsPerOperation(timer, order.size());
+
+    timer.restart();
+    for (const QString &key : set.misses) {
+        timings.checksum += map.value(key, -1.0);
+    }
+    timings.missNs = nsPerOperation(timer, set.misses.size());
+    return timings;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QVector<int> checkpoints = {10000, 100000, 1000000};
+    if (argc > 1) {
+        const int limit = QString(argv[1]).toInt();
+        checkpoints.erase(std::remove_if(checkpoints.begin(), checkpoints.end(),
+                                         [limit](int c) { return c > limit; }),
+                          checkpoints.end());
+        if (checkpoints.isEmpty() || checkpoints.last() != limit) {
+            checkpoints.append(limit);
+        }
+    }
+
+    out << "keys       map     insert_ns  hit_ns  view_ns  miss_ns\n";
+
+    for (int checkpoint : checkpoints) {
+        const KeySet set = makeKeys(checkpoint);
+        const QVector<int> order = lookupOrder(checkpoint);
+
+        const QVector<QPair<QString, Timings>> rows = {
+            {"flat", runFlat(set, order)},
+            {"QMap", runQt<QMap<QString, double>>(set, order)},
+            {"QHash", runQt<QHash<QString, double>>(set, order)},
+        };
+
+        const double reference = rows.first().second.checksum;
+        for (const auto &row : rows) {
+            const Timings &t = row.second;
+            out << QString("%1 %2 %3 %4 %5 %6%7\n")
+                       .arg(checkpoint, -10)
+                       .arg(row.first, -7)
+                       .arg(t.insertNs, 9, 'f', 1)
+                       .arg(t.hitNs, 7, 'f', 1)
+                       .arg(t.viewNs, 8, 'f', 1)
+                       .arg(t.missNs, 8, 'f', 1)
+                       .arg(t.checksum == reference ? "" : "  (checksum differs)");
+        }
+        out.flush();
+    }
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Benchmark for FuzzyIndex::search against a linear edit-distance scan over
+// the same folded terms (what a naive typo-tolerant lookup would do), with
+// queries that are known words with diacritics stripped and random typos.
+//
+// Usage: FuzzyIndexBenchmark [max_terms]
+// Default checkpoints are 10k, 100k and 1M terms.
+
+#include "FuzzyIndex.h"
+#include "Tokenizer.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QTextStream>
+#include <algorithm>
+
+namespace {
+
+const int QueryCount = 2000;
+const int ScanQueryCount = 50;
+
+// Slovak-like words: two to five syllables, some with diacritics
+class WordSampler
+{
+public:
+    explicit WordSampler(quint32 seed)
+        : random(seed)
+    {
+    }
+
+    QString word()
+    {
+        static const QStringList onsets = {"k", "m", "p", "r", "s", "t", "v", "z", "č", "š", "ž", "st", "pr", "kr", "dl"};
+        static const QStringList vowels = {"a", "e", "i", "o", "u", "á", "é", "í", "ô", "y"};
+        static const QStringList codas = {"", "", "", "n", "k", "l", "ť", "c"};
+
+        QString result;
+        const int syllables = random.bounded(2, 6);
+        for (int s = 0; s < syllables; ++s) {
+            result += onsets[random.bounded(onsets.size())];
+            result += vowels[random.bounded(vowels.size())];
+            result += codas[random.bounded(codas.size())];
+        }
+        return result;
+    }
+
+    // Diacritics stripped, then up to edits random substitutions, insertions or deletions
+    QString misspell(const QString &word, int edits)
+    {
+        QString result = Tokenizer::fold(word);
+        for (int e = 0; e < edits && !result.isEmpty(); ++e) {
+            const int position = random.bounded(static_cast<int>(result.size()));
+            const QChar letter('a' + random.bounded(26));
+            switch (random.bounded(3)) {
+            case 0:
+                result[position] = letter;
+                break;
+            case 1:
+                result.insert(position, letter);
+                break;
+            default:
+                result.remove(position, 1);
+                break;
+            }
+        }
+        return result;
+    }
+
+    int bounded(int highest) { return random.bounded(highest); }
+
+private:
+    QRandomGenerator random;
+};
+
+QVector<QString> linearScan(const QVector<QString> &folded, const QStringList &terms,
+                            const QString &query, int maxDistance)
+{
+    const QString key = Tokenizer::fold(query);
+    QVector<QString> found;
+    for (int i = 0; i < folded.size(); ++i) {
+        if (FuzzyIndex::distance(key, folded[i]) <= maxDistance) {
+            found.append(terms[i]);
+        }
+    }
+    return found;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QVector<int> checkpoints = {10000, 100000, 1000000};
+    if (argc > 1) {
+        const int limit = QString(argv[1]).toInt();
+        checkpoints.erase(std::remove_if(checkpoints.begin(), checkpoints.end(),
+                                         [limit](int c) { return c > limit; }),
+                          checkpoints.end());
+        if (checkpoints.isEmpty() || checkpoints.last() != limit) {
+            checkpoints.append(limit);
+        }
+    }
+
+    WordSampler sampler(7);
+    FuzzyIndex index;
+    QStringList terms;
+    QVector<QString> folded;
+
+    out << "terms       k  bk_us    visited%  scan_us    agree\n";
+
+    for (int checkpoint : checkpoints) {
+        while (terms.size() < checkpoint) {
+            const QString word = sampler.word();
+            if (index.insert(word)) {
+                terms.append(word);
+                folded.append(Tokenizer::fold(word));
+            }
+        }
+
+        for (int k = 1; k <= 2; ++k) {
+            QStringList queries;
+            for (int q = 0; q < QueryCount; ++q) {
+                queries.append(sampler.misspell(terms[sampler.bounded(terms.size())], sampler.bounded(k + 1)));
+            }
+
+            QVector<QVector<FuzzyMatch>> results;
+            results.reserve(queries.size());
+            FuzzySearchStats stats;
+            QElapsedTimer timer;
+            timer.start();
+            for (const QString &query : std::as_const(queries)) {
+                results.append(index.search(query, k, -1, &stats));
+            }
+            const double bkMicros = timer.nsecsElapsed() / 1000.0 / queries.size();
+            const double visited = 100.0 * stats.nodesVisited / queries.size() / index.nodeCount();
+
+            // The scan is slow, so only a sample of the queries is compared
+            int agreeing = 0;
+            timer.restart();
+            for (int q = 0; q < ScanQueryCount; ++q) {
+                QVector<QString> expected = linearScan(folded, terms, queries[q], k);
+                QVector<QString> actual;
+                for (const FuzzyMatch &match : std::as_const(results[q])) {
+                    actual.append(match.term);
+                }
+                std::sort(expected.begin(), expected.end());
+                std::sort(actual.begin(), actual.end());
+                agreeing += expected == actual ? 1 : 0;
+            }
+            const double scanMicros = timer.nsecsElapsed() / 1000.0 / ScanQueryCount;
+
+            out << QString("%1 %2 %3 %4 %5 %6/%7\n")
+                       .arg(checkpoint, -10)
+                       .arg(k, 2)
+                       .arg(bkMicros, 7, 'f', 1)
+                       .arg(visited, 9, 'f', 2)
+                       .arg(scanMicros, 10, 'f', 1)
+                       .arg(agreeing, 4)
+                       .arg(ScanQueryCount);
+            out.flush();
+        }
+    }
+
+    return 0;
+}
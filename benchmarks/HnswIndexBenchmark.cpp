@@ -0,0 +1,188 @@
+// Benchmark for HnswIndex::search against an exact linear scan over the same
+// hashed interaction embeddings (what findSimilarPatterns and predictOutput
+// did over learningHistory).
+//
+// Usage: HnswIndexBenchmark [max_interactions]
+// Default checkpoints are 10k, 100k and 1M stored interactions; 1M needs
+// about 1.5 GB of memory.
+
+#include "HnswIndex.h"
+#include "FeatureHasher.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QTextStream>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const int VocabularySize = 20000;
+const int QueryCount = 500;
+const int Neighbours = 10;
+const int Dimensions = 256;
+
+// Zipf-distributed synthetic vocabulary, roughly like chat input
+class SentenceSampler
+{
+public:
+    explicit SentenceSampler(quint32 seed)
+        : random(seed)
+    {
+        cdf.resize(VocabularySize);
+        double total = 0.0;
+        for (int i = 0; i < VocabularySize; ++i) {
+            total += 1.0 / (i + 1);
+            cdf[i] = total;
+        }
+        for (double &value : cdf) {
+            value /= total;
+        }
+        for (int i = 0; i < VocabularySize; ++i) {
+            vocabulary.append(QString("slovo%1").arg(i));
+        }
+    }
+
+    QString sample()
+    {
+        QString sentence;
+        const int words = random.bounded(3, 12);
+        for (int w = 0; w < words; ++w) {
+            const double u = random.generateDouble();
+            const int index = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+            sentence += vocabulary[qMin(index, VocabularySize - 1)] + ' ';
+        }
+        return sentence;
+    }
+
+private:
+    QRandomGenerator random;
+    QVector<double> cdf;
+    QStringList vocabulary;
+};
+
+// Stored embeddings for the exact scan, sparse as produced by the featurizer
+struct SparseStore {
+    std::vector<quint32> offsets{0};
+    std::vector<quint32> indices;
+    std::vector<float> values;
+
+    void append(const SparseVector &vector)
+    {
+        for (int k = 0; k < vector.indices.size(); ++k) {
+            indices.push_back(vector.indices[k]);
+            values.push_back(static_cast<float>(vector.values[k]));
+        }
+        offsets.push_back(static_cast<quint32>(indices.size()));
+    }
+
+    quint64 size() const { return offsets.size() - 1; }
+};
+
+// Featurizer output is L2-normalized, so the dot product is the cosine
+QVector<quint64> exactScan(const SparseStore &store, const QVector<float> &query, int k)
+{
+    std::vector<std::pair<float, quint64>> scored;
+    scored.reserve(store.size());
+    for (quint64 i = 0; i < store.size(); ++i) {
+        float similarity = 0.0f;
+        for (quint32 p = store.offsets[i]; p < store.offsets[i + 1]; ++p) {
+            similarity += store.values[p] * query[store.indices[p]];
+        }
+        scored.push_back({similarity, i});
+    }
+    const int top = qMin<int>(k, static_cast<int>(scored.size()));
+    std::partial_sort(scored.begin(), scored.begin() + top, scored.end(),
+                      [](const std::pair<float, quint64> &a, const std::pair<float, quint64> &b) {
+                          return a.first > b.first;
+                      });
+
+    QVector<quint64> keys;
+    for (int i = 0; i < top; ++i) {
+        keys.append(scored[i].second);
+    }
+    return keys;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QVector<qint64> checkpoints = {10000, 100000, 1000000};
+    if (argc > 1) {
+        const qint64 limit = QString(argv[1]).toLongLong();
+        checkpoints.erase(std::remove_if(checkpoints.begin(), checkpoints.end(),
+                                         [limit](qint64 c) { return c > limit; }),
+                          checkpoints.end());
+        if (checkpoints.isEmpty() || checkpoints.last() != limit) {
+            checkpoints.append(limit);
+        }
+    }
+
+    SentenceSampler sampler(42);
+    FeatureHasher featurizer(Dimensions);
+    HnswIndex index(Dimensions);
+    SparseStore store;
+
+    QVector<SparseVector> queries;
+    QVector<QVector<float>> denseQueries;
+    for (int i = 0; i < QueryCount; ++i) {
+        queries.append(featurizer.featurize(sampler.sample()));
+        QVector<float> dense(Dimensions, 0.0f);
+        for (int k = 0; k < queries.last().indices.size(); ++k) {
+            dense[queries.last().indices[k]] = static_cast<float>(queries.last().values[k]);
+        }
+        denseQueries.append(dense);
+    }
+
+    out << "interactions  build_s  hnsw_us  scan_us  recall@" << Neighbours << "\n";
+
+    qint64 learned = 0;
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+
+    for (qint64 checkpoint : checkpoints) {
+        while (learned < checkpoint) {
+            const SparseVector embedding = featurizer.featurize(sampler.sample());
+            index.insert(static_cast<quint64>(learned), embedding);
+            store.append(embedding);
+            learned++;
+        }
+        const double buildSeconds = buildTimer.elapsed() / 1000.0;
+
+        QVector<QVector<NeighbourMatch>> found;
+        found.reserve(queries.size());
+        QElapsedTimer timer;
+        timer.start();
+        for (const SparseVector &query : queries) {
+            found.append(index.search(query, Neighbours));
+        }
+        const double hnswMicros = timer.nsecsElapsed() / 1000.0 / queries.size();
+
+        qint64 hits = 0;
+        qint64 expected = 0;
+        timer.restart();
+        for (int q = 0; q < queries.size(); ++q) {
+            const QVector<quint64> exact = exactScan(store, denseQueries[q], Neighbours);
+            expected += exact.size();
+            for (const NeighbourMatch &match : found[q]) {
+                hits += exact.contains(match.key) ? 1 : 0;
+            }
+        }
+        const double scanMicros = timer.nsecsElapsed() / 1000.0 / queries.size();
+
+        out << QString("%1 %2 %3 %4 %5\n")
+                   .arg(checkpoint, 12)
+                   .arg(buildSeconds, 8, 'f', 2)
+                   .arg(hnswMicros, 8, 'f', 1)
+                   .arg(scanMicros, 8, 'f', 1)
+                   .arg(expected > 0 ? static_cast<double>(hits) / expected : 1.0, 9, 'f', 3);
+        out.flush();
+    }
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+// Benchmark for InvertedIndex::topK against the legacy per-token response scan
+// used by AIEngine::findBestResponse.
+//
+// Usage: InvertedIndexBenchmark [max_interactions]
+// Default checkpoints are 10k, 1M and 10M learned interactions.
+
+#include "InvertedIndex.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QTextStream>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int VocabularySize = 20000;
+const int QueryCount = 2000;
+
+// Zipf-distributed synthetic vocabulary, roughly like chat input
+class TokenSampler
+{
+public:
+    explicit TokenSampler(quint32 seed)
+        : random(seed)
+    {
+        cdf.resize(VocabularySize);
+        double total = 0.0;
+        for (int i = 0; i < VocabularySize; ++i) {
+            total += 1.0 / (i + 1);
+            cdf[i] = total;
+        }
+        for (double &value : cdf) {
+            value /= total;
+        }
+        for (int i = 0; i < VocabularySize; ++i) {
+            vocabulary.append(QString("t%1").arg(i));
+        }
+    }
+
+    QStringList sample(int count)
+    {
+        QStringList tokens;
+        for (int i = 0; i < count; ++i) {
+            const double u = random.generateDouble();
+            const int index = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+            tokens.append(vocabulary[qMin(index, VocabularySize - 1)]);
+        }
+        return tokens;
+    }
+
+    int bounded(int low, int high) { return random.bounded(low, high); }
+
+private:
+    QRandomGenerator random;
+    QVector<double> cdf;
+    QStringList vocabulary;
+};
+
+// What findBestResponse did before the index: visit every stored response of every token
+quint32 legacyScan(const InvertedIndex &index, const QStringList &tokens, qint64 &visited)
+{
+    quint32 best = 0;
+    double bestScore = 0.0;
+    for (const QString &token : tokens) {
+        const PostingList *list = index.postings(token);
+        if (!list) {
+            continue;
+        }
+        for (const Posting &posting : list->postings) {
+            visited++;
+            if (posting.score > bestScore) {
+                bestScore = posting.score;
+                best = posting.docId;
+            }
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QVector<qint64> checkpoints = {10000, 1000000, 10000000};
+    if (argc > 1) {
+        const qint64 limit = QString(argv[1]).toLongLong();
+        checkpoints.erase(std::remove_if(checkpoints.begin(), checkpoints.end(),
+                                         [limit](qint64 c) { return c > limit; }),
+                          checkpoints.end());
+        if (checkpoints.isEmpty() || checkpoints.last() != limit) {
+            checkpoints.append(limit);
+        }
+    }
+
+    TokenSampler sampler(42);
+    QVector<double> confidence(VocabularySize, 0.5);
+    InvertedIndex index;
+
+    QVector<QStringList> queries;
+    for (int i = 0; i < QueryCount; ++i) {
+        queries.append(sampler.sample(sampler.bounded(1, 6)));
+    }
+
+    out << "interactions  postings     build_s  topk_us  scan_us  visited/q(topk)  visited/q(scan)\n";
+
+    qint64 learned = 0;
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+
+    for (qint64 checkpoint : checkpoints) {
+        while (learned < checkpoint) {
+            const QStringList tokens = sampler.sample(sampler.bounded(3, 9));
+            for (const QString &token : tokens) {
+                const int id = token.mid(1).toInt();
+                confidence[id] = qMin(1.0, confidence[id] + 0.1 * sampler.bounded(0, 2));
+                index.addPosting(token, static_cast<quint32>(learned), confidence[id] * (0.5 + 0.5 / tokens.size()));
+            }
+            learned++;
+        }
+        const double buildSeconds = buildTimer.elapsed() / 1000.0;
+
+        SearchStats stats;
+        QElapsedTimer timer;
+        timer.start();
+        for (const QStringList &query : queries) {
+            index.topK(query, 1, &stats);
+        }
+        const double topkMicros = timer.nsecsElapsed() / 1000.0 / queries.size();
+
+        qint64 scanVisited = 0;
+        timer.restart();
+        for (const QStringList &query : queries) {
+            legacyScan(index, query, scanVisited);
+        }
+        const double scanMicros = timer.nsecsElapsed() / 1000.0 / queries.size();
+
+        out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+                   .arg(checkpoint, 12)
+                   .arg(index.postingCount(), 11)
+                   .arg(buildSeconds, 8, 'f', 2)
+                   .arg(topkMicros, 8, 'f', 2)
+                   .arg(scanMicros, 8, 'f', 2)
+                   .arg(static_cast<double>(stats.postingsVisited) / queries.size(), 16, 'f', 1)
+                   .arg(static_cast<double>(scanVisited) / queries.size(), 16, 'f', 1);
+        out.flush();
+    }
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+// Benchmark for MinHashIndex against the exact Jaccard scan findSimilarPatterns
+// used to run over learningHistory. Both pick the best match the same way:
+// MinHash candidates are re-ranked by exact Jaccard like in LearningModule.
+//
+// Half of the queries are stored interactions with one word replaced (near
+// duplicates), half are fresh sentences. Recall counts the queries whose
+// best exact match is above 0.3 (the findSimilarPatterns threshold) and
+// whose MinHash result is equally similar. The scan compares pre-sorted
+// token sets, cheaper than the per-entry QSets it replaces.
+//
+// Usage: MinHashIndexBenchmark [max_interactions] [bands] [rows_per_band]
+// Default checkpoints are 1k, 100k and 1M stored interactions.
+
+#include "MinHashIndex.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QTextStream>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const int VocabularySize = 20000;
+const int QueryCount = 200;
+const int Candidates = 16;           // SimilarCandidates in LearningModule
+const double Threshold = 0.3;
+
+// Zipf-distributed token ids, roughly like chat input
+class SentenceSampler
+{
+public:
+    explicit SentenceSampler(quint32 seed)
+        : random(seed)
+    {
+        cdf.resize(VocabularySize);
+        double total = 0.0;
+        for (int i = 0; i < VocabularySize; ++i) {
+            total += 1.0 / (i + 1);
+            cdf[i] = total;
+        }
+        for (double &value : cdf) {
+            value /= total;
+        }
+    }
+
+    quint32 word()
+    {
+        const double u = random.generateDouble();
+        const int index = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+        return static_cast<quint32>(qMin(index, VocabularySize - 1));
+    }
+
+    QVector<quint32> sentence()
+    {
+        QVector<quint32> tokens;
+        const int words = random.bounded(3, 12);
+        for (int w = 0; w < words; ++w) {
+            tokens.append(word());
+        }
+        return tokens;
+    }
+
+    int bounded(int limit) { return random.bounded(limit); }
+
+private:
+    QRandomGenerator random;
+    QVector<double> cdf;
+};
+
+std::vector<quint32> tokenSet(const QVector<quint32> &tokens)
+{
+    std::vector<quint32> set(tokens.begin(), tokens.end());
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+    return set;
+}
+
+double jaccard(const std::vector<quint32> &a, const std::vector<quint32> &b)
+{
+    size_t i = 0;
+    size_t j = 0;
+    int intersection = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] == b[j]) {
+            intersection++;
+            i++;
+            j++;
+        } else if (a[i] < b[j]) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+    const int unionSize = static_cast<int>(a.size() + b.size()) - intersection;
+    return unionSize > 0 ? static_cast<double>(intersection) / unionSize : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QVector<qint64> checkpoints = {1000, 100000, 1000000};
+    if (argc > 1) {
+        const qint64 limit = QString(argv[1]).toLongLong();
+        checkpoints.erase(std::remove_if(checkpoints.begin(), checkpoints.end(),
+                                         [limit](qint64 c) { return c > limit; }),
+                          checkpoints.end());
+        if (checkpoints.isEmpty() || checkpoints.last() != limit) {
+            checkpoints.append(limit);
+        }
+    }
+    const int bands = argc > 2 ? QString(argv[2]).toInt() : MinHashIndex().bands();
+    const int rows = argc > 3 ? QString(argv[3]).toInt() : MinHashIndex().rowsPerBand();
+
+    SentenceSampler sampler(42);
+    MinHashIndex index(bands, rows);
+    std::vector<std::vector<quint32>> store;
+
+    out << QString("%1 bands x %2 rows, threshold %3\n").arg(bands).arg(rows).arg(index.threshold(), 0, 'f', 3);
+    out << "interactions  build_s  minhash_us  scan_us  recall\n";
+
+    qint64 learned = 0;
+    QElapsedTimer buildTimer;
+    buildTimer.start();
+
+    for (qint64 checkpoint : checkpoints) {
+        while (learned < checkpoint) {
+            const QVector<quint32> tokens = sampler.sentence();
+            index.insert(static_cast<quint64>(learned), tokens);
+            store.push_back(tokenSet(tokens));
+            learned++;
+        }
+        const double buildSeconds = buildTimer.elapsed() / 1000.0;
+
+        QVector<QVector<quint32>> queries;
+        for (int q = 0; q < QueryCount; ++q) {
+            if (q % 2 == 0) {
+                const std::vector<quint32> &stored = store[sampler.bounded(static_cast<int>(store.size()))];
+                QVector<quint32> tokens(stored.begin(), stored.end());
+                tokens[sampler.bounded(static_cast<int>(tokens.size()))] = sampler.word();
+                queries.append(tokens);
+            } else {
+                queries.append(sampler.sentence());
+            }
+        }
+
+        QVector<double> found;
+        QElapsedTimer timer;
+        timer.start();
+        for (const QVector<quint32> &query : queries) {
+            const std::vector<quint32> querySet = tokenSet(query);
+            double best = 0.0;
+            for (const MinHashMatch &match : index.search(query, Candidates)) {
+                best = qMax(best, jaccard(querySet, store[match.key]));
+            }
+            found.append(best);
+        }
+        const double minHashMicros = timer.nsecsElapsed() / 1000.0 / queries.size();
+
+        int hits = 0;
+        int expected = 0;
+        timer.restart();
+        for (int q = 0; q < queries.size(); ++q) {
+            const std::vector<quint32> querySet = tokenSet(queries[q]);
+            double best = 0.0;
+            for (const std::vector<quint32> &stored : store) {
+                best = qMax(best, jaccard(querySet, stored));
+            }
+            if (best > Threshold) {
+                expected++;
+                hits += found[q] >= best ? 1 : 0;
+            }
+        }
+        const double scanMicros = timer.nsecsElapsed() / 1000.0 / queries.size();
+
+        out << QString("%1 %2 %3 %4 %5\n")
+                   .arg(checkpoint, 12)
+                   .arg(buildSeconds, 8, 'f', 2)
+                   .arg(minHashMicros, 11, 'f', 1)
+                   .arg(scanMicros, 8, 'f', 1)
+                   .arg(expected > 0 ? static_cast<double>(hits) / expected : 1.0, 7, 'f', 3);
+        out.flush();
+    }
+
+    return 0;
+}
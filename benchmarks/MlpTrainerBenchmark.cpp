@@ -0,0 +1,209 @@
+// Convergence benchmark for MlpTrainer: wall-clock time and optimizer steps
+// until the training loss of a student network drops below a target, for
+// plain SGD, momentum and Adam, next to the previous LearningModule update
+// (uniform noise scaled by the learning rate, which never converges).
+//
+// The task is a teacher/student regression: a random teacher network of the
+// same shape labels sparse inputs shaped like the hashed message features.
+//
+// Usage: MlpTrainerBenchmark [target_loss] [max_epochs]
+
+#include "MlpTrainer.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QTextStream>
+
+namespace {
+
+const QVector<int> Shape = {256, 64, 32};
+const int SampleCount = 1024;
+const int ActiveFeatures = 12;       // Non-zero inputs per sample
+const int BatchSize = 16;
+
+struct Dataset {
+    QVector<SparseVector> inputs;
+    QVector<QVector<double>> targets;
+};
+
+Dataset makeDataset(QRandomGenerator &random)
+{
+    Mlp teacher(Shape);
+    teacher.randomize(1.0);
+
+    Dataset data;
+    for (int n = 0; n < SampleCount; ++n) {
+        QVector<double> dense(Shape.first(), 0.0);
+        for (int k = 0; k < ActiveFeatures; ++k) {
+            dense[random.bounded(Shape.first())] = random.generateDouble() < 0.5 ? 1.0 : -1.0;
+        }
+        SparseVector input;
+        for (int i = 0; i < dense.size(); ++i) {
+            if (dense[i] != 0.0) {
+                input.indices.append(static_cast<quint32>(i));
+                input.values.append(dense[i]);
+            }
+        }
+        data.targets.append(teacher.forward(input));
+        data.inputs.append(input);
+    }
+    return data;
+}
+
+struct Result {
+    int epochs = 0;
+    qint64 steps = 0;
+    double msec = -1.0;              // Negative when the target was never reached
+    double finalLoss = 0.0;
+    double stepMicros = 0.0;         // Backward passes plus update, per step
+};
+
+double meanLoss(const Mlp &network, const Dataset &data)
+{
+    double sum = 0.0;
+    for (int n = 0; n < data.inputs.size(); ++n) {
+        const QVector<double> output = network.forward(data.inputs[n]);
+        for (int i = 0; i < output.size(); ++i) {
+            const double error = output[i] - data.targets[n][i];
+            sum += 0.5 * error * error;
+        }
+    }
+    return sum / data.inputs.size();
+}
+
+// Same starting weights for every run: uniform in [-1, 1] like LearningModule
+Mlp makeStudent()
+{
+    Mlp student(Shape);
+    QRandomGenerator random(5);
+    for (int l = 0; l < student.layerCount(); ++l) {
+        DenseLayer &layer = student.layer(l);
+        for (int i = 0; i < layer.outputCount(); ++i) {
+            for (int j = 0; j < layer.inputCount(); ++j) {
+                layer.setWeight(i, j, random.generateDouble() * 2.0 - 1.0);
+            }
+            layer.setBias(i, random.generateDouble() * 2.0 - 1.0);
+        }
+    }
+    return student;
+}
+
+// Loss per epoch is the mean the trainer reported for its steps
+Result train(const Dataset &data, const TrainingOptions &options, double learningRate,
+             double targetLoss, int maxEpochs)
+{
+    Mlp student = makeStudent();
+    MlpTrainer trainer(student, options);
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+    for (int epoch = 1; epoch <= maxEpochs; ++epoch) {
+        double lossSum = 0.0;
+        for (int n = 0; n < data.inputs.size(); ++n) {
+            trainer.accumulate(student, data.inputs[n], data.targets[n]);
+            if (trainer.pendingSamples() == BatchSize) {
+                const TrainingStep step = trainer.step(student, learningRate);
+                lossSum += step.loss * step.samples;
+                result.steps = step.step;
+            }
+        }
+        result.epochs = epoch;
+        result.finalLoss = lossSum / data.inputs.size();
+        if (result.finalLoss <= targetLoss) {
+            result.msec = timer.nsecsElapsed() / 1e6;
+            break;
+        }
+    }
+    result.stepMicros = timer.nsecsElapsed() / 1000.0 / qMax<qint64>(1, result.steps);
+    return result;
+}
+
+// The update LearningModule used to apply: the errors were discarded and
+// every weight got noise of +-0.05 * learningRate. The loss is measured
+// with a forward pass over the data after each epoch.
+Result trainNoise(const Dataset &data, double learningRate, double targetLoss, int maxEpochs)
+{
+    Mlp student = makeStudent();
+    QRandomGenerator random(7);
+
+    Result result;
+    QElapsedTimer timer;
+    timer.start();
+    const int stepsPerEpoch = data.inputs.size() / BatchSize;
+    for (int epoch = 1; epoch <= maxEpochs; ++epoch) {
+        for (int s = 0; s < stepsPerEpoch; ++s) {
+            for (int l = 0; l < student.layerCount(); ++l) {
+                DenseLayer &layer = student.layer(l);
+                for (int i = 0; i < layer.outputCount(); ++i) {
+                    double *row = layer.row(i);
+                    for (int j = 0; j < layer.inputCount(); ++j) {
+                        row[j] += (random.generateDouble() - 0.5) * learningRate * 0.1;
+                    }
+                    layer.setBias(i, layer.bias(i) + (random.generateDouble() - 0.5) * learningRate * 0.1);
+                }
+            }
+            result.steps++;
+        }
+        result.epochs = epoch;
+        result.finalLoss = meanLoss(student, data);
+        if (result.finalLoss <= targetLoss) {
+            result.msec = timer.nsecsElapsed() / 1e6;
+            break;
+        }
+    }
+    result.stepMicros = timer.nsecsElapsed() / 1000.0 / qMax<qint64>(1, result.steps);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const double targetLoss = argc > 1 ? QString(argv[1]).toDouble() : 0.02;
+    const int maxEpochs = argc > 2 ? QString(argv[2]).toInt() : 500;
+
+    QRandomGenerator random(3);
+    const Dataset data = makeDataset(random);
+
+    out << QString("Network %1-%2-%3, %4 samples, batch %5, target loss %6, kernel %7\n")
+               .arg(Shape[0]).arg(Shape[1]).arg(Shape[2])
+               .arg(SampleCount).arg(BatchSize).arg(targetLoss)
+               .arg(MlpTrainer::kernelName());
+    out << "optimizer      rate    epochs   steps  step_us  final_loss  time_to_target_ms\n";
+
+    TrainingOptions sgd;
+    sgd.optimizer = TrainingOptimizer::Momentum;
+    sgd.momentum = 0.0;
+    TrainingOptions momentum;
+    momentum.optimizer = TrainingOptimizer::Momentum;
+    TrainingOptions adam;
+
+    struct Run {
+        QString name;
+        double rate;
+        Result result;
+    };
+    const QVector<Run> runs = {
+        {"noise (old)", 0.01, trainNoise(data, 0.01, targetLoss, maxEpochs)},
+        {"sgd", 1.0, train(data, sgd, 1.0, targetLoss, maxEpochs)},
+        {"momentum", 0.1, train(data, momentum, 0.1, targetLoss, maxEpochs)},
+        {"adam", 0.003, train(data, adam, 0.003, targetLoss, maxEpochs)},
+    };
+
+    for (const Run &run : runs) {
+        out << QString("%1 %2 %3 %4 %5 %6 %7\n")
+                   .arg(run.name, -12)
+                   .arg(run.rate, 6, 'f', 3)
+                   .arg(run.result.epochs, 8)
+                   .arg(run.result.steps, 7)
+                   .arg(run.result.stepMicros, 8, 'f', 1)
+                   .arg(run.result.finalLoss, 11, 'f', 5)
+                   .arg(run.result.msec < 0 ? QString("not reached") : QString::number(run.result.msec, 'f', 1), 18);
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Microbenchmark: Tokenizer::tokenize / normalize against the previous
+// toLower() + QRegularExpression("\\W+") split and regex-based preprocessing.
+//
+// Usage: TokenizerBenchmark [iterations]
+
+#include "Tokenizer.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QTextStream>
+
+namespace {
+
+const QStringList Corpus = {
+    "Ahoj, ako sa máš?",
+    "Vytvor hello world program v C++",
+    "Napíš Python funkciu pre triedenie zoznamu čísel",
+    "Čau! Potrebujem kalkulačku, ktorá vie sčítať, odčítať, násobiť a deliť.",
+    "What is the difference between a class and a struct in C++?",
+    "Prečo mi nefunguje kompilácia? Dostávam chybu: undefined reference to `main'",
+    "Generuj JavaScript triedu pre používateľa s menom, e-mailom a heslom",
+    "Ďakujem za pomoc, veľmi si mi pomohol s týmto kódom!"
+};
+
+QStringList legacyTokenize(const QString &text)
+{
+    return text.toLower().split(QRegularExpression("\\W+"), Qt::SkipEmptyParts);
+}
+
+QString legacyPreprocess(const QString &text)
+{
+    QString processed = text.toLower();
+    processed.remove(QRegularExpression("[^\\w\\s\\?\\!\\.]"));
+    return processed.simplified();
+}
+
+template <typename Function>
+double nanosPerCall(int iterations, const QStringList &inputs, Function function)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        for (const QString &input : inputs) {
+            function(input);
+        }
+    }
+    return static_cast<double>(timer.nsecsElapsed()) / (static_cast<double>(iterations) * inputs.size());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const int iterations = argc > 1 ? QString(argv[1]).toInt() : 20000;
+
+    // Short chat messages and one long pasted document
+    QString longText;
+    for (int i = 0; i < 200; ++i) {
+        longText += Corpus[i % Corpus.size()] + ' ';
+    }
+    const QStringList longInputs = {longText};
+
+    volatile qsizetype sink = 0;
+
+    out << "input        legacy_split_ns  tokenize_ns  legacy_preprocess_ns  normalize_ns\n";
+    const QList<QPair<QString, QStringList>> suites = {
+        {"short", Corpus},
+        {"long", longInputs}
+    };
+    for (const auto &suite : suites) {
+        const int rounds = suite.first == "long" ? qMax(1, iterations / 100) : iterations;
+        const double legacySplit = nanosPerCall(rounds, suite.second, [&](const QString &text) {
+            sink = sink + legacyTokenize(text).size();
+        });
+        const double tokenize = nanosPerCall(rounds, suite.second, [&](const QString &text) {
+            sink = sink + Tokenizer::tokenize(text).size();
+        });
+        const double legacyNormalize = nanosPerCall(rounds, suite.second, [&](const QString &text) {
+            sink = sink + legacyPreprocess(text).size();
+        });
+        const double normalize = nanosPerCall(rounds, suite.second, [&](const QString &text) {
+            sink = sink + Tokenizer::normalize(text).size();
+        });
+
+        out << QString("%1 %2 %3 %4 %5\n")
+                   .arg(suite.first, -8)
+                   .arg(legacySplit, 20, 'f', 0)
+                   .arg(tokenize, 12, 'f', 0)
+                   .arg(legacyNormalize, 21, 'f', 0)
+                   .arg(normalize, 13, 'f', 0);
+    }
+
+    // The regex split treats Slovak diacritics as separators; show the difference
+    out << "\ntokens differing from the legacy split (diacritics):\n";
+    for (const QString &input : Corpus) {
+        const QStringList legacy = legacyTokenize(input);
+        const QStringList current = Tokenizer::tokenize(input).toStringList();
+        if (legacy != current) {
+            out << "  " << input << "\n    legacy: " << legacy.join('|')
+                << "\n    new:    " << current.join('|') << "\n";
+        }
+    }
+
+    return 0;
+}
@@ -8,25 +8,65 @@
 #include <QtCore/QVector>
 #include <QtCore/QTimer>
 #include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QFuture>
+#include <QtCore/QMutex>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSet>
+#include <QtCore/QBitArray>
 #include <memory>
 
+#include "InvertedIndex.h"
+#include "FuzzyIndex.h"
+#include "FlatHashMap.h"
+#include "ConversationStore.h"
+#include "Tokenizer.h"
+#include "IntentMatcher.h"
+#include "DenseLayer.h"
+#include "FeatureHasher.h"
+#include "ResponseCache.h"
+#include "KnowledgeJournal.h"
+#include "ResponseStore.h"
+#include "AnalyzedMessage.h"
+#include "ResponseOrchestrator.h"
+
 class NetworkManager;
 class LearningModule;
 
-struct ConversationContext {
-    QStringList messages;
-    QStringList responses;
-    QString currentTopic;
-    int contextLength;
-};
-
 struct KnowledgeBase {
     QMap<QString, QString> facts;
-    QMap<QString, QStringList> patterns;
-    QMap<QString, double> confidence;
+    FuzzyIndex factKeys;             // Typo-tolerant lookup of facts by topic
+    InvertedIndex patterns;          // Input token -> learned response ids
+    FuzzyIndex vocabulary;           // Pattern tokens and intent keywords, for spelling correction
+    ResponseStore responses;         // Learned response text, stored once per distinct text
+    FlatHashMap<double> confidence;  // Input token -> confidence, read per message
     QStringList codeExamples;
 };
 
+// Session-independent analysis of one message plus the learned-response
+// lookup: computed on the request path, or speculatively while the user is
+// still typing
+struct PreparedInput {
+    std::shared_ptr<const AnalyzedMessage> message;
+    bool retrieved = false;          // learnedResponse looked up
+    quint64 generation = 0;          // responseCache generation seen by the lookup
+    QString learnedResponse;         // Best stored response, empty if none
+};
+
+struct SpeculationStats {
+    quint64 started = 0;
+    quint64 reused = 0;              // Submitted text matched the prepared draft
+    quint64 refreshed = 0;           // Reused, but the knowledge changed and retrieval ran again
+    quint64 discarded = 0;           // Superseded by a newer draft or a different message
+};
+
+// One encoded interaction waiting for a training batch
+struct TrainingSample {
+    SparseVector input;
+    QVector<double> target;
+};
+
 class AIEngine : public QObject
 {
     Q_OBJECT
@@ -36,25 +76,90 @@ public:
     ~AIEngine();
     
     void initialize();
-    void processMessage(const QString &message);
+    // Returns the request id used by the streaming signals, 0 if the queue is full
+    quint64 processMessage(const QString &message, const QString &sessionId = QString());
+    QFuture<QString> submitMessage(const QString &message, const QString &sessionId = QString(),
+                                   quint64 *requestId = nullptr);
+    // Stops a queued or streaming response; responseCancelled follows
+    void cancelResponse(quint64 requestId);
+    // Chunk size of local and search answers; a remote answer is passed on as it arrives
+    void setStreamChunkSize(int characters);
+    void setMaxPendingRequests(int limit);
+    int pendingRequestCount() const;
+    
+    // Speculative analysis of a draft (tokens, intents, features, learned
+    // response lookup) on a background thread. Call from the GUI thread on
+    // debounced edits; a message submitted with the same text skips that work,
+    // any other text just drops it.
+    void prepareMessage(const QString &draft);
+    SpeculationStats speculationStats() const;
+    // Per-stage runs, reuses and time of the newest request's message; the
+    // learning module's reuses are counted in once it has learned from it
+    QVector<AnalyzedMessage::StageTiming> lastAnalysisTimings() const;
+    QString lastAnalysisReport() const;         // AnalyzedMessage::timingReport()
     void setNetworkManager(NetworkManager *manager);
+    
+    // Latency budget per request (from submission) within which web search
+    // and the remote model may beat a low-confidence local answer; 0 answers
+    // locally only. Sources that keep missing the budget are skipped.
+    void setResponseBudget(int msec);
+    int responseBudget() const;
+    SourceStats responseSourceStats(ResponseSource source) const;
+    // Estimated tokens of history and prompt sent to the remote model
+    void setRemoteContextBudget(int tokens);
+    int remoteContextBudget() const;
     void setLearningModule(LearningModule *module);
     
     // Learning methods
     void learnFromInteraction(const QString &input, const QString &output);
+    
+    // Network training runs in mini-batches on a background thread. A batch is
+    // started once batchSize samples are buffered; a partial batch is flushed
+    // every flush interval (0 disables the timer). Call from the GUI thread.
+    void setTrainingBatchSize(int size);
+    int trainingBatchSize() const;
+    void setTrainingFlushInterval(int msec);
+    int pendingTrainingSamples() const;
+    void flushTraining();
+    void waitForTraining();
+    
+    // Opt-in float32/int8 inference. The reduced network is rebuilt from the
+    // live weights after every batch and checked against them on calibration
+    // inputs; when the response thresholds disagree the engine goes back to
+    // double precision (setInferencePrecision returns false).
+    bool setInferencePrecision(InferencePrecision precision);
+    InferencePrecision inferencePrecision() const;
+    InferenceParity inferenceParity() const;
     void updateKnowledgeBase(const QString &topic, const QString &information);
-    QString generateResponse(const QString &input);
+    QString generateResponse(const QString &input, const QString &sessionId = QString());
+    
+    // Cache of generated responses keyed by normalized input and session context
+    ResponseCacheStats responseCacheStats() const;
+    void setResponseCacheCapacity(int capacity);
+    
+    // Memory cap of the learned responses; rarely learned ones are evicted first
+    void setResponseMemoryLimit(qint64 bytes);
+    qint64 responseMemoryUsage() const;
     
     // Code generation
     QString generateCode(const QString &description, const QString &language = "cpp");
     bool validateCode(const QString &code, const QString &language);
     
-    // Context management
-    void addToContext(const QString &message, const QString &response);
-    void clearContext();
-    QString getContextSummary();
+    // Context management (an empty session id is the default conversation)
+    void addToContext(const QString &message, const QString &response,
+                      const QString &sessionId = QString());
+    void clearContext(const QString &sessionId = QString());
+    void clearAllContexts();
+    QString getContextSummary(const QString &sessionId = QString());
+    ConversationStore &conversationStore();
 
 signals:
+    // Per request: responseStarted, responseChunk with sequence 0, 1, ... and
+    // then either responseFinished (followed by responseReady) or responseCancelled
+    void responseStarted(quint64 requestId);
+    void responseChunk(quint64 requestId, int sequence, const QString &chunk);
+    void responseFinished(quint64 requestId, const QString &response);
+    void responseCancelled(quint64 requestId);
     void responseReady(const QString &response);
     void learningProgressUpdated(int progress);
     void statusChanged(const QString &status);
@@ -67,37 +172,108 @@ private slots:
 
 private:
     void initializeKnowledgeBase();
+    // Persistence: every mutation is journaled and saveKnowledgeBase() compacts
+    // the journal into a snapshot. Everything below except saveKnowledgeBase()
+    // expects the caller to hold knowledgeLock for writing.
     void saveKnowledgeBase();
-    void loadKnowledgeBase();
+    bool loadKnowledgeBase();
+    bool migrateLegacyKnowledgeBase();
+    QByteArray snapshotKnowledgeBase() const;
+    bool restoreKnowledgeBase(const QByteArray &snapshot);
+    void journalMutation(JournalRecord::Type type, const QStringList &fields);
+    
+    // Knowledge base mutations shared by the live path and journal replay
+    void applyInteraction(const QString &response, const QStringList &inputTokens);
+    void applyFact(const QString &topic, const QString &information);
+    void applyCodeExample(const QString &code);
+    void rebuildFuzzyIndexes();
     
-    QString analyzeInput(const QString &input);
-    QString findBestResponse(const QString &input);
+    // *streamed: the answer already went out as responseChunk
+    QString processRequest(quint64 requestId, const QString &message, const QString &sessionId,
+                           bool *streamed);
+    quint64 registerRequest();
+    bool isCancelled(quint64 requestId) const;
+    void finishStream(quint64 requestId);
+    bool streamResponse(quint64 requestId, const QString &response);
+    PreparedInput prepareInput(const QString &message, quint64 speculationTicket = 0);
+    PreparedInput takePreparedInput(const QString &message);
+    void retrieveLearnedResponse(PreparedInput *prepared);
+    QString generateResponse(const PreparedInput &prepared, const QString &sessionId);
+    QString composeResponse(const PreparedInput &prepared, QStringList *dependencies, bool *cacheable);
+    quint64 contextFingerprint(const QString &sessionId);
+    QString analyzeInput(const QBitArray &intents);
+    QString findBestResponse(const QStringList &tokens);
+    QString fuzzyResponse(const AnalyzedMessage &message, QStringList *dependencies);
     double calculateConfidence(const QString &input, const QString &response);
     
-    QStringList tokenize(const QString &text);
+    TokenList tokenize(const QString &text);
     QString preprocessText(const QString &text);
     
     NetworkManager *networkManager;
     LearningModule *learningModule;
+    ResponseOrchestrator *orchestrator;      // Races local, search and remote answers
     
-    ConversationContext context;
+    ConversationStore conversations;
     KnowledgeBase knowledgeBase;
+    ResponseCache responseCache;
+    std::unique_ptr<KnowledgeJournal> knowledgeJournal;
     
     QTimer *learningTimer;
-    QString currentQuery;
-    bool isProcessing;
+    
+    // Request pipeline: bounded number of pending requests served by a worker pool
+    QThreadPool *workerPool;
+    QAtomicInt pendingRequests;
+    int maxPendingRequests;
+    
+    // Streaming: request ids and cancellation requests
+    QAtomicInteger<quint64> requestCounter;
+    QAtomicInt streamChunkSize;
+    QAtomicInt remoteContextTokens;
+    mutable QMutex streamMutex;
+    QSet<quint64> activeRequests;
+    QSet<quint64> cancelledRequests;
+    
+    // Speculative analysis: only the newest draft is kept, older jobs bail out
+    QThreadPool *speculationPool;
+    QAtomicInteger<quint64> speculationTicket;
+    mutable QMutex speculationMutex;
+    std::shared_ptr<PreparedInput> speculation;
+    SpeculationStats speculationCounters;
+    
+    // Newest analysed request message, for lastAnalysisTimings()
+    mutable QMutex analysisMutex;
+    std::shared_ptr<const AnalyzedMessage> lastAnalysis;
+    
+    // Guards knowledgeBase and the network weights
+    mutable QReadWriteLock knowledgeLock;
+    
+    // Mini-batch training: samples are buffered and trained on a single thread
+    QThreadPool *trainingPool;
+    QTimer *trainingFlushTimer;
+    mutable QMutex trainingMutex;
+    QVector<TrainingSample> trainingBuffer;
+    int batchSize;
+    double trainingRate;
     
     // Neural network simulation (simplified)
-    QVector<QVector<double>> weights;
-    QVector<double> biases;
+    Mlp network;
+    QuantizedMlp reducedNetwork;             // Used instead of network unless empty
+    InferencePrecision requestedPrecision;
+    InferenceParity lastParity;
     int inputSize;
     int hiddenSize;
     int outputSize;
+    FeatureHasher featurizer;                // Text -> sparse network input
+    FeatureHasher targetFeaturizer;          // Text -> training target
+    QAtomicInteger<quint64> networkVersion;  // Bumped whenever forwardPass results change
     
     void initializeNeuralNetwork();
-    QVector<double> forwardPass(const QVector<double> &input);
-    void backpropagate(const QVector<double> &input, const QVector<double> &target);
-    double sigmoid(double x);
+    QVector<double> forwardPass(const SparseVector &input);
+    QVector<double> networkOutput(const AnalyzedMessage &message);
+    InferenceParity buildReducedNetwork(InferencePrecision precision, QuantizedMlp *result) const;
+    void queueTrainingSample(const TrainingSample &sample);
+    void startTrainingBatchLocked();
+    void trainBatch(const QVector<TrainingSample> &batch);
     double sigmoidDerivative(double x);
 };
 
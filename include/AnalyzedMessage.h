@@ -0,0 +1,89 @@
+#ifndef ANALYZEDMESSAGE_H
+#define ANALYZEDMESSAGE_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QBitArray>
+#include <QtCore/QVector>
+#include <QtCore/QMutex>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "Tokenizer.h"
+#include "DenseLayer.h"
+#include "FeatureHasher.h"
+
+// One user message, analysed at most once per stage and shared by every step
+// of the request pipeline (speculative draft, AIEngine, LearningModule).
+//
+// Accessors compute their stage on first use and return the stored result
+// afterwards, so the object looks immutable and can be shared between
+// threads. Every stage counts its runs, the reuses of a stored result and
+// the time spent; AIEngine::lastAnalysisReport() shows for the newest request
+// whether some consumer still repeats work.
+class AnalyzedMessage
+{
+public:
+    enum Stage {
+        NormalizeStage,
+        TokenizeStage,
+        IntentStage,
+        FeatureStage,
+        NetworkStage,
+        StageCount
+    };
+
+    struct StageTiming {
+        int runs = 0;
+        int reuses = 0;
+        qint64 nsecs = 0;    // Spent in runs only
+    };
+
+    static std::shared_ptr<const AnalyzedMessage> create(const QString &text);
+
+    const QString &text() const { return original; }
+    const QString &normalizedText() const;      // Tokenizer::normalize
+    const TokenList &tokens() const;            // Tokens of the normalized text
+    const QStringList &tokenStrings() const;
+    const QVector<quint32> &tokenIds() const;   // Stable 32-bit token hashes, in token order
+    const QBitArray &intents() const;           // IntentMatcher::shared() on the normalized text
+    bool hasIntent(int intent) const;
+
+    // Hashed features, once per featurizer configuration
+    SparseVector features(const FeatureHasher &hasher) const;
+
+    // Network output over this message, once per owner and weights version.
+    // compute runs outside the internal lock and may take the owner's locks.
+    QVector<double> networkOutput(const void *owner, quint64 version,
+                                  const std::function<QVector<double>()> &compute) const;
+
+    QVector<StageTiming> timings() const;
+    QString timingReport() const;
+    static QString stageName(Stage stage);
+
+private:
+    explicit AnalyzedMessage(const QString &text);
+
+    void record(Stage stage, bool ran, qint64 nsecs) const;
+
+    const QString original;
+
+    mutable std::once_flag normalizeOnce;
+    mutable std::once_flag tokenizeOnce;
+    mutable std::once_flag intentOnce;
+    mutable QString normalized;
+    mutable TokenList tokenList;
+    mutable QStringList tokenStringList;
+    mutable QVector<quint32> tokenIdList;
+    mutable QBitArray intentBits;
+
+    mutable QMutex mutex;  // Guards the maps and the timings
+    mutable std::map<std::tuple<int, int, int>, SparseVector> featureSets;
+    mutable std::map<const void *, std::pair<quint64, QVector<double>>> networkOutputs;
+    mutable StageTiming stageTimings[StageCount];
+};
+
+#endif // ANALYZEDMESSAGE_H
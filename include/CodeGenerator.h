@@ -8,6 +8,8 @@
 #include <QtCore/QVector>
 #include <QtCore/QRegularExpression>
 
+#include "FlatHashMap.h"
+
 struct CodeTemplate {
     QString language;
     QString pattern;
@@ -97,7 +99,7 @@ private:
     // Learning data
     QMap<QString, QStringList> learnedPatterns;
     QMap<QString, QString> codeExamples;
-    QMap<QString, double> patternConfidence;
+    FlatHashMap<double> patternConfidence;
     
     int learningProgress;
 };
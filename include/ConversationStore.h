@@ -0,0 +1,97 @@
+#ifndef CONVERSATIONSTORE_H
+#define CONVERSATIONSTORE_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <list>
+
+struct ConversationTurn {
+    QString message;
+    QString response;
+};
+
+// Conversation history for a remote model, assembled within a token budget:
+// the newest turns verbatim, older ones as one-line gists
+struct ConversationContext {
+    QStringList gists;                   // Oldest first
+    QVector<ConversationTurn> turns;     // Oldest first
+    int tokens = 0;                      // Estimated size of gists and turns
+    int omittedTurns = 0;                // Older turns that did not fit at all
+
+    bool isEmpty() const { return gists.isEmpty() && turns.isEmpty(); }
+    // The gists as one system message, empty when there are none
+    QString systemPrompt() const;
+};
+
+// Conversation context for many independent sessions.
+//
+// Each session keeps its last turns in a fixed-capacity ring buffer, so adding
+// a turn never shifts or reallocates. Sessions are kept in LRU order and the
+// least recently used one is evicted once maxSessions is exceeded.
+// Token estimates and gists are computed once per turn; turns that leave the
+// ring stay available to context() as gists, up to a fixed number.
+// All methods are thread-safe.
+class ConversationStore
+{
+public:
+    explicit ConversationStore(int turnsPerSession = 10, int maxSessions = 256);
+
+    void addTurn(const QString &sessionId, const QString &message, const QString &response);
+    QString summary(const QString &sessionId);
+    QVector<ConversationTurn> turns(const QString &sessionId);
+    // Newest turns that fit into tokenBudget, preceded by gists of older ones
+    ConversationContext context(const QString &sessionId, int tokenBudget);
+
+    // Rough token count of text sent to a remote model
+    static int estimateTokens(const QString &text);
+
+    QString currentTopic(const QString &sessionId);
+    void setCurrentTopic(const QString &sessionId, const QString &topic);
+
+    void clear(const QString &sessionId);
+    void clearAll();
+    int evictIdle(qint64 maxIdleMs);
+
+    void setTurnsPerSession(int count);
+    void setMaxSessions(int limit);
+    int sessionCount() const;
+
+private:
+    struct Gist {
+        QString text;
+        int tokens = 0;
+    };
+
+    struct StoredTurn {
+        ConversationTurn turn;
+        int tokens = 0;                  // Both messages, with per-message overhead
+        Gist gist;
+    };
+
+    struct Session {
+        QVector<StoredTurn> ring;
+        int head = 0;   // Index of the oldest turn
+        int size = 0;
+        QVector<Gist> digest;            // Gists of turns that left the ring, oldest first
+        int droppedTurns = 0;            // Turns that left the digest too
+        QString currentTopic;
+        qint64 lastAccess = 0;
+        std::list<QString>::iterator lruPosition;
+    };
+
+    Session &touch(const QString &sessionId);
+    void evictOverflow();
+    static StoredTurn storeTurn(const QString &message, const QString &response);
+    static void retire(Session &session, const StoredTurn &turn);
+
+    mutable QMutex mutex;
+    QHash<QString, Session> sessions;
+    std::list<QString> lru; // Most recently used first
+    int turnsPerSession;
+    int maxSessions;
+};
+
+#endif // CONVERSATIONSTORE_H
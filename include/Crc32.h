@@ -0,0 +1,10 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <QtCore/QByteArray>
+
+// CRC-32 (IEEE 802.3, reflected, as in zlib) of the frames in the knowledge
+// journal and the interaction history segments
+quint32 crc32(const QByteArray &data);
+
+#endif // CRC32_H
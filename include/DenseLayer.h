@@ -0,0 +1,220 @@
+#ifndef DENSELAYER_H
+#define DENSELAYER_H
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Allocator for SIMD-friendly buffers (cache-line aligned)
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T *pointer, std::size_t)
+    {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+using AlignedDoubles = std::vector<double, AlignedAllocator<double>>;
+using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+
+// Sparse input: ascending, unique indices and their values
+struct SparseVector {
+    QVector<quint32> indices;
+    QVector<double> values;
+
+    int nonZeroCount() const { return indices.size(); }
+    bool isEmpty() const { return indices.isEmpty(); }
+
+    // Indices at or beyond width are dropped
+    QVector<double> toDense(int width) const
+    {
+        QVector<double> dense(width, 0.0);
+        for (int k = 0; k < indices.size(); ++k) {
+            if (indices[k] < static_cast<quint32>(width)) {
+                dense[indices[k]] = values[k];
+            }
+        }
+        return dense;
+    }
+};
+
+// Fully connected layer: output = activation(W * input + bias).
+//
+// W is stored row-major in one aligned buffer; every row is padded with zeros
+// to a multiple of 8 doubles so that the GEMV kernels never need a scalar
+// tail. The kernel (AVX-512, AVX2+FMA or scalar) is picked once at startup
+// from the CPU features.
+class DenseLayer
+{
+public:
+    enum Activation {
+        Linear,
+        Sigmoid
+    };
+
+    DenseLayer();
+    DenseLayer(int inputs, int outputs);
+
+    int inputCount() const { return inputs; }
+    int outputCount() const { return outputs; }
+    // Row length in doubles, including padding
+    int stride() const { return rowStride; }
+
+    double *row(int i) { return weights.data() + static_cast<std::size_t>(i) * rowStride; }
+    const double *row(int i) const { return weights.data() + static_cast<std::size_t>(i) * rowStride; }
+    double weight(int row, int column) const { return this->row(row)[column]; }
+    void setWeight(int row, int column, double value) { this->row(row)[column] = value; }
+
+    double *biasData() { return biases.data(); }
+    const double *biasData() const { return biases.data(); }
+    double bias(int i) const { return biases[i]; }
+    void setBias(int i, double value) { biases[i] = value; }
+
+    // Uniform values in [-range, range]
+    void randomize(double range);
+
+    // Row-major weights without padding (the persisted format)
+    QVector<double> weightsToVector() const;
+    bool setWeightsFromVector(const QVector<double> &values);
+
+    // input: 64-byte aligned, stride() doubles with zero padding; output: outputCount()
+    void forward(const double *input, double *output, Activation activation) const;
+    // Sparse input: costs outputCount() x non-zeros, indices >= inputCount() are ignored
+    void forwardSparse(const SparseVector &input, double *output, Activation activation) const;
+    // W += factors * input^T, touching only the columns of the non-zero inputs
+    void addOuterProduct(const double *factors, const SparseVector &input);
+
+    // In-place logistic function
+    static void sigmoid(double *values, int count);
+    // "avx512", "avx2" or "scalar"
+    static QString kernelName();
+
+private:
+    int inputs;
+    int outputs;
+    int rowStride;
+    AlignedDoubles weights;
+    AlignedDoubles biases;
+};
+
+// Stack of sigmoid dense layers
+class Mlp
+{
+public:
+    Mlp() = default;
+    // Sizes of all layers including the input, e.g. {100, 50} or {50, 25, 10}
+    explicit Mlp(const QVector<int> &layerSizes);
+
+    void resize(const QVector<int> &layerSizes);
+    void randomize(double range);
+
+    int layerCount() const { return layers.size(); }
+    DenseLayer &layer(int i) { return layers[i]; }
+    const DenseLayer &layer(int i) const { return layers[i]; }
+
+    int inputSize() const { return layers.isEmpty() ? 0 : layers.first().inputCount(); }
+    int outputSize() const { return layers.isEmpty() ? 0 : layers.last().outputCount(); }
+
+    // Missing inputs are treated as zero, extra inputs are ignored.
+    // When activations is given it receives the output of every layer.
+    QVector<double> forward(const QVector<double> &input, QVector<QVector<double>> *activations = nullptr) const;
+    // The first layer runs the sparse kernel, the rest are dense
+    QVector<double> forward(const SparseVector &input, QVector<QVector<double>> *activations = nullptr) const;
+
+private:
+    QVector<double> forwardFrom(int firstLayer, QVector<double> input,
+                                QVector<QVector<double>> *activations) const;
+
+    QVector<DenseLayer> layers;
+};
+
+enum class InferencePrecision {
+    Double,
+    Float32,
+    Int8
+};
+
+// Agreement between a reduced-precision network and its double reference
+struct InferenceParity {
+    // Below this fraction of agreeing threshold decisions the mode is refused
+    static constexpr double RequiredAgreement = 0.99;
+
+    int samples = 0;
+    double maxAbsError = 0.0;
+    double meanAbsError = 0.0;
+    double thresholdAgreement = 1.0; // Outputs on the same side of every threshold
+
+    bool passed() const { return thresholdAgreement >= RequiredAgreement; }
+};
+
+// Read-only reduced-precision copy of an Mlp, for inference only.
+//
+// Float32 halves the weight bytes and doubles the SIMD width. Int8 stores
+// every row as symmetric 8-bit values with its own scale, calibrated from
+// the largest magnitude in that row of the live weights, and rounded so
+// that the row keeps its sum. Activations are quantized per call to 16 bits
+// (as far as the 32-bit sums cannot overflow) and accumulated exactly in
+// 32-bit integers. Biases and the sigmoid stay in double in both modes.
+// Rebuild after the source weights change.
+class QuantizedMlp
+{
+public:
+    QuantizedMlp() = default;
+
+    void build(const Mlp &source, InferencePrecision precision);
+    void clear();
+
+    bool isEmpty() const { return layers.isEmpty(); }
+    InferencePrecision precision() const { return mode; }
+    int inputSize() const { return layers.isEmpty() ? 0 : layers.first().inputs; }
+    int outputSize() const { return layers.isEmpty() ? 0 : layers.last().outputs; }
+    qint64 weightBytes() const;
+
+    // Same contract as Mlp::forward
+    QVector<double> forward(const QVector<double> &input, QVector<QVector<double>> *activations = nullptr) const;
+
+    // Runs both networks over samples; every output is bucketed by thresholds
+    static InferenceParity compare(const Mlp &reference, const QuantizedMlp &candidate,
+                                   const QVector<QVector<double>> &samples,
+                                   const QVector<double> &thresholds);
+
+private:
+    struct Layer {
+        int inputs = 0;
+        int outputs = 0;
+        int stride = 0;
+        AlignedFloats weights;                                // Float32
+        std::vector<qint8, AlignedAllocator<qint8>> values;   // Int8
+        QVector<double> scales;                               // Int8, per row
+        int activationMax = 0;                                // Int8: quantized input range
+        QVector<double> biases;
+    };
+
+    InferencePrecision mode = InferencePrecision::Double;
+    QVector<Layer> layers;
+};
+
+#endif // DENSELAYER_H
@@ -0,0 +1,53 @@
+#ifndef FEATUREHASHER_H
+#define FEATUREHASHER_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringView>
+#include <QtCore/QVector>
+#include <QtCore/QPair>
+
+#include "DenseLayer.h"
+#include "Tokenizer.h"
+
+// Text featurizer shared by AIEngine and LearningModule (the hashing trick).
+//
+// Every token and every character n-gram of "<token>" (the brackets mark the
+// word boundaries) is hashed into one of dimensions() slots. Any vocabulary
+// fits the fixed network input width, and unseen or misspelled words still
+// share n-grams with known ones. The vector is L2-normalized and holds only
+// the slots that were hit, so it feeds the sparse DenseLayer kernels.
+//
+// Signed mode multiplies every feature by a hash-derived +-1 so that
+// collisions cancel out on average; Unsigned keeps all values in [0, 1]
+// (sigmoid targets). Hashes are fixed across runs and Qt versions, so
+// persisted weights stay valid.
+class FeatureHasher
+{
+public:
+    enum Mode {
+        Signed,
+        Unsigned
+    };
+
+    explicit FeatureHasher(int dimensions = 1024, Mode mode = Signed, int ngramLength = 3);
+
+    int dimensions() const { return width; }
+    Mode hashingMode() const { return mode; }
+    int ngramSize() const { return ngramLength; }
+
+    SparseVector featurize(QStringView text) const;
+    SparseVector featurize(const TokenList &tokens) const;
+
+    // Dense features of pseudo-random words (fixed seed), for calibrating and
+    // checking reduced-precision networks
+    QVector<QVector<double>> calibrationSamples(int count) const;
+
+private:
+    void addFeature(QStringView feature, quint64 seed, QVector<QPair<quint32, double>> *features) const;
+
+    int width;
+    Mode mode;
+    int ngramLength;
+};
+
+#endif // FEATUREHASHER_H
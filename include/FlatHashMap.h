@@ -0,0 +1,262 @@
+#ifndef FLATHASHMAP_H
+#define FLATHASHMAP_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QStringView>
+#include <QtCore/QHashFunctions>
+#include <QtCore/QMap>
+#include <QtCore/QDataStream>
+#include <vector>
+#include <utility>
+
+// Open-addressing hash map from QString to V for the hot string-keyed tables.
+//
+// Entries live in one dense array in insertion order; the probe table holds
+// only a 32-bit hash and an entry index per slot, so a lookup touches one or
+// two cache lines of slots and then the entry itself. Linear probing with
+// backward-shift deletion, no tombstones; the table is kept at most 3/4 full.
+//
+// Lookups take QStringView, so tokens (TokenList views) and string literals
+// are looked up without building a QString. Iteration runs over the dense
+// entries: insertion order, except that remove() moves the last entry into
+// the removed one's place. Pointers and references are invalidated by any
+// insert or remove.
+template <typename V>
+class FlatHashMap
+{
+public:
+    struct Entry {
+        QString key;
+        V value;
+    };
+
+    using const_iterator = typename std::vector<Entry>::const_iterator;
+
+    FlatHashMap() = default;
+
+    int size() const { return static_cast<int>(entries.size()); }
+    bool isEmpty() const { return entries.empty(); }
+
+    void reserve(int count)
+    {
+        entries.reserve(count);
+        std::size_t capacity = MinimumCapacity;
+        while (capacity * 3 < static_cast<std::size_t>(count) * 4) {
+            capacity *= 2;
+        }
+        if (capacity > slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    void clear()
+    {
+        entries.clear();
+        slots.clear();
+    }
+
+    bool contains(QStringView key) const { return findEntry(key, hashOf(key)) >= 0; }
+
+    const V *find(QStringView key) const
+    {
+        const int index = findEntry(key, hashOf(key));
+        return index >= 0 ? &entries[index].value : nullptr;
+    }
+
+    V *find(QStringView key)
+    {
+        const int index = findEntry(key, hashOf(key));
+        return index >= 0 ? &entries[index].value : nullptr;
+    }
+
+    V value(QStringView key, const V &defaultValue = V()) const
+    {
+        const V *found = find(key);
+        return found ? *found : defaultValue;
+    }
+
+    // Inserts a default-constructed value if the key is missing
+    V &operator[](QStringView key)
+    {
+        const quint32 hash = hashOf(key);
+        const int index = findEntry(key, hash);
+        if (index >= 0) {
+            return entries[index].value;
+        }
+        return emplaceNew(key.toString(), hash, V());
+    }
+
+    V &insert(const QString &key, const V &value)
+    {
+        const quint32 hash = hashOf(key);
+        const int index = findEntry(key, hash);
+        if (index >= 0) {
+            entries[index].value = value;
+            return entries[index].value;
+        }
+        return emplaceNew(key, hash, value);
+    }
+
+    bool remove(QStringView key)
+    {
+        const quint32 hash = hashOf(key);
+        const std::size_t slot = findSlot(key, hash);
+        if (slot == NotFound) {
+            return false;
+        }
+
+        const quint32 index = slots[slot].entry - 1;
+        eraseSlot(slot);
+
+        // Keep the entries dense: the last one moves into the gap
+        const quint32 last = static_cast<quint32>(entries.size() - 1);
+        if (index != last) {
+            const std::size_t lastSlot = findSlot(entries[last].key, hashOf(entries[last].key));
+            slots[lastSlot].entry = index + 1;
+            entries[index] = std::move(entries[last]);
+        }
+        entries.pop_back();
+        return true;
+    }
+
+    const_iterator begin() const { return entries.cbegin(); }
+    const_iterator end() const { return entries.cend(); }
+
+    QStringList keys() const
+    {
+        QStringList result;
+        result.reserve(size());
+        for (const Entry &entry : entries) {
+            result.append(entry.key);
+        }
+        return result;
+    }
+
+    // Sorted by key, e.g. for reports and persistence
+    QMap<QString, V> toMap() const
+    {
+        QMap<QString, V> result;
+        for (const Entry &entry : entries) {
+            result.insert(entry.key, entry.value);
+        }
+        return result;
+    }
+
+private:
+    struct Slot {
+        quint32 hash = 0;
+        quint32 entry = 0;   // Entry index + 1, 0 when the slot is empty
+    };
+
+    static constexpr std::size_t MinimumCapacity = 16;
+    static constexpr std::size_t NotFound = static_cast<std::size_t>(-1);
+
+    static quint32 hashOf(QStringView key)
+    {
+        const std::size_t hash = qHash(key, 0);
+        return static_cast<quint32>(hash ^ (static_cast<quint64>(hash) >> 32));
+    }
+
+    std::size_t findSlot(QStringView key, quint32 hash) const
+    {
+        if (slots.empty()) {
+            return NotFound;
+        }
+        const std::size_t mask = slots.size() - 1;
+        for (std::size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+            const Slot &current = slots[slot];
+            if (current.entry == 0) {
+                return NotFound;
+            }
+            if (current.hash == hash && entries[current.entry - 1].key == key) {
+                return slot;
+            }
+        }
+    }
+
+    int findEntry(QStringView key, quint32 hash) const
+    {
+        const std::size_t slot = findSlot(key, hash);
+        return slot == NotFound ? -1 : static_cast<int>(slots[slot].entry - 1);
+    }
+
+    V &emplaceNew(QString key, quint32 hash, V value)
+    {
+        if ((entries.size() + 1) * 4 > slots.size() * 3) {
+            rehash(slots.empty() ? MinimumCapacity : slots.size() * 2);
+        }
+        entries.push_back({std::move(key), std::move(value)});
+        placeSlot(hash, static_cast<quint32>(entries.size()));
+        return entries.back().value;
+    }
+
+    void placeSlot(quint32 hash, quint32 entry)
+    {
+        const std::size_t mask = slots.size() - 1;
+        std::size_t slot = hash & mask;
+        while (slots[slot].entry != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = {hash, entry};
+    }
+
+    void eraseSlot(std::size_t hole)
+    {
+        // Backward shift: pull later members of the probe run into the hole
+        // unless their home slot lies cyclically in (hole, next]
+        const std::size_t mask = slots.size() - 1;
+        std::size_t next = hole;
+        for (;;) {
+            next = (next + 1) & mask;
+            if (slots[next].entry == 0) {
+                break;
+            }
+            const std::size_t home = slots[next].hash & mask;
+            const bool stays = hole <= next ? (hole < home && home <= next)
+                                            : (hole < home || home <= next);
+            if (!stays) {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole] = Slot();
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(capacity, Slot());
+        for (const Slot &slot : old) {
+            if (slot.entry != 0) {
+                placeSlot(slot.hash, slot.entry);
+            }
+        }
+    }
+
+    std::vector<Entry> entries;
+    std::vector<Slot> slots;         // Size is zero or a power of two
+};
+
+// Same stream layout as QMap<QString, V>, so data written from a QMap stays readable
+template <typename V>
+QDataStream &operator<<(QDataStream &out, const FlatHashMap<V> &map)
+{
+    return out << map.toMap();
+}
+
+template <typename V>
+QDataStream &operator>>(QDataStream &in, FlatHashMap<V> &map)
+{
+    QMap<QString, V> sorted;
+    in >> sorted;
+    map.clear();
+    map.reserve(sorted.size());
+    for (auto it = sorted.cbegin(); it != sorted.cend(); ++it) {
+        map.insert(it.key(), it.value());
+    }
+    return in;
+}
+
+#endif // FLATHASHMAP_H
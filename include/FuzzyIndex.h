@@ -0,0 +1,62 @@
+#ifndef FUZZYINDEX_H
+#define FUZZYINDEX_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QStringView>
+#include <QtCore/QVector>
+#include <QtCore/QSet>
+
+struct FuzzyMatch {
+    QString term;       // As inserted
+    int distance;       // Edit distance between the folded forms
+};
+
+struct FuzzySearchStats {
+    qint64 nodesVisited = 0;
+};
+
+// Typo-tolerant term lookup: a BK-tree over Levenshtein distance.
+//
+// Terms are compared in folded form (Tokenizer::fold: lowercase, diacritics
+// stripped), so "cau" finds "čau" at distance 0 and "kalkulacka" finds
+// "kalkulačka". Every node stores one folded key with the terms that fold to
+// it; children hang off their distance to the parent, and a search only
+// descends into children whose edge is within maxDistance of the query's
+// distance to the node (triangle inequality). For small maxDistance that is
+// a small fraction of the tree. Terms are only ever added; clear() resets.
+class FuzzyIndex
+{
+public:
+    // Returns false if the term was already present
+    bool insert(const QString &term);
+    bool contains(const QString &term) const;
+
+    // Terms within maxDistance, nearest first (ties by term); at most limit
+    // results unless limit is negative
+    QVector<FuzzyMatch> search(QStringView query, int maxDistance, int limit = -1,
+                               FuzzySearchStats *stats = nullptr) const;
+
+    int size() const { return terms.size(); }
+    int nodeCount() const { return nodes.size(); }
+    void clear();
+
+    static int distance(QStringView a, QStringView b);
+
+private:
+    struct Edge {
+        int distance;
+        int node;
+    };
+
+    struct Node {
+        QString key;                 // Folded
+        QStringList terms;
+        QVector<Edge> children;
+    };
+
+    QVector<Node> nodes;             // nodes[0] is the root
+    QSet<QString> terms;
+};
+
+#endif // FUZZYINDEX_H
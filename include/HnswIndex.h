@@ -0,0 +1,105 @@
+#ifndef HNSWINDEX_H
+#define HNSWINDEX_H
+
+#include <QtCore/QString>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QRandomGenerator>
+#include <vector>
+
+#include "DenseLayer.h"
+
+struct NeighbourMatch {
+    quint64 key;
+    float similarity;    // Cosine similarity, 1 is identical
+};
+
+// Approximate nearest-neighbour index (HNSW, Malkov & Yashunin).
+//
+// Vectors are L2-normalized on insert and compared by dot product. Every
+// vector is a node in a hierarchy of proximity graphs: level 0 links all
+// nodes, each higher level a random, exponentially thinner subset. A search
+// descends greedily from the top level and widens to searchWidth candidates
+// on level 0, so its cost grows roughly with log(size) instead of size.
+//
+// remove() only marks the node: it keeps routing searches but is never
+// returned. Once deleted nodes outnumber live ones the graph is rebuilt from
+// the live vectors. Not thread-safe, not even search() (it reuses a visit
+// buffer).
+class HnswIndex
+{
+public:
+    explicit HnswIndex(int dimensions = 256, int neighbours = 16, int buildWidth = 128);
+
+    int dimensions() const { return width; }
+
+    // An existing key is replaced; zero vectors are rejected
+    bool insert(quint64 key, const QVector<float> &vector);
+    bool insert(quint64 key, const SparseVector &vector);
+    bool remove(quint64 key);
+    bool contains(quint64 key) const;
+
+    // Up to k live matches, most similar first
+    QVector<NeighbourMatch> search(const QVector<float> &query, int k, int searchWidth = 64) const;
+    QVector<NeighbourMatch> search(const SparseVector &query, int k, int searchWidth = 64) const;
+
+    QVector<quint64> keys() const;
+    int size() const { return nodeByKey.size(); }
+    int deletedCount() const { return deleted; }
+    bool isEmpty() const { return nodeByKey.isEmpty(); }
+    void compact();
+    void clear();
+
+    // Binary graph file written with QSaveFile; load() replaces the whole index
+    bool save(const QString &filePath, QString *error = nullptr) const;
+    bool load(const QString &filePath, QString *error = nullptr);
+
+private:
+    struct Candidate {
+        float similarity;
+        quint32 node;
+    };
+
+    struct Node {
+        quint64 key;
+        int level;
+        bool deleted;
+        QVector<QVector<quint32>> upperLinks;   // Levels 1..level
+    };
+
+    const float *vectorOf(quint32 node) const { return vectors.data() + static_cast<size_t>(node) * width; }
+    float similarity(const float *query, quint32 node) const;
+    int maxLinks(int level) const { return level == 0 ? 2 * neighbours : neighbours; }
+    int linkCount(quint32 node, int level) const;
+    const quint32 *links(quint32 node, int level) const;
+    void setLinks(quint32 node, int level, const QVector<quint32> &nodes);
+
+    QVector<float> normalized(const QVector<float> &vector) const;
+    QVector<float> densify(const SparseVector &vector) const;
+    void insertNormalized(quint64 key, const QVector<float> &vector);
+    void connect(quint32 node, int level);
+    quint32 greedyClosest(const float *query, quint32 entry, int fromLevel, int toLevel) const;
+    QVector<Candidate> searchLevel(const float *query, const QVector<quint32> &entries,
+                                   int searchWidth, int level, bool liveOnly) const;
+    QVector<quint32> selectNeighbours(const QVector<Candidate> &candidates, int count) const;
+    int randomLevel();
+
+    int width;
+    int neighbours;                 // Links per node above level 0 (twice that on level 0)
+    int buildWidth;                 // Candidate list size while linking a new node
+    double levelFactor;
+
+    std::vector<float> vectors;     // Node vectors back to back
+    std::vector<quint32> baseLinks; // Level 0: per node a count followed by maxLinks(0) slots
+    std::vector<Node> nodes;
+    QHash<quint64, quint32> nodeByKey;  // Live nodes only
+    int deleted;
+    quint32 entryPoint;
+    int topLevel;                   // -1 while empty
+    QRandomGenerator levelRandom;
+
+    mutable std::vector<quint32> visitMarks;
+    mutable quint32 visitEpoch;
+};
+
+#endif // HNSWINDEX_H
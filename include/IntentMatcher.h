@@ -0,0 +1,104 @@
+#ifndef INTENTMATCHER_H
+#define INTENTMATCHER_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QStringView>
+#include <QtCore/QVector>
+#include <QtCore/QHash>
+#include <QtCore/QBitArray>
+#include <QtCore/QReadWriteLock>
+
+// Multi-pattern intent classifier.
+//
+// All keyword sets are compiled into one Aho-Corasick automaton (dense
+// transition table over a compressed alphabet), so classifying an input is a
+// single linear scan regardless of how many keywords are registered.
+// Matching is case-insensitive; word boundaries use Tokenizer's definition of
+// a word character.
+//
+// Patterns added at runtime go into a small delta automaton that is rebuilt on
+// its own; it is folded into the main automaton once it grows past a
+// threshold. Replaced patterns are retired in place until that merge.
+// All methods are thread-safe.
+class IntentMatcher
+{
+public:
+    enum MatchMode {
+        Substring,  // Anywhere in the text
+        WholeWord,  // Bounded by non-word characters on both sides
+        WordPrefix  // Starts at a word boundary ("program" matches "programovanie")
+    };
+
+    // Intents registered by shared(), in this order
+    enum BuiltinIntent {
+        GreetingIntent = 0,
+        ProgrammingIntent,
+        CodeRequestIntent,
+        QuestionIntent,
+        GratitudeIntent,
+        HelpIntent,
+        BuiltinIntentCount
+    };
+
+    explicit IntentMatcher(bool withBuiltinIntents = false);
+
+    // Matcher with the built-in Slovak/English keyword sets
+    static IntentMatcher &shared();
+
+    int registerIntent(const QString &name);
+    int intentId(const QString &name) const;
+    QString intentName(int id) const;
+    int intentCount() const;
+
+    void addPattern(int intentId, const QString &pattern, MatchMode mode = WholeWord);
+    void addPatterns(int intentId, const QStringList &patterns, MatchMode mode = WholeWord);
+    void setPatterns(int intentId, const QStringList &patterns, MatchMode mode = WholeWord);
+    void clearPatterns(int intentId);
+    // Active patterns of an intent, lowercased
+    QStringList patterns(int intentId) const;
+    void compile();
+
+    // Bit i is set when intent i matched
+    QBitArray match(QStringView text) const;
+    bool matches(QStringView text, int intentId) const;
+
+private:
+    struct Pattern {
+        QString text;
+        int intentId;
+        MatchMode mode;
+    };
+
+    struct Automaton {
+        QVector<int> asciiClasses;        // Character class of ASCII units
+        QHash<char16_t, int> charClasses; // Character class of other units
+        int alphabetSize = 1;             // Class 0: not used by any pattern
+        QVector<int> transitions;         // state * alphabetSize + class
+        QVector<int> firstPattern;        // Per state: first pattern ending here
+        QVector<int> nextPattern;         // Per pattern: next pattern at the same state
+        QVector<int> outputLink;          // Per state: nearest suffix state with patterns
+    };
+
+    static Automaton build(const QVector<Pattern> &patterns);
+    void scan(const Automaton &automaton, const QVector<Pattern> &patterns,
+              const QVector<bool> *retired, QStringView text, QBitArray &result) const;
+    void installBuiltinIntents();
+    void retireIntent(int intentId);
+    void appendDelta(int intentId, const QStringList &patterns, MatchMode mode);
+    void mergeLocked();
+
+    mutable QReadWriteLock lock;
+    QStringList intentNames;
+
+    QVector<Pattern> mainPatterns;
+    QVector<bool> mainRetired;
+    int retiredCount;
+    Automaton mainAutomaton;
+
+    QVector<Pattern> deltaPatterns;
+    Automaton deltaAutomaton;
+    int mergeThreshold;
+};
+
+#endif // INTENTMATCHER_H
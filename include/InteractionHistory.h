@@ -0,0 +1,103 @@
+#ifndef INTERACTIONHISTORY_H
+#define INTERACTIONHISTORY_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QFile>
+#include <functional>
+#include <vector>
+
+struct LearningData {
+    quint64 id;                  // Key in the interaction index, increasing
+    QString input;
+    QString output;
+    QString context;
+    double reward;
+    qint64 timestamp;
+    QString category;
+};
+
+// Interaction history of LearningModule: the newest interactions in memory,
+// older ones spilled to disk.
+//
+// The in-memory part is a ring buffer, so append() and spillFirst() are O(1)
+// and never shift entries. With a spill directory set, spillFirst() frames
+// the oldest entry (length + CRC-32) and appends it to the current segment
+// file; a segment is closed once it reaches SegmentBytes and the next one
+// started, so no file is ever rewritten. forEach() walks the segments
+// oldest first through read-only memory maps and then the ring, so the
+// whole history can be replayed while RAM only holds the ring. Without a
+// spill directory spilled entries are simply dropped.
+class InteractionHistory
+{
+public:
+    class const_iterator
+    {
+    public:
+        const LearningData &operator*() const { return history->at(index); }
+        const LearningData *operator->() const { return &history->at(index); }
+        const_iterator &operator++() { ++index; return *this; }
+        bool operator==(const const_iterator &other) const { return index == other.index; }
+        bool operator!=(const const_iterator &other) const { return index != other.index; }
+
+    private:
+        friend class InteractionHistory;
+        const_iterator(const InteractionHistory *history, int index) : history(history), index(index) {}
+
+        const InteractionHistory *history;
+        int index;
+    };
+
+    InteractionHistory() = default;
+    ~InteractionHistory();
+
+    // In-memory entries, oldest first
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    const LearningData &at(int index) const { return ring[(head + index) & (ring.size() - 1)]; }
+    const LearningData &operator[](int index) const { return at(index); }
+    const LearningData &first() const { return at(0); }
+    const LearningData &last() const { return at(count - 1); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    void append(const LearningData &data);
+    // Moves the oldest in-memory entry to the current segment (or drops it)
+    void spillFirst();
+    // In-memory entries only; segments stay on disk
+    void clear();
+
+    // Creates the directory if needed and resumes after its newest intact
+    // entry (a torn tail from a crash is cut off). Empty closes the segments.
+    bool setSpillDirectory(const QString &directory);
+    QString spillDirectory() const { return directory; }
+    // Id after the newest spilled entry, 0 when nothing was spilled
+    quint64 spilledUntil() const { return nextSpilledId; }
+
+    // Spilled entries oldest first, then the in-memory ones; stops early and
+    // returns false when visitor does
+    bool forEach(const std::function<bool(const LearningData &)> &visitor) const;
+
+    QString lastError() const { return error; }
+
+private:
+    QStringList segmentPaths() const;
+    bool openSegment(const QString &path);
+    bool startSegment();
+    // Visits the intact frames of one segment; returns the end of the last one
+    qint64 scanSegment(const QString &path, const std::function<bool(const LearningData &)> &visitor,
+                       bool *stopped) const;
+    void setError(const QString &message);
+
+    std::vector<LearningData> ring;  // Size is zero or a power of two
+    int head = 0;
+    int count = 0;
+
+    QString directory;
+    QFile segment;                   // Open for appending
+    int segmentNumber = 0;
+    quint64 nextSpilledId = 0;
+    QString error;
+};
+
+#endif // INTERACTIONHISTORY_H
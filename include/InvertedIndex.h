@@ -0,0 +1,62 @@
+#ifndef INVERTEDINDEX_H
+#define INVERTEDINDEX_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+struct Posting {
+    quint32 docId;
+    float score;
+};
+
+struct PostingList {
+    QVector<Posting> postings; // Sorted by ascending docId
+    float maxScore = 0.0f;
+};
+
+struct SearchHit {
+    quint32 docId;
+    double score;
+};
+
+struct SearchStats {
+    qint64 postingsVisited = 0;
+    qint64 postingsSkipped = 0;
+};
+
+// Token -> postings index over learned responses.
+//
+// Every posting carries a precomputed score, a document's score for a query
+// is the sum of its posting scores over the query tokens. topK() uses the
+// MaxScore strategy: lists whose combined upper bound cannot beat the current
+// k-th best score are only probed for candidates found elsewhere, and the
+// search stops as soon as no unseen document can enter the result. Lookup
+// cost therefore depends on the postings touched, not on the index size.
+class InvertedIndex
+{
+public:
+    InvertedIndex();
+
+    // Document ids are expected to grow monotonically (append order)
+    void addPosting(const QString &token, quint32 docId, double score);
+    // Drops every posting of the document (an evicted response)
+    void removeDocument(quint32 docId);
+    QVector<SearchHit> topK(const QStringList &queryTokens, int k,
+                            SearchStats *stats = nullptr) const;
+
+    bool contains(const QString &token) const;
+    const PostingList *postings(const QString &token) const;
+    QStringList tokens() const;
+    int termCount() const;
+    qint64 postingCount() const;
+    void clear();
+
+private:
+    QHash<QString, PostingList> terms;
+    QHash<quint32, QStringList> documentTerms;  // Tokens with a posting per document, for removeDocument()
+    qint64 totalPostings;
+};
+
+#endif // INVERTEDINDEX_H
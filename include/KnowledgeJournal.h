@@ -0,0 +1,95 @@
+#ifndef KNOWLEDGEJOURNAL_H
+#define KNOWLEDGEJOURNAL_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QThread>
+#include <memory>
+
+// One knowledge base mutation
+struct JournalRecord {
+    enum Type : quint8 {
+        Fact = 1,         // fields: topic, information
+        Interaction = 2,  // fields: response, input tokens...
+        CodeExample = 3   // fields: code
+    };
+
+    Type type;
+    QStringList fields;
+};
+
+// Crash-safe persistence: append-only binary journal plus snapshots.
+//
+// append() frames a record on the caller's thread and hands it to a writer
+// thread, which writes everything queued since its last write in one go and
+// syncs once (group commit). Each record carries a sequence number and a
+// CRC-32; a torn tail left by a crash is detected and cut off on recovery.
+//
+// writeSnapshot() compacts: the snapshot is written atomically next to the
+// journal, covering every record appended before the call, and the journal
+// starts over. Records already covered by the snapshot are skipped on
+// recovery, so a crash between the two steps is harmless.
+class KnowledgeJournal
+{
+public:
+    explicit KnowledgeJournal(const QString &directory);
+    ~KnowledgeJournal();
+
+    // Reads the snapshot and the journal records written after it, then starts
+    // the writer. snapshot is empty when none has been written yet.
+    bool open(QByteArray *snapshot, QVector<JournalRecord> *records);
+    void close();
+    bool isOpen() const;
+
+    void append(const JournalRecord &record);
+    void writeSnapshot(const QByteArray &snapshot);
+    // Blocks until everything appended so far is on disk
+    void flush();
+
+    // Compaction is due once the journal outgrows this many bytes
+    void setCompactionThreshold(qint64 bytes);
+    bool needsCompaction() const;
+    qint64 journalSize() const;
+
+    QString lastError() const;
+
+private:
+    struct Task {
+        quint64 sequence;
+        QByteArray data;     // Framed record or snapshot payload
+        bool snapshot;
+    };
+
+    bool readSnapshot(QByteArray *snapshot, quint64 *coveredSequence);
+    bool readJournal(quint64 coveredSequence, QVector<JournalRecord> *records);
+    bool openJournalFile(bool truncate);
+    void enqueue(Task task);
+    void writerLoop();
+    bool writeFrames(const QByteArray &frames);
+    bool writeSnapshotFile(quint64 sequence, const QByteArray &snapshot);
+    void setError(const QString &error);
+
+    QString journalPath;
+    QString snapshotPath;
+    QFile journalFile;                       // Used by the writer thread only
+    std::unique_ptr<QThread> writer;
+
+    mutable QMutex mutex;
+    QWaitCondition workAvailable;
+    QWaitCondition workDone;
+    QVector<Task> queue;
+    quint64 nextSequence;
+    quint64 enqueuedTasks;
+    quint64 completedTasks;
+    qint64 bytesWritten;
+    qint64 compactionThreshold;
+    bool stopping;
+    QString error;
+};
+
+#endif // KNOWLEDGEJOURNAL_H
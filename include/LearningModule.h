@@ -5,19 +5,25 @@
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QVector>
 #include <QtCore/QTimer>
+#include <QtCore/QThreadPool>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
+#include <QtCore/QBitArray>
+#include <functional>
+#include <memory>
 
-struct LearningData {
-    QString input;
-    QString output;
-    QString context;
-    double reward;
-    qint64 timestamp;
-    QString category;
-};
+#include "IntentMatcher.h"
+#include "DenseLayer.h"
+#include "MlpTrainer.h"
+#include "FeatureHasher.h"
+#include "HnswIndex.h"
+#include "MinHashIndex.h"
+#include "InteractionHistory.h"
+#include "FlatHashMap.h"
+#include "AnalyzedMessage.h"
 
 struct NeuralConnection {
     int fromNode;
@@ -26,6 +32,14 @@ struct NeuralConnection {
     double lastUpdate;
 };
 
+// Training and evaluation run on a dedicated training thread, one job at a
+// time in the order posted. The thread owns the model (network, optimizer,
+// pattern confidences and statistics) and publishes an immutable snapshot of
+// it after every job by swapping an atomic shared pointer. Inference and the
+// statistics getters read the current snapshot without locking, so they
+// never wait for a training step. The interaction history, its indexes and
+// the knowledge base belong to the module's own thread; jobs receive what
+// they need from them by value, and signals are emitted on that thread.
 class LearningModule : public QObject
 {
     Q_OBJECT
@@ -36,6 +50,9 @@ public:
     
     // Learning methods
     void learn(const QString &input, const QString &output, double reward = 1.0);
+    // Reuses whatever the request pipeline already computed for the message
+    void learn(const std::shared_ptr<const AnalyzedMessage> &message, const QString &output,
+               double reward = 1.0);
     void reinforcementLearning(const QString &action, double reward);
     void unsupervisedLearning(const QStringList &data);
     
@@ -53,8 +70,27 @@ public:
     // Neural network operations
     void initializeNetwork(int inputSize, int hiddenSize, int outputSize);
     QVector<double> processInput(const QVector<double> &input);
-    void trainNetwork(const QVector<QVector<double>> &inputs, 
-                     const QVector<QVector<double>> &targets);
+    // Steps every 16 samples and once at the end; returns the loss of the last
+    // step. Blocks until the training thread has run it (as do
+    // setTrainingOptimizer, setInferencePrecision and retrainFromHistory).
+    double trainNetwork(const QVector<QVector<double>> &inputs, 
+                        const QVector<QVector<double>> &targets);
+    void setTrainingOptimizer(TrainingOptimizer optimizer);
+    TrainingOptimizer trainingOptimizer() const;
+    TrainingStep lastTrainingStep() const;
+    // One pass over every stored interaction, spilled ones included; returns
+    // the loss of the last step
+    double retrainFromHistory();
+    // Returns once every job posted so far has been applied and published
+    void waitForTraining();
+    
+    // Opt-in float32/int8 inference for recognition and prediction; training
+    // keeps the double network. Parity with the double network is checked when
+    // enabled and at every performance evaluation, falling back to double on
+    // disagreement.
+    bool setInferencePrecision(InferencePrecision precision);
+    InferencePrecision inferencePrecision() const;
+    InferenceParity inferenceParity() const;
     
     // Self-improvement
     void analyzeMistakes();
@@ -66,11 +102,17 @@ public:
     double getAverageConfidence() const;
     QStringList getMostLearnedPatterns() const;
     QString getLearningReport() const;
+    
+    // Interactions kept in memory for retrieval; older ones are unindexed and
+    // spilled to disk next to the knowledge file
+    void setMaxHistorySize(int size);
+    int maxHistory() const;
 
 signals:
     void learningProgressUpdated(int progress);
     void patternRecognized(const QString &pattern);
     void confidenceUpdated(double confidence);
+    void trainingStepFinished(double loss);
     void knowledgeUpdated(const QString &category);
     void learningComplete();
     void errorInLearning(const QString &error);
@@ -80,44 +122,122 @@ private slots:
     void evaluatePerformance();
 
 private:
+    struct CategoryEntry {
+        quint64 id;
+        double score;                        // Reward, 0 without an output; fixed at insertion
+    };
+    
+    // Entries of one category, oldest first from head. Trimming only moves
+    // head; the dropped prefix is compacted away once it is half the vector.
+    struct CategoryHistory {
+        QVector<CategoryEntry> entries;
+        int head = 0;
+        
+        int size() const { return static_cast<int>(entries.size()) - head; }
+        const CategoryEntry &at(int index) const { return entries[head + index]; }
+        void removeFirst();
+    };
+
+    // Model state as published by the training thread; never modified after
+    // publishSnapshot(), so any thread may read it without locking
+    struct Snapshot {
+        Mlp network;
+        QuantizedMlp reducedNetwork;         // Only for reduced precision
+        InferencePrecision precision = InferencePrecision::Double;
+        InferenceParity parity;
+        quint64 outputVersion = 0;           // Weights and precision; keys cached network outputs
+        FlatHashMap<double> patternConfidence;
+        FlatHashMap<int> patternFrequency;
+        double learningRate = 0.0;
+        double averageConfidence = 0.0;
+        int totalLearningEvents = 0;
+        TrainingOptimizer optimizer = TrainingOptimizer::Adam;
+        TrainingStep lastStep;
+    };
+
     void initializeLearningSystem();
     void processLearningData();
     void updateNeuralConnections();
     
     // Pattern analysis
-    QStringList extractFeatures(const QString &input);
+    QStringList recognizePatterns(const Snapshot &model, const AnalyzedMessage &message);
+    double calculateConfidence(const AnalyzedMessage &message, const QString &output);
+    double patternsConfidence(const Snapshot &model, const AnalyzedMessage &message, const QStringList &patterns);
+    SparseVector extractFeatures(const AnalyzedMessage &message);
     QString findSimilarPatterns(const QString &input);
+    QVector<const LearningData *> nearestInteractions(const AnalyzedMessage &message, int count);
+    const LearningData *historyEntry(quint64 id) const;
+    const LearningData *bestInCategories(const QStringList &categories) const;
+    void indexHistoryEntry(const LearningData &data);
+    void trimHistory();
+    void rebuildInteractionIndex();
+    QString analyzeCategory(const QBitArray &intents);
+    void syncPatternMatcher(const QString &category);
+    void setPatternConfidence(QStringView pattern, double confidence);
+    void removePattern(QStringView pattern);
+    void resyncConfidenceSum();
     void clusterData();
+    QStringList mostLearnedPatterns(const Snapshot &model) const;
+    
+    // Self-improvement, split into the history scan (module thread) and the
+    // model update (training thread)
+    QMap<QString, int> countMistakes() const;
+    void penalizeMistakes(const QMap<QString, int> &errorPatterns);
+    void pruneWeakPatterns();
+    int recentEventCount() const;
+    void adaptLearningRate(int recentEvents);
     
     // Neural network helpers
-    double activationFunction(double x);
-    double activationDerivative(double x);
-    void backpropagate(const QVector<double> &input, const QVector<double> &target);
-    void updateWeights(double learningRate);
+    QVector<double> networkOutput(const Snapshot &model, const AnalyzedMessage &message);
+    QVector<double> infer(const Snapshot &model, const SparseVector &features) const;
+    InferenceParity checkReducedNetwork(InferencePrecision precision);
+    void applyTrainingStep();
+    
+    // Training thread
+    std::shared_ptr<const Snapshot> snapshot() const;
+    void publishSnapshot();
+    void postTraining(const std::function<void()> &job);
+    void notify(const std::function<void()> &emitter);
     
     // Data structures
-    QVector<LearningData> learningHistory;
+    InteractionHistory learningHistory;      // Newest maxHistorySize in memory, the rest on disk
+    HnswIndex interactionIndex;              // Embeddings of learningHistory inputs by id
+    MinHashIndex similarityIndex;            // Token sets of learningHistory inputs by id, rebuilt on load
+    QHash<QString, CategoryHistory> historyByCategory;   // Oldest first, like learningHistory
+    FeatureHasher embeddingFeaturizer;       // Text -> retrieval embedding
+    quint64 nextInteractionId;
     QVector<NeuralConnection> connections;
     QMap<QString, QJsonObject> knowledgeBase;
-    QMap<QString, double> patternConfidence;
-    QMap<QString, int> patternFrequency;
+    FlatHashMap<double> patternConfidence;   // Training thread; written via setPatternConfidence()
+    FlatHashMap<int> patternFrequency;       // Training thread
+    IntentMatcher patternMatcher;
     
-    // Neural network
-    QVector<QVector<double>> weights;
-    QVector<double> biases;
-    QVector<double> lastOutput;
-    QVector<double> lastHidden;
+    // Neural network, owned by the training thread; the module's thread only
+    // touches it (and the featurizers) while that thread is idle
+    Mlp network;
+    QuantizedMlp reducedNetwork;
+    InferencePrecision requestedPrecision;
+    InferenceParity lastParity;
+    bool reducedNetworkStale;                // Weights changed since reducedNetwork was built
+    quint64 weightsVersion;                  // Bumped on every weight change (keys cached outputs)
+    FeatureHasher featurizer;                // Text -> sparse network input
+    FeatureHasher targetFeaturizer;          // Text -> training target
+    MlpTrainer trainer;                      // Gradients and optimizer state of network
+    TrainingStep lastStep;
     
     int inputSize;
     int hiddenSize;
     int outputSize;
-    double learningRate;
+    double learningRate;                     // Training thread
     double momentum;
     
     // Learning parameters
     QTimer *learningTimer;
-    int totalLearningEvents;
+    QThreadPool *trainingPool;               // One thread: the training thread
+    std::shared_ptr<const Snapshot> published;   // Only via std::atomic_load/atomic_store
+    int totalLearningEvents;                 // Training thread, like the two below
     double averageConfidence;
+    double confidenceSum;                    // Running sum of patternConfidence values
     int maxHistorySize;
     
     bool isLearning;
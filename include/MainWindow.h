@@ -16,6 +16,10 @@
 #include <QtWidgets/QStatusBar>
 #include <QtWidgets/QScrollArea>
 #include <QtCore/QTimer>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QSet>
+#include <QtGui/QTextCursor>
 
 class AIEngine;
 class NetworkManager;
@@ -35,7 +39,11 @@ private slots:
     void clearChat();
     void saveConversation();
     void loadConversation();
-    void onAIResponse(const QString &response);
+    void onResponseStarted(quint64 requestId);
+    void onResponseChunk(quint64 requestId, int sequence, const QString &chunk);
+    void onResponseFinished(quint64 requestId, const QString &response);
+    void onResponseCancelled(quint64 requestId);
+    void stopGeneration();
     void onLearningProgress(int progress);
     void updateStatus(const QString &status);
     void generateCode();
@@ -47,6 +55,14 @@ private:
     void setupStatusBar();
     void connectSignals();
     void addMessageToChat(const QString &sender, const QString &message, const QString &color = "#FFFFFF");
+    void endRequest(quint64 requestId);
+    
+    // A response being rendered chunk by chunk
+    struct StreamingMessage {
+        QTextCursor cursor;             // End of the message text
+        int nextSequence = 0;
+        QMap<int, QString> pendingChunks; // Chunks that arrived out of order
+    };
 
     // UI Components
     QWidget *centralWidget;
@@ -58,6 +74,7 @@ private:
     QTextEdit *chatDisplay;
     QLineEdit *messageInput;
     QPushButton *sendButton;
+    QPushButton *stopButton;
     QPushButton *clearButton;
     
     // Code tab
@@ -86,6 +103,11 @@ private:
     LearningModule *learningModule;
     
     QTimer *statusTimer;
+    QTimer *draftTimer;             // Debounces speculative analysis of messageInput
+    
+    // Requests sent from this window that have not finished yet
+    QSet<quint64> activeRequests;
+    QHash<quint64, StreamingMessage> streamingMessages;
 };
 
 #endif // MAINWINDOW_H
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef MINHASHINDEX_H
+#define MINHASHINDEX_H
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <vector>
+
+struct MinHashMatch {
+    quint64 key;
+    float similarity;    // Estimated Jaccard similarity, share of equal signature values
+};
+
+// Near-duplicate index for token sets (MinHash with banded LSH).
+//
+// Every set is reduced once, on insert, to a signature: for each of
+// bands * rowsPerBand hash functions the smallest hash of its tokens. Two
+// sets agree on a signature value with probability equal to their Jaccard
+// similarity. The signature is cut into bands and each band is a bucket
+// key, so a search only looks at sets that share a whole band with the
+// query and scores them by signature agreement. A set of similarity s
+// becomes a candidate with probability 1 - (1 - s^rows)^bands: more bands
+// raise recall, more rows per band cut the candidates below threshold().
+//
+// Buckets are intrusive doubly linked lists through the slots, so insert()
+// and remove() touch bands entries each. Not thread-safe, not even search()
+// (it reuses a visit buffer).
+class MinHashIndex
+{
+public:
+    explicit MinHashIndex(int bands = 20, int rowsPerBand = 3);
+
+    int bands() const { return bandCount; }
+    int rowsPerBand() const { return rows; }
+    int signatureSize() const { return bandCount * rows; }
+    // Similarity at which a set is found with even odds, about (1/bands)^(1/rows)
+    double threshold() const;
+
+    QVector<quint32> signature(const QVector<quint32> &tokens) const;
+
+    // An existing key is replaced; empty sets are rejected
+    bool insert(quint64 key, const QVector<quint32> &tokens);
+    bool remove(quint64 key);
+    bool contains(quint64 key) const { return slotByKey.contains(key); }
+
+    // Up to k candidates of at least minSimilarity (estimated), most similar
+    // first, newer (larger) keys first on ties
+    QVector<MinHashMatch> search(const QVector<quint32> &tokens, int k, double minSimilarity = 0.0) const;
+
+    int size() const { return slotByKey.size(); }
+    bool isEmpty() const { return slotByKey.isEmpty(); }
+    void clear();
+
+private:
+    const quint32 *signatureOf(quint32 slot) const { return signatures.data() + static_cast<size_t>(slot) * signatureSize(); }
+    void computeSignature(const QVector<quint32> &tokens, quint32 *values) const;
+    quint64 bucketKey(int band, const quint32 *values) const;
+    void link(quint32 slot);
+    void unlink(quint32 slot);
+
+    int bandCount;
+    int rows;
+    std::vector<quint64> multipliers;    // Hash function i: (mix(token) * multipliers[i] + offsets[i]) >> 32
+    std::vector<quint64> offsets;
+
+    std::vector<quint32> signatures;     // signatureSize() values per slot
+    std::vector<quint64> slotKeys;
+    std::vector<quint32> freeSlots;
+    std::vector<quint32> nextInBucket;   // bandCount links per slot
+    std::vector<quint32> previousInBucket;
+    QHash<quint64, quint32> bucketHeads; // Bucket key (band included) -> newest slot
+    QHash<quint64, quint32> slotByKey;
+
+    mutable std::vector<quint32> visitMarks;
+    mutable quint32 visitEpoch;
+};
+
+#endif // MINHASHINDEX_H
@@ -0,0 +1,82 @@
+#ifndef MLPTRAINER_H
+#define MLPTRAINER_H
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "DenseLayer.h"
+
+enum class TrainingOptimizer {
+    Momentum,                        // Heavy ball: v = momentum * v + g, w -= rate * v
+    Adam
+};
+
+struct TrainingOptions {
+    TrainingOptimizer optimizer = TrainingOptimizer::Adam;
+    double momentum = 0.9;           // Also Adam's first-moment decay
+    double secondMomentDecay = 0.999;
+    double epsilon = 1e-8;
+};
+
+struct TrainingStep {
+    int samples = 0;                 // Accumulated since the previous step
+    double loss = 0.0;               // Mean over those samples, before the update
+    qint64 step = 0;                 // Steps taken since reset()
+};
+
+// Gradient descent for a sigmoid Mlp under squared error.
+//
+// accumulate() runs one forward and backward pass and adds the sample's
+// gradient to per-layer buffers shaped like the weights (same padded rows),
+// so the backward pass and the update are plain loops over aligned rows. A
+// sparse input only touches the gradient columns of its non-zero features.
+// step() applies the mean gradient with momentum or Adam in one fused pass
+// per buffer (AVX2 when available), clears the gradients and reports the
+// loss. The optimizer state belongs to one network shape; reset() after
+// the network is resized or its weights are replaced.
+class MlpTrainer
+{
+public:
+    MlpTrainer() = default;
+    explicit MlpTrainer(const Mlp &network, const TrainingOptions &options = TrainingOptions());
+
+    void reset(const Mlp &network);
+    void setOptions(const TrainingOptions &options);
+    TrainingOptions options() const { return settings; }
+
+    // Loss of the sample: 0.5 * sum over outputs of (output - target)^2.
+    // Missing targets count as zero; a network of a different shape resets
+    // the trainer first.
+    double accumulate(const Mlp &network, const SparseVector &input, const QVector<double> &target);
+    double accumulate(const Mlp &network, const QVector<double> &input, const QVector<double> &target);
+
+    int pendingSamples() const { return samples; }
+    // No-op (samples == 0) when nothing was accumulated
+    TrainingStep step(Mlp &network, double learningRate);
+
+    // "avx2" or "scalar"
+    static QString kernelName();
+
+private:
+    struct LayerState {
+        AlignedDoubles weightGradient;
+        AlignedDoubles biasGradient;
+        AlignedDoubles weightVelocity;   // Momentum, or Adam's first moment
+        AlignedDoubles biasVelocity;
+        AlignedDoubles weightSecond;     // Adam only
+        AlignedDoubles biasSecond;
+    };
+
+    bool matches(const Mlp &network) const;
+    double backward(const Mlp &network, const SparseVector *sparseInput, const double *denseInput,
+                    const QVector<QVector<double>> &activations, const QVector<double> &target);
+
+    TrainingOptions settings;
+    QVector<LayerState> layers;
+    QVector<int> shape;                  // Layer sizes including the input
+    int samples = 0;
+    double lossSum = 0.0;
+    qint64 steps = 0;
+};
+
+#endif // MLPTRAINER_H
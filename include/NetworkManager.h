@@ -11,6 +11,8 @@
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 
+#include "ConversationStore.h"
+
 class NetworkManager : public QObject
 {
     Q_OBJECT
@@ -27,6 +29,21 @@ public:
     // API calls
     void searchWeb(const QString &query);
     void queryAI(const QString &prompt, const QString &context = "");
+    
+    // Same requests for callers that race them (ResponseOrchestrator): the
+    // caller owns the reply and reads it with searchAnswer()/aiAnswer(),
+    // nothing is reported through the signals. Null when offline, and for
+    // queries without an API key (no simulated answer). The AI query asks
+    // for a server-sent event stream, see takeStreamedContent().
+    QNetworkReply *startWebSearch(const QString &query);
+    QNetworkReply *startAIQuery(const QString &prompt, const ConversationContext &context);
+    bool hasApiKey() const;
+    // Answer text of a finished reply, empty when there is nothing usable
+    QString searchAnswer(const QByteArray &data);
+    QString aiAnswer(const QByteArray &data);
+    // Content deltas of the complete server-sent event lines in buffer, which
+    // keeps the unfinished last line
+    static QString takeStreamedContent(QByteArray *buffer);
     void downloadCode(const QString &repository);
     void uploadLearningData(const QJsonObject &data);
     
@@ -46,7 +63,7 @@ signals:
     void errorOccurred(const QString &error);
 
 private slots:
-    void onNetworkReplyFinished();
+    void onNetworkReplyFinished(QNetworkReply *reply);
     void onConnectionTimeout();
     void checkConnectionStatus();
 
@@ -54,6 +71,12 @@ private:
     void setupNetworkManager();
     void handleNetworkError(QNetworkReply::NetworkError error);
     QString formatApiRequest(const QString &prompt, const QString &context);
+    QNetworkRequest searchRequest(const QString &query) const;
+    QNetworkRequest aiRequest() const;
+    // The system message first, then the history as user/assistant messages
+    QByteArray aiRequestBody(const QString &prompt, const QString &system,
+                             const QVector<ConversationTurn> &history = {}, bool stream = false) const;
+    QString formatSearchResults(const QJsonObject &results);
     QJsonObject parseResponse(const QByteArray &data);
     
     QNetworkAccessManager *networkManager;
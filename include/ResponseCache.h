@@ -0,0 +1,133 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QMutex>
+#include <list>
+
+struct ResponseCacheKey {
+    QString text;           // Normalized input
+    quint64 context = 0;    // Fingerprint of the conversation context
+
+    bool operator==(const ResponseCacheKey &other) const
+    {
+        return context == other.context && text == other.text;
+    }
+};
+
+inline size_t qHash(const ResponseCacheKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.text, key.context);
+}
+
+struct ResponseCacheStats {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 insertions = 0;
+    quint64 evictions = 0;      // Dropped for capacity, including rejected candidates
+    quint64 invalidations = 0;  // Dropped because a dependency changed
+
+    double hitRate() const
+    {
+        const quint64 lookups = hits + misses;
+        return lookups > 0 ? static_cast<double>(hits) / lookups : 0.0;
+    }
+};
+
+// Bounded cache of generated responses with W-TinyLFU eviction.
+//
+// New entries enter a small LRU window (1% of capacity). Entries leaving the
+// window compete with the main segment's victim and are admitted only if a
+// count-min sketch estimates them as more frequent, so one-off messages never
+// push out popular ones. The main segment is a segmented LRU (probation and
+// protected).
+//
+// Every entry lists the dependencies it was computed from (input tokens, fact
+// names, ...); invalidate() drops exactly the entries that depend on them.
+// A response computed while an invalidation ran is not inserted: pass the
+// generation() read before computing it to insert().
+// All methods are thread-safe.
+class ResponseCache
+{
+public:
+    explicit ResponseCache(int capacity = 1024);
+
+    bool lookup(const QString &text, quint64 context, QString *response);
+    bool insert(const QString &text, quint64 context, const QString &response,
+                const QStringList &dependencies, quint64 generation);
+    quint64 generation() const;
+
+    // Returns the number of entries dropped
+    int invalidate(const QString &dependency);
+    int invalidate(const QStringList &dependencies);
+    void clear();
+
+    void setCapacity(int capacity);
+    int capacity() const;
+    int size() const;
+
+    ResponseCacheStats stats() const;
+    void resetStats();
+
+private:
+    enum Segment {
+        Window,
+        Probation,
+        Protected
+    };
+
+    using KeyList = std::list<ResponseCacheKey>;
+
+    struct Entry {
+        QString response;
+        QStringList dependencies;
+        Segment segment = Window;
+        KeyList::iterator position;
+    };
+
+    // 4-row count-min sketch of 8-bit saturating counters, halved periodically
+    // so that old popularity fades out
+    class FrequencySketch
+    {
+    public:
+        void resize(int capacity);
+        void increment(size_t hash);
+        int estimate(size_t hash) const;
+
+    private:
+        int index(size_t hash, int row) const;
+
+        QVector<quint8> table;
+        int mask = 0;
+        int additions = 0;
+        int sampleSize = 0;
+    };
+
+    void updateCapacities(int capacity);
+    KeyList &listFor(Segment segment);
+    void moveTo(Entry &entry, Segment segment);
+    void promote(Entry &entry);
+    void admitFromWindow();
+    void remove(const ResponseCacheKey &key);
+    void evictOverflow();
+
+    mutable QMutex mutex;
+    QHash<ResponseCacheKey, Entry> entries;
+    QHash<QString, QSet<ResponseCacheKey>> dependents;
+    KeyList windowLru;      // Most recently used first
+    KeyList probationLru;
+    KeyList protectedLru;
+    FrequencySketch sketch;
+
+    int maxEntries;
+    int windowCapacity;
+    int protectedCapacity;
+    quint64 invalidationGeneration;
+    ResponseCacheStats counters;
+};
+
+#endif // RESPONSECACHE_H
@@ -0,0 +1,117 @@
+#ifndef RESPONSEORCHESTRATOR_H
+#define RESPONSEORCHESTRATOR_H
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QPointer>
+#include <QtNetwork/QNetworkReply>
+#include <functional>
+#include <memory>
+
+#include "ConversationStore.h"
+
+class NetworkManager;
+
+enum class ResponseSource {
+    Local,
+    Search,
+    Remote
+};
+
+const int ResponseSourceCount = 3;
+
+struct SourceStats {
+    quint64 launched = 0;
+    quint64 wins = 0;
+    quint64 late = 0;                // Still running at the deadline, aborted
+    quint64 failed = 0;              // Network error or nothing usable in the answer
+    quint64 skipped = 0;             // Not launched because the source is too slow
+    double latencyMsec = 0.0;        // Moving average; late runs count with their elapsed time
+};
+
+// Races the local answer against web search and the remote model under a
+// per-request latency budget.
+//
+// start() launches the network sources when a request is queued; resolve()
+// is called by the worker once the local answer is ready and blocks until
+// the deadline, or earlier when no source still running could beat the best
+// answer in hand. Losers are aborted. A source whose average latency exceeds
+// the budget is skipped, except for an occasional probe so that it is picked
+// up again once it gets faster.
+//
+// The remote model streams its answer. Once its first delta is in and no
+// answer in hand beats it, it has won: resolve() passes the deltas on as
+// they arrive and returns when the reply is complete, past the deadline if
+// need be. Its latency is the time to that first delta.
+class ResponseOrchestrator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ResponseOrchestrator(QObject *parent = nullptr);
+
+    // Network sources run on the manager's (GUI) thread
+    void setNetworkManager(NetworkManager *manager);
+    // Milliseconds from start() to the answer; 0 answers locally only
+    void setBudget(int msec);
+    int budget() const;
+
+    // Any thread. context is passed to the remote model.
+    void start(quint64 requestId, const QString &message, const ConversationContext &context);
+    // Any thread. Best answer available at the deadline; the local one when
+    // nothing was started for the request or it was cancelled. With onChunk,
+    // a remote answer that wins is delivered through it (on the calling
+    // thread) as it arrives, and the return value is the whole text.
+    using ChunkHandler = std::function<void(const QString &chunk)>;
+    QString resolve(quint64 requestId, const QString &localAnswer, bool localConfident,
+                    ResponseSource *winner = nullptr, const ChunkHandler &onChunk = ChunkHandler());
+    // Any thread. Aborts the network sources, a waiting resolve() returns at once.
+    void cancel(quint64 requestId);
+
+    SourceStats sourceStats(ResponseSource source) const;
+    static QString sourceName(ResponseSource source);
+
+private:
+    struct Candidate {
+        bool pending = false;        // Launched (or about to be) and not finished
+        bool answered = false;
+        QString answer;
+        int score = 0;
+        // Remote model: the event stream received so far
+        QByteArray body;             // Everything, for a server that does not stream
+        QByteArray buffer;           // Unparsed tail
+        QString streamed;            // Content deltas
+    };
+
+    struct Race {
+        QElapsedTimer clock;         // Started by start()
+        int budgetMsec = 0;
+        bool cancelled = false;
+        Candidate candidates[ResponseSourceCount];
+        QPointer<QNetworkReply> replies[ResponseSourceCount];
+    };
+
+    bool shouldLaunch(ResponseSource source, int budgetMsec);
+    void launch(quint64 requestId, const QString &message, const ConversationContext &context);
+    void onReplyReadyRead(quint64 requestId, QNetworkReply *reply);
+    void onReplyFinished(quint64 requestId, ResponseSource source, QNetworkReply *reply);
+    void abortReplies(const std::shared_ptr<Race> &race);
+    void recordLatency(ResponseSource source, qint64 msec);
+    int bestAnswer(const Race &race, ResponseSource *source) const;
+    int bestPending(const Race &race) const;
+
+    QPointer<NetworkManager> networkManager;
+    QAtomicInt budgetMsec;
+
+    mutable QMutex mutex;            // Guards everything below
+    QWaitCondition answered;
+    QHash<quint64, std::shared_ptr<Race>> races;
+    SourceStats stats[ResponseSourceCount];
+    int skipStreak[ResponseSourceCount] = {};
+};
+
+#endif // RESPONSEORCHESTRATOR_H
@@ -0,0 +1,74 @@
+#ifndef RESPONSESTORE_H
+#define RESPONSESTORE_H
+
+#include <QtCore/QString>
+#include <QtCore/QHash>
+#include <QtCore/QMultiHash>
+#include <QtCore/QVector>
+#include <set>
+#include <utility>
+
+#include "InvertedIndex.h"
+
+// Content-addressed storage of learned responses.
+//
+// Every distinct response text is kept once under a compact id; learning the
+// same text again returns the existing id and bumps its count. Ids are never
+// reused, so an InvertedIndex over them stays in append order.
+//
+// The store is bounded by an approximate memory limit. When it is exceeded the
+// least frequently learned responses are evicted (the oldest first among equal
+// counts). An evicted id's postings are removed from the index set with
+// setIndex(), so the index shrinks with the store.
+// Not thread-safe; AIEngine guards it with the knowledge lock.
+class ResponseStore
+{
+public:
+    explicit ResponseStore(qint64 memoryLimit = 16 * 1024 * 1024);
+
+    // Index over the stored ids; not owned, may be null
+    void setIndex(InvertedIndex *postings) { index = postings; }
+
+    // Returns the id of text, storing it if it is new
+    quint32 intern(const QString &text);
+
+    bool contains(quint32 id) const;
+    QString response(quint32 id) const;
+    quint32 count(quint32 id) const;
+
+    // Snapshot support: ids in ascending order, restore() keeps the given id
+    QVector<quint32> ids() const;
+    void restore(quint32 id, const QString &text, quint32 count);
+    quint32 nextId() const { return nextFreeId; }
+    void setNextId(quint32 id);
+
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const { return maxBytes; }
+    qint64 memoryUsage() const { return usedBytes; }
+    int size() const { return entries.size(); }
+    quint64 evictionCount() const { return evictions; }
+    void clear();
+
+private:
+    struct Entry {
+        QString text;
+        quint32 count;
+    };
+
+    static qint64 entryCost(const QString &text);
+    void store(quint32 id, const QString &text, quint32 count);
+    void remove(quint32 id);
+    void evictOverflow(quint32 keep);
+
+    QHash<quint32, Entry> entries;
+    QMultiHash<size_t, quint32> byContent;          // Text hash -> ids (collisions resolved by comparison)
+    std::set<std::pair<quint32, quint32>> byCount;  // (count, id), eviction order first
+
+    InvertedIndex *index;
+    quint32 nextFreeId;
+    qint64 maxBytes;
+    qint64 usedBytes;
+    quint64 evictions;
+};
+
+#endif // RESPONSESTORE_H
@@ -0,0 +1,64 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QStringView>
+#include <QtCore/QVector>
+
+struct TokenSpan {
+    int start;
+    int length;
+};
+
+// Result of Tokenizer::tokenize: one lowercased copy of the input plus
+// token spans pointing into it. Tokens are read as QStringView, nothing is
+// allocated per token unless toStringList() is called.
+class TokenList
+{
+public:
+    int size() const { return spans.size(); }
+    bool isEmpty() const { return spans.isEmpty(); }
+    QStringView at(int index) const
+    {
+        return QStringView(text).mid(spans[index].start, spans[index].length);
+    }
+    QStringView operator[](int index) const { return at(index); }
+
+    bool contains(QStringView token) const;
+    QStringList toStringList() const;
+
+    const QString &normalizedText() const { return text; }
+    const QVector<TokenSpan> &tokenSpans() const { return spans; }
+
+private:
+    friend class Tokenizer;
+
+    QString text;
+    QVector<TokenSpan> spans;
+};
+
+// Unicode-aware single-pass tokenizer shared by AIEngine, LearningModule
+// and CodeGenerator.
+//
+// Word characters are letters, digits, '_' and combining marks of any script,
+// so Slovak words such as "čau" or "kalkulačka" stay whole. Input with
+// decomposed diacritics is composed to NFC first. Pure ASCII blocks are
+// lowercased and classified eight UTF-16 units at a time with SSE2.
+class Tokenizer
+{
+public:
+    // Lowercase and split on runs of non-word characters
+    static TokenList tokenize(QStringView input);
+
+    // Lowercase, keep word characters, whitespace and "?!." and collapse
+    // whitespace to single spaces (trimmed)
+    static QString normalize(QStringView input);
+
+    static QString toLower(QStringView input);
+    // Lowercase and strip diacritics ("Čau" -> "cau") for typo-tolerant lookups
+    static QString fold(QStringView input);
+    static bool isWordCharacter(char32_t ucs4);
+};
+
+#endif // TOKENIZER_H
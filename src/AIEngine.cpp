@@ -5,108 +5,541 @@
 #include <QtCore/QDebug>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QDataStream>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QRegularExpression>
-#include <QtCore/QRandomGenerator>
+#include <QtCore/QPromise>
+#include <algorithm>
 #include <cmath>
+#include <limits>
+
+namespace {
+
+// Response cache dependencies other than input tokens; never valid tokens
+const QString FactDependencyPrefix = QStringLiteral("fact:");
+const QString NetworkDependency = QStringLiteral("@network");
+// Fallback responses that a new fact topic or a new word could change
+const QString VocabularyDependency = QStringLiteral("@vocabulary");
+
+const QString DefaultGreeting = QStringLiteral("Ahoj! Ako vám môžem pomôcť?");
+
+// Version 1 stored responses as a plain list indexed by document id
+const quint32 KnowledgeSnapshotVersion = 2;
+
+// Output thresholds used by composeResponse, checked for reduced-precision parity
+const QVector<double> ResponseThresholds = {0.3, 0.5, 0.7};
+const int CalibrationSamples = 256;
+
+// Time a request may take before the best answer at hand is used
+const int DefaultResponseBudgetMsec = 1500;
+
+// Keeps prompt size and upload time of remote queries bounded
+const int DefaultRemoteContextTokens = 1024;
+
+// Edits tolerated in a word: none below three letters, one up to five, then two
+int typoTolerance(qsizetype length)
+{
+    return length < 3 ? 0 : (length <= 5 ? 1 : 2);
+}
+
+} // namespace
 
 AIEngine::AIEngine(QObject *parent)
     : QObject(parent)
     , networkManager(nullptr)
     , learningModule(nullptr)
+    , orchestrator(new ResponseOrchestrator(this))
+    , conversations(10)
     , learningTimer(new QTimer(this))
-    , isProcessing(false)
+    , workerPool(new QThreadPool(this))
+    , pendingRequests(0)
+    , maxPendingRequests(64)
+    , requestCounter(0)
+    , streamChunkSize(256)
+    , remoteContextTokens(DefaultRemoteContextTokens)
+    , speculationPool(new QThreadPool(this))
+    , speculationTicket(0)
+    , trainingPool(new QThreadPool(this))
+    , trainingFlushTimer(new QTimer(this))
+    , batchSize(32)
+    , trainingRate(0.01)
+    , requestedPrecision(InferencePrecision::Double)
     , inputSize(100)
     , hiddenSize(50)
     , outputSize(20)
+    , featurizer(inputSize)
+    , targetFeaturizer(outputSize, FeatureHasher::Unsigned)
+    , networkVersion(0)
 {
-    // Initialize context
-    context.contextLength = 10;
-    
     // Setup learning timer
     connect(learningTimer, &QTimer::timeout, this, &AIEngine::onLearningUpdate);
     learningTimer->start(5000); // Update every 5 seconds
     
+    // Setup request workers, one per core
+    workerPool->setMaxThreadCount(QThread::idealThreadCount());
+    
+    // Batches are applied one after another on a single training thread
+    trainingPool->setMaxThreadCount(1);
+    connect(trainingFlushTimer, &QTimer::timeout, this, &AIEngine::flushTraining);
+    trainingFlushTimer->start(2000);
+    
+    // Drafts are analysed one at a time, never competing with real requests
+    speculationPool->setMaxThreadCount(1);
+    
+    orchestrator->setBudget(DefaultResponseBudgetMsec);
+    
+    // Evicted responses take their postings with them
+    knowledgeBase.responses.setIndex(&knowledgeBase.patterns);
     initializeKnowledgeBase();
     initializeNeuralNetwork();
 }
 
 AIEngine::~AIEngine()
 {
-    saveKnowledgeBase();
+    // Drop queued requests and let running ones finish before saving
+    workerPool->clear();
+    workerPool->waitForDone();
+    speculationTicket.fetchAndAddOrdered(1);
+    speculationPool->clear();
+    speculationPool->waitForDone();
+    waitForTraining();
+    
+    // Everything is already journaled; compact only if the journal has grown
+    if (knowledgeJournal) {
+        if (knowledgeJournal->needsCompaction()) {
+            saveKnowledgeBase();
+        }
+        knowledgeJournal->close();
+    }
 }
 
 void AIEngine::initialize()
 {
     emit statusChanged("Inicializujem AI systém...");
     
-    loadKnowledgeBase();
+    QWriteLocker locker(&knowledgeLock);
+    const bool loaded = loadKnowledgeBase();
     
-    // Initialize with some basic knowledge
-    knowledgeBase.facts["greeting"] = "Ahoj! Som AI asistent. Môžem vám pomôcť s programovaním, odpovedať na otázky a učiť sa z našej konverzácie.";
-    knowledgeBase.facts["programming"] = "Môžem generovať kód v C++, Python, JavaScript a ďalších jazykoch.";
-    knowledgeBase.facts["learning"] = "Učím sa z každej interakcie a postupne sa zlepšujem.";
+    // Initialize with some basic knowledge (journaled only when it changes)
+    const QMap<QString, QString> basicFacts = {
+        {"greeting", "Ahoj! Som AI asistent. Môžem vám pomôcť s programovaním, odpovedať na otázky a učiť sa z našej konverzácie."},
+        {"programming", "Môžem generovať kód v C++, Python, JavaScript a ďalších jazykoch."},
+        {"learning", "Učím sa z každej interakcie a postupne sa zlepšujem."}
+    };
+    for (auto it = basicFacts.begin(); it != basicFacts.end(); ++it) {
+        if (knowledgeBase.facts.value(it.key()) != it.value()) {
+            applyFact(it.key(), it.value());
+            journalMutation(JournalRecord::Fact, {it.key(), it.value()});
+        }
+    }
     
     // Add some code examples
-    knowledgeBase.codeExamples << 
-        "#include <iostream>\nusing namespace std;\nint main() {\n    cout << \"Hello World!\" << endl;\n    return 0;\n}";
+    const QStringList basicExamples = {
+        "#include <iostream>\nusing namespace std;\nint main() {\n    cout << \"Hello World!\" << endl;\n    return 0;\n}",
+        "def hello_world():\n    print(\"Hello World!\")\n\nhello_world()"
+    };
+    for (const QString &example : basicExamples) {
+        if (!knowledgeBase.codeExamples.contains(example)) {
+            applyCodeExample(example);
+            journalMutation(JournalRecord::CodeExample, {example});
+        }
+    }
+    locker.unlock();
     
-    knowledgeBase.codeExamples <<
-        "def hello_world():\n    print(\"Hello World!\")\n\nhello_world()";
+    responseCache.clear();
+    
+    if (!loaded) {
+        emit errorOccurred("Vedomostnú bázu sa nepodarilo načítať, zmeny sa nebudú ukladať");
+    }
     
     emit statusChanged("AI systém inicializovaný");
 }
 
-void AIEngine::processMessage(const QString &message)
+quint64 AIEngine::processMessage(const QString &message, const QString &sessionId)
 {
-    if (isProcessing) {
-        emit errorOccurred("AI už spracúva inú správu");
-        return;
+    quint64 requestId = 0;
+    submitMessage(message, sessionId, &requestId);
+    return requestId;
+}
+
+QFuture<QString> AIEngine::submitMessage(const QString &message, const QString &sessionId, quint64 *requestId)
+{
+    auto promise = std::make_shared<QPromise<QString>>();
+    QFuture<QString> future = promise->future();
+    promise->start();
+    
+    // Bounded queue: apply backpressure instead of piling up work
+    const int pending = pendingRequests.fetchAndAddOrdered(1);
+    if (pending >= maxPendingRequests) {
+        pendingRequests.fetchAndSubOrdered(1);
+        emit errorOccurred("Príliš veľa správ čaká na spracovanie, skúste to o chvíľu");
+        future.cancel();
+        promise->finish();
+        if (requestId) {
+            *requestId = 0;
+        }
+        return future;
+    }
+    
+    const quint64 id = registerRequest();
+    if (requestId) {
+        *requestId = id;
+    }
+    
+    // Network sources run while the request waits for and occupies a worker;
+    // the remote model gets as much history as fits next to the message
+    const int contextTokens = remoteContextTokens.loadAcquire() - ConversationStore::estimateTokens(message);
+    orchestrator->start(id, message, conversations.context(sessionId, contextTokens));
+    
+    if (pending == 0) {
+        emit statusChanged("Analyzujem správu...");
+    } else {
+        emit statusChanged(QString("Analyzujem správu... (vo fronte: %1)").arg(pending));
+    }
+    
+    workerPool->start([this, promise, message, sessionId, id]() {
+        // Cancelled while still queued: skip the work entirely
+        QString response;
+        bool completed = false;
+        if (!isCancelled(id)) {
+            emit responseStarted(id);
+            bool streamed = false;
+            response = processRequest(id, message, sessionId, &streamed);
+            completed = streamed ? !isCancelled(id) : streamResponse(id, response);
+        }
+        
+        if (completed) {
+            promise->addResult(response);
+        } else {
+            promise->future().cancel();
+        }
+        promise->finish();
+        finishStream(id);
+        
+        const int remaining = pendingRequests.fetchAndSubOrdered(1) - 1;
+        if (completed) {
+            emit responseFinished(id, response);
+            emit responseReady(response);
+        } else {
+            emit responseCancelled(id);
+        }
+        if (remaining == 0) {
+            emit statusChanged("Pripravený");
+        }
+    });
+    
+    return future;
+}
+
+void AIEngine::cancelResponse(quint64 requestId)
+{
+    QMutexLocker locker(&streamMutex);
+    if (activeRequests.contains(requestId)) {
+        cancelledRequests.insert(requestId);
     }
+    locker.unlock();
     
-    isProcessing = true;
-    currentQuery = message;
-    emit statusChanged("Analyzujem správu...");
+    orchestrator->cancel(requestId);
+}
+
+void AIEngine::setStreamChunkSize(int characters)
+{
+    streamChunkSize.storeRelease(qMax(1, characters));
+}
+
+quint64 AIEngine::registerRequest()
+{
+    const quint64 requestId = requestCounter.fetchAndAddOrdered(1) + 1;
+    QMutexLocker locker(&streamMutex);
+    activeRequests.insert(requestId);
+    return requestId;
+}
+
+bool AIEngine::isCancelled(quint64 requestId) const
+{
+    QMutexLocker locker(&streamMutex);
+    return cancelledRequests.contains(requestId);
+}
+
+void AIEngine::finishStream(quint64 requestId)
+{
+    QMutexLocker locker(&streamMutex);
+    activeRequests.remove(requestId);
+    cancelledRequests.remove(requestId);
+}
+
+bool AIEngine::streamResponse(quint64 requestId, const QString &response)
+{
+    // Chunks end at line breaks where possible so that code arrives line by line
+    const int chunkSize = streamChunkSize.loadAcquire();
+    int sequence = 0;
+    qsizetype position = 0;
     
-    // Add to context
-    context.messages.append(message);
-    if (context.messages.size() > context.contextLength) {
-        context.messages.removeFirst();
+    while (position < response.size()) {
+        if (isCancelled(requestId)) {
+            return false;
+        }
+        
+        qsizetype end = qMin(position + chunkSize, response.size());
+        if (end < response.size()) {
+            const qsizetype lineEnd = response.lastIndexOf('\n', end - 1);
+            if (lineEnd >= position) {
+                end = lineEnd + 1;
+            }
+        }
+        
+        emit responseChunk(requestId, sequence++, response.mid(position, end - position));
+        position = end;
     }
     
-    // Analyze input
-    QString analysis = analyzeInput(message);
+    return !isCancelled(requestId);
+}
+
+ResponseCacheStats AIEngine::responseCacheStats() const
+{
+    return responseCache.stats();
+}
+
+void AIEngine::setResponseCacheCapacity(int capacity)
+{
+    responseCache.setCapacity(capacity);
+}
+
+void AIEngine::setResponseMemoryLimit(qint64 bytes)
+{
+    QWriteLocker locker(&knowledgeLock);
+    knowledgeBase.responses.setMemoryLimit(bytes);
+}
+
+qint64 AIEngine::responseMemoryUsage() const
+{
+    QReadLocker locker(&knowledgeLock);
+    return knowledgeBase.responses.memoryUsage();
+}
+
+void AIEngine::setMaxPendingRequests(int limit)
+{
+    maxPendingRequests = qMax(1, limit);
+}
+
+int AIEngine::pendingRequestCount() const
+{
+    return pendingRequests.loadAcquire();
+}
+
+QString AIEngine::processRequest(quint64 requestId, const QString &message, const QString &sessionId,
+                                 bool *streamed)
+{
+    // Runs on a worker thread
+    
+    // Analyze input, reusing the speculative analysis of the draft if it matches
+    // Every stage below (and the learning module) shares one AnalyzedMessage
+    const PreparedInput prepared = takePreparedInput(message);
+    const std::shared_ptr<const AnalyzedMessage> analyzed = prepared.message;
+    QString analysis = analyzeInput(analyzed->intents());
+    {
+        QMutexLocker locker(&analysisMutex);
+        lastAnalysis = analyzed;
+    }
     
     // Generate response
-    QString response = generateResponse(message);
+    QString response = generateResponse(prepared, sessionId);
     
-    // Learn from interaction
+    // A network answer started with the request may beat a fallback phrase;
+    // the winner is what gets learned and kept in the context. A winning
+    // remote answer is passed on as it arrives.
+    const QBitArray &intents = analyzed->intents();
+    const bool confident = !prepared.learnedResponse.isEmpty()
+        || intents.testBit(IntentMatcher::GreetingIntent)
+        || intents.testBit(IntentMatcher::ProgrammingIntent)
+        || intents.testBit(IntentMatcher::CodeRequestIntent);
+    ResponseSource winner = ResponseSource::Local;
+    int sequence = 0;
+    response = orchestrator->resolve(requestId, response, confident, &winner,
+                                     [this, requestId, &sequence](const QString &chunk) {
+        emit responseChunk(requestId, sequence++, chunk);
+    });
+    *streamed = winner == ResponseSource::Remote;
+    
+    // Learn from interaction on the learning module's own thread
     if (learningModule) {
-        learningModule->learn(message, response);
+        LearningModule *module = learningModule;
+        QMetaObject::invokeMethod(module, [module, analyzed, response]() {
+            module->learn(analyzed, response);
+        }, Qt::QueuedConnection);
+    }
+    
+    // Add to the session's context
+    conversations.addTurn(sessionId, message, response);
+    
+    return response;
+}
+
+void AIEngine::prepareMessage(const QString &draft)
+{
+    // Every call supersedes the previous draft; a running job notices at its next stage
+    const quint64 ticket = speculationTicket.fetchAndAddOrdered(1) + 1;
+    const QString message = draft.trimmed();
+    
+    QMutexLocker locker(&speculationMutex);
+    if (speculation && speculation->message == message) {
+        return;
+    }
+    if (speculation) {
+        speculationCounters.discarded++;
+        speculation.reset();
+    }
+    if (message.isEmpty()) {
+        return;
+    }
+    speculationCounters.started++;
+    locker.unlock();
+    
+    speculationPool->start([this, message, ticket]() {
+        // Superseded while queued: skip the work entirely
+        std::shared_ptr<PreparedInput> prepared;
+        if (speculationTicket.loadAcquire() == ticket) {
+            prepared = std::make_shared<PreparedInput>(prepareInput(message, ticket));
+        }
+        
+        // Only a job that was never superseded has run all stages
+        QMutexLocker locker(&speculationMutex);
+        if (prepared && speculationTicket.loadAcquire() == ticket) {
+            speculation = prepared;
+        } else {
+            speculationCounters.discarded++;
+        }
+    });
+}
+
+SpeculationStats AIEngine::speculationStats() const
+{
+    QMutexLocker locker(&speculationMutex);
+    return speculationCounters;
+}
+
+QVector<AnalyzedMessage::StageTiming> AIEngine::lastAnalysisTimings() const
+{
+    QMutexLocker locker(&analysisMutex);
+    return lastAnalysis ? lastAnalysis->timings() : QVector<AnalyzedMessage::StageTiming>();
+}
+
+QString AIEngine::lastAnalysisReport() const
+{
+    QMutexLocker locker(&analysisMutex);
+    return lastAnalysis ? lastAnalysis->timingReport() : QString();
+}
+
+PreparedInput AIEngine::prepareInput(const QString &message, quint64 ticket)
+{
+    // A speculative job (ticket != 0) stops between stages once a newer draft exists
+    auto superseded = [this, ticket]() {
+        return ticket != 0 && speculationTicket.loadAcquire() != ticket;
+    };
+    
+    PreparedInput prepared;
+    prepared.message = AnalyzedMessage::create(message);
+    const AnalyzedMessage &analyzed = *prepared.message;
+    analyzed.tokens();
+    if (superseded()) {
+        return prepared;
+    }
+    
+    analyzed.intents();
+    analyzed.features(featurizer);
+    if (superseded()) {
+        return prepared;
     }
     
-    // Add to context
-    context.responses.append(response);
-    if (context.responses.size() > context.contextLength) {
-        context.responses.removeFirst();
+    // Greetings, programming and code requests are answered without a lookup
+    if (analyzed.hasIntent(IntentMatcher::GreetingIntent)
+        || analyzed.hasIntent(IntentMatcher::ProgrammingIntent)
+        || analyzed.hasIntent(IntentMatcher::CodeRequestIntent)) {
+        return prepared;
     }
+    retrieveLearnedResponse(&prepared);
     
-    isProcessing = false;
-    emit responseReady(response);
-    emit statusChanged("Pripravený");
+    // A draft without a learned answer will need the network output as well
+    if (ticket != 0 && prepared.learnedResponse.isEmpty() && !superseded()) {
+        networkOutput(analyzed);
+    }
+    return prepared;
+}
+
+PreparedInput AIEngine::takePreparedInput(const QString &message)
+{
+    // The draft is final now: a job still analysing it or an older one can stop
+    speculationTicket.fetchAndAddOrdered(1);
+    
+    QMutexLocker locker(&speculationMutex);
+    std::shared_ptr<PreparedInput> prepared;
+    prepared.swap(speculation);
+    if (prepared && prepared->message->text() != message) {
+        speculationCounters.discarded++;
+        prepared.reset();
+    }
+    if (prepared) {
+        speculationCounters.reused++;
+    }
+    locker.unlock();
+    
+    if (!prepared) {
+        return prepareInput(message);
+    }
+    
+    // Learned or invalidated knowledge since the draft: only the lookup is redone
+    if (prepared->retrieved && prepared->generation != responseCache.generation()) {
+        retrieveLearnedResponse(prepared.get());
+        locker.relock();
+        speculationCounters.refreshed++;
+    }
+    return *prepared;
+}
+
+void AIEngine::retrieveLearnedResponse(PreparedInput *prepared)
+{
+    prepared->generation = responseCache.generation();
+    prepared->learnedResponse = findBestResponse(prepared->message->tokenStrings());
+    prepared->retrieved = true;
 }
 
 void AIEngine::setNetworkManager(NetworkManager *manager)
 {
     networkManager = manager;
+    orchestrator->setNetworkManager(manager);
     if (networkManager) {
         connect(networkManager, &NetworkManager::aiResponseReady,
                 this, &AIEngine::processNetworkResponse);
     }
 }
 
+void AIEngine::setResponseBudget(int msec)
+{
+    orchestrator->setBudget(msec);
+}
+
+int AIEngine::responseBudget() const
+{
+    return orchestrator->budget();
+}
+
+SourceStats AIEngine::responseSourceStats(ResponseSource source) const
+{
+    return orchestrator->sourceStats(source);
+}
+
+void AIEngine::setRemoteContextBudget(int tokens)
+{
+    remoteContextTokens.storeRelease(qMax(0, tokens));
+}
+
+int AIEngine::remoteContextBudget() const
+{
+    return remoteContextTokens.loadAcquire();
+}
+
 void AIEngine::setLearningModule(LearningModule *module)
 {
     learningModule = module;
@@ -115,77 +548,183 @@ void AIEngine::setLearningModule(LearningModule *module)
 void AIEngine::learnFromInteraction(const QString &input, const QString &output)
 {
     // Extract patterns from the interaction
-    QStringList inputTokens = tokenize(input);
-    QStringList outputTokens = tokenize(output);
+    const TokenList inputTokenList = tokenize(input);
+    const QStringList inputTokens = inputTokenList.toStringList();
     
-    // Update knowledge base
-    for (const QString &token : inputTokens) {
-        if (!knowledgeBase.patterns.contains(token)) {
-            knowledgeBase.patterns[token] = QStringList();
-        }
-        knowledgeBase.patterns[token].append(output);
-        
-        // Update confidence
-        knowledgeBase.confidence[token] = qMin(1.0, knowledgeBase.confidence.value(token, 0.5) + 0.1);
-    }
+    // Update knowledge base; journaled under the lock so records keep its order
+    QWriteLocker locker(&knowledgeLock);
+    const int vocabularySize = knowledgeBase.vocabulary.size();
+    applyInteraction(output, inputTokens);
+    journalMutation(JournalRecord::Interaction, QStringList{output} + inputTokens);
     
-    // Simulate neural network learning
-    QVector<double> input_vector(inputSize);
-    QVector<double> target_vector(outputSize);
+    const int progress = qMin(100, static_cast<int>(knowledgeBase.confidence.size()));
+    const bool newWords = knowledgeBase.vocabulary.size() != vocabularySize;
+    locker.unlock();
     
-    // Convert text to numerical representation (simplified)
-    for (int i = 0; i < qMin(inputTokens.size(), inputSize); ++i) {
-        input_vector[i] = inputTokens[i].length() / 10.0; // Simple encoding
-    }
+    // Cached responses computed from these tokens are now stale, and so are
+    // fallbacks that a new word could correct
+    responseCache.invalidate(newWords ? inputTokens + QStringList{VocabularyDependency} : inputTokens);
     
-    for (int i = 0; i < qMin(outputTokens.size(), outputSize); ++i) {
-        target_vector[i] = outputTokens[i].length() / 10.0;
-    }
+    // Simulate neural network learning on hashed features of both texts
+    TrainingSample sample;
+    sample.input = featurizer.featurize(inputTokenList);
+    sample.target = targetFeaturizer.featurize(tokenize(output)).toDense(outputSize);
     
-    backpropagate(input_vector, target_vector);
+    // Trained later with the rest of its batch, off the request path
+    queueTrainingSample(sample);
     
-    emit learningProgressUpdated(qMin(100, static_cast<int>(knowledgeBase.confidence.size())));
+    emit learningProgressUpdated(progress);
+}
+
+void AIEngine::setTrainingBatchSize(int size)
+{
+    QMutexLocker locker(&trainingMutex);
+    batchSize = qMax(1, size);
+    if (trainingBuffer.size() >= batchSize) {
+        startTrainingBatchLocked();
+    }
+}
+
+int AIEngine::trainingBatchSize() const
+{
+    QMutexLocker locker(&trainingMutex);
+    return batchSize;
+}
+
+void AIEngine::setTrainingFlushInterval(int msec)
+{
+    if (msec > 0) {
+        trainingFlushTimer->start(msec);
+    } else {
+        trainingFlushTimer->stop();
+    }
+}
+
+int AIEngine::pendingTrainingSamples() const
+{
+    QMutexLocker locker(&trainingMutex);
+    return trainingBuffer.size();
+}
+
+void AIEngine::flushTraining()
+{
+    QMutexLocker locker(&trainingMutex);
+    if (!trainingBuffer.isEmpty()) {
+        startTrainingBatchLocked();
+    }
+}
+
+void AIEngine::waitForTraining()
+{
+    flushTraining();
+    trainingPool->waitForDone();
+}
+
+void AIEngine::queueTrainingSample(const TrainingSample &sample)
+{
+    QMutexLocker locker(&trainingMutex);
+    trainingBuffer.append(sample);
+    if (trainingBuffer.size() >= batchSize) {
+        startTrainingBatchLocked();
+    }
+}
+
+void AIEngine::startTrainingBatchLocked()
+{
+    QVector<TrainingSample> batch;
+    batch.swap(trainingBuffer);
+    trainingPool->start([this, batch]() {
+        trainBatch(batch);
+    });
 }
 
 void AIEngine::updateKnowledgeBase(const QString &topic, const QString &information)
 {
-    knowledgeBase.facts[topic] = information;
+    QWriteLocker locker(&knowledgeLock);
+    const bool newTopic = !knowledgeBase.factKeys.contains(topic);
+    applyFact(topic, information);
+    journalMutation(JournalRecord::Fact, {topic, information});
+    locker.unlock();
+    
+    // A new topic may now answer misspelled input that fell back before
+    QStringList dependencies = {FactDependencyPrefix + topic};
+    if (newTopic) {
+        dependencies.append(VocabularyDependency);
+    }
+    responseCache.invalidate(dependencies);
+    
     emit statusChanged("Vedomostná báza aktualizovaná");
 }
 
-QString AIEngine::generateResponse(const QString &input)
+QString AIEngine::generateResponse(const QString &input, const QString &sessionId)
+{
+    return generateResponse(prepareInput(input), sessionId);
+}
+
+QString AIEngine::generateResponse(const PreparedInput &prepared, const QString &sessionId)
 {
-    QString processedInput = preprocessText(input);
-    QStringList tokens = tokenize(processedInput);
+    const quint64 context = contextFingerprint(sessionId);
+    
+    QString response;
+    const QString &processedInput = prepared.message->normalizedText();
+    if (responseCache.lookup(processedInput, context, &response)) {
+        return response;
+    }
+    
+    // The lookup may be older than this call; anything invalidated since must block the insert
+    const quint64 generation = prepared.retrieved ? prepared.generation : responseCache.generation();
+    QStringList dependencies;
+    bool cacheable = true;
+    response = composeResponse(prepared, &dependencies, &cacheable);
+    
+    if (cacheable) {
+        responseCache.insert(processedInput, context, response, dependencies, generation);
+    }
+    return response;
+}
+
+QString AIEngine::composeResponse(const PreparedInput &prepared, QStringList *dependencies, bool *cacheable)
+{
+    const AnalyzedMessage &message = *prepared.message;
+    const QBitArray &intents = message.intents();
     
     // Check for greetings
-    if (processedInput.contains(QRegularExpression("(ahoj|hello|hi|čau|dobrý)"))) {
-        return knowledgeBase.facts.value("greeting", "Ahoj! Ako vám môžem pomôcť?");
+    if (intents.testBit(IntentMatcher::GreetingIntent)) {
+        dependencies->append(FactDependencyPrefix + "greeting");
+        QReadLocker locker(&knowledgeLock);
+        return knowledgeBase.facts.value("greeting", DefaultGreeting);
     }
     
     // Check for programming questions
-    if (processedInput.contains(QRegularExpression("(kód|program|funkci|trieda|class|function)"))) {
+    if (intents.testBit(IntentMatcher::ProgrammingIntent)) {
         return "Môžem vám pomôcť s programovaním! Aký typ kódu potrebujete? Špecifikujte jazyk a čo má kód robiť.";
     }
     
-    // Check for code generation requests
-    if (processedInput.contains(QRegularExpression("(vytvor|generuj|napíš|create|generate)"))) {
-        return generateCode(input);
+    // Check for code generation requests (learns and emits codeGenerated, so never cached)
+    if (intents.testBit(IntentMatcher::CodeRequestIntent)) {
+        *cacheable = false;
+        return generateCode(message.text());
     }
     
-    // Try to find best response from patterns
-    QString bestResponse = findBestResponse(input);
-    if (!bestResponse.isEmpty()) {
-        return bestResponse;
+    // Learned responses are indexed by input token
+    *dependencies = message.tokenStrings();
+    
+    // Best response from patterns (looked up while preparing the input)
+    if (!prepared.learnedResponse.isEmpty()) {
+        return prepared.learnedResponse;
     }
     
-    // Use neural network for response generation
-    QVector<double> inputVector(inputSize, 0.0);
-    for (int i = 0; i < qMin(tokens.size(), inputSize); ++i) {
-        inputVector[i] = tokens[i].length() / 10.0; // Simple text encoding
+    // Misspelled or diacritic-stripped input ("cau", "kalkulacka")
+    dependencies->append(VocabularyDependency);
+    const QString corrected = fuzzyResponse(message, dependencies);
+    if (!corrected.isEmpty()) {
+        return corrected;
     }
     
-    QVector<double> output = forwardPass(inputVector);
+    dependencies->append(NetworkDependency);
+    
+    // Use neural network for response generation (possibly computed for the draft already)
+    const QVector<double> output = networkOutput(message);
     
     // Convert neural network output to text (simplified)
     if (output[0] > 0.7) {
@@ -201,7 +740,7 @@ QString AIEngine::generateResponse(const QString &input)
 
 QString AIEngine::generateCode(const QString &description, const QString &language)
 {
-    QString lowerDesc = description.toLower();
+    const QString lowerDesc = Tokenizer::toLower(description);
     QString code;
     
     if (language == "cpp" || lowerDesc.contains("c++")) {
@@ -317,46 +856,65 @@ bool AIEngine::validateCode(const QString &code, const QString &language)
     return true;
 }
 
-void AIEngine::addToContext(const QString &message, const QString &response)
+void AIEngine::addToContext(const QString &message, const QString &response, const QString &sessionId)
 {
-    context.messages.append(message);
-    context.responses.append(response);
-    
-    if (context.messages.size() > context.contextLength) {
-        context.messages.removeFirst();
-        context.responses.removeFirst();
-    }
+    conversations.addTurn(sessionId, message, response);
 }
 
-void AIEngine::clearContext()
+void AIEngine::clearContext(const QString &sessionId)
 {
-    context.messages.clear();
-    context.responses.clear();
-    context.currentTopic.clear();
+    conversations.clear(sessionId);
 }
 
-QString AIEngine::getContextSummary()
+void AIEngine::clearAllContexts()
 {
-    QString summary = "Posledné správy:\n";
-    for (int i = 0; i < context.messages.size(); ++i) {
-        summary += QString("Používateľ: %1\nAI: %2\n\n")
-                   .arg(context.messages[i])
-                   .arg(context.responses.value(i, ""));
-    }
-    return summary;
+    conversations.clearAll();
+}
+
+QString AIEngine::getContextSummary(const QString &sessionId)
+{
+    return conversations.summary(sessionId);
+}
+
+ConversationStore &AIEngine::conversationStore()
+{
+    return conversations;
 }
 
 void AIEngine::processNetworkResponse(const QString &response)
 {
     // Process response from network (e.g., from external AI API)
-    emit responseReady("Odpoveď zo siete: " + response);
+    const quint64 id = registerRequest();
+    const QString text = "Odpoveď zo siete: " + response;
+    
+    emit responseStarted(id);
+    const bool completed = streamResponse(id, text);
+    finishStream(id);
+    
+    if (completed) {
+        emit responseFinished(id, text);
+        emit responseReady(text);
+    } else {
+        emit responseCancelled(id);
+    }
 }
 
 void AIEngine::onLearningUpdate()
 {
     // Periodic learning updates
-    if (knowledgeBase.facts.size() > 0) {
-        emit learningProgressUpdated(qMin(100, knowledgeBase.facts.size() * 5));
+    QReadLocker locker(&knowledgeLock);
+    const int factCount = knowledgeBase.facts.size();
+    locker.unlock();
+    
+    if (factCount > 0) {
+        emit learningProgressUpdated(qMin(100, factCount * 5));
+    }
+    
+    // Drop conversations that have been idle for half an hour
+    conversations.evictIdle(30 * 60 * 1000);
+    
+    if (knowledgeJournal && knowledgeJournal->needsCompaction()) {
+        saveKnowledgeBase();
     }
 }
 
@@ -365,170 +923,369 @@ void AIEngine::initializeKnowledgeBase()
     // Initialize with empty knowledge base
     knowledgeBase.facts.clear();
     knowledgeBase.patterns.clear();
+    knowledgeBase.responses.clear();
     knowledgeBase.confidence.clear();
     knowledgeBase.codeExamples.clear();
+    rebuildFuzzyIndexes();
 }
 
 void AIEngine::saveKnowledgeBase()
 {
-    QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir().mkpath(dataPath);
+    // Compaction: the snapshot covers every record journaled so far. The read
+    // lock keeps mutations (and their records) out while it is taken; the
+    // writer thread stores it and starts a fresh journal.
+    if (!knowledgeJournal) {
+        return;
+    }
     
-    QFile file(dataPath + "/knowledge.json");
-    if (file.open(QIODevice::WriteOnly)) {
-        QJsonObject json;
-        
-        // Save facts
-        QJsonObject factsObj;
-        for (auto it = knowledgeBase.facts.begin(); it != knowledgeBase.facts.end(); ++it) {
-            factsObj[it.key()] = it.value();
+    QReadLocker locker(&knowledgeLock);
+    knowledgeJournal->writeSnapshot(snapshotKnowledgeBase());
+}
+
+bool AIEngine::loadKnowledgeBase()
+{
+    if (knowledgeJournal) {
+        return true; // Already loaded; replaying again would duplicate interactions
+    }
+    
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    knowledgeJournal = std::make_unique<KnowledgeJournal>(dataPath);
+    
+    QByteArray snapshot;
+    QVector<JournalRecord> records;
+    if (!knowledgeJournal->open(&snapshot, &records)) {
+        // Leave the files alone and run from memory only
+        return false;
+    }
+    
+    if (!snapshot.isEmpty()) {
+        if (!restoreKnowledgeBase(snapshot)) {
+            initializeKnowledgeBase();
+            knowledgeJournal->close();
+            return false;
         }
-        json["facts"] = factsObj;
-        
-        // Save confidence scores
-        QJsonObject confidenceObj;
-        for (auto it = knowledgeBase.confidence.begin(); it != knowledgeBase.confidence.end(); ++it) {
-            confidenceObj[it.key()] = it.value();
+    } else if (migrateLegacyKnowledgeBase()) {
+        knowledgeJournal->writeSnapshot(snapshotKnowledgeBase());
+    }
+    rebuildFuzzyIndexes();
+    
+    // Replay what was learned after the snapshot
+    for (const JournalRecord &record : std::as_const(records)) {
+        switch (record.type) {
+        case JournalRecord::Fact:
+            if (record.fields.size() == 2) {
+                applyFact(record.fields[0], record.fields[1]);
+            }
+            break;
+        case JournalRecord::Interaction:
+            if (!record.fields.isEmpty()) {
+                applyInteraction(record.fields.first(), record.fields.mid(1));
+            }
+            break;
+        case JournalRecord::CodeExample:
+            if (record.fields.size() == 1) {
+                applyCodeExample(record.fields.first());
+            }
+            break;
         }
-        json["confidence"] = confidenceObj;
-        
-        QJsonDocument doc(json);
-        file.write(doc.toJson());
     }
+    return true;
 }
 
-void AIEngine::loadKnowledgeBase()
+bool AIEngine::migrateLegacyKnowledgeBase()
 {
+    // knowledge.json from earlier versions: facts and confidence scores only
     QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     QFile file(dataPath + "/knowledge.json");
     
-    if (file.open(QIODevice::ReadOnly)) {
-        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-        QJsonObject json = doc.object();
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    QJsonObject json = doc.object();
+    
+    // Load facts
+    QJsonObject factsObj = json["facts"].toObject();
+    for (auto it = factsObj.begin(); it != factsObj.end(); ++it) {
+        knowledgeBase.facts[it.key()] = it.value().toString();
+    }
+    
+    // Load confidence scores
+    QJsonObject confidenceObj = json["confidence"].toObject();
+    for (auto it = confidenceObj.begin(); it != confidenceObj.end(); ++it) {
+        knowledgeBase.confidence.insert(it.key(), it.value().toDouble());
+    }
+    return true;
+}
+
+QByteArray AIEngine::snapshotKnowledgeBase() const
+{
+    QByteArray snapshot;
+    QDataStream stream(&snapshot, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    
+    stream << KnowledgeSnapshotVersion
+           << knowledgeBase.facts
+           << knowledgeBase.confidence
+           << knowledgeBase.codeExamples;
+    
+    // Responses by id with their counts; the next id keeps replayed ids stable
+    const ResponseStore &responses = knowledgeBase.responses;
+    const QVector<quint32> ids = responses.ids();
+    stream << responses.nextId() << static_cast<quint32>(ids.size());
+    for (quint32 id : ids) {
+        stream << id << responses.response(id) << responses.count(id);
+    }
+    
+    // Postings keep the confidence they were indexed with, so store them as is;
+    // eviction already removed those of evicted responses
+    const QStringList tokens = knowledgeBase.patterns.tokens();
+    stream << static_cast<quint32>(tokens.size());
+    for (const QString &token : tokens) {
+        const QVector<Posting> &postings = knowledgeBase.patterns.postings(token)->postings;
+        stream << token << static_cast<quint32>(postings.size());
+        for (const Posting &posting : postings) {
+            stream << posting.docId << posting.score;
+        }
+    }
+    
+    return snapshot;
+}
+
+bool AIEngine::restoreKnowledgeBase(const QByteArray &snapshot)
+{
+    QDataStream stream(snapshot);
+    stream.setVersion(QDataStream::Qt_6_0);
+    
+    quint32 version = 0;
+    stream >> version;
+    if (version == 0 || version > KnowledgeSnapshotVersion) {
+        return false;
+    }
+    
+    initializeKnowledgeBase();
+    if (version == 1) {
+        QStringList responses;
+        stream >> knowledgeBase.facts >> responses;
+        for (int id = 0; id < responses.size(); ++id) {
+            knowledgeBase.responses.restore(static_cast<quint32>(id), responses[id], 1);
+        }
+        stream >> knowledgeBase.confidence >> knowledgeBase.codeExamples;
+    } else {
+        stream >> knowledgeBase.facts >> knowledgeBase.confidence >> knowledgeBase.codeExamples;
         
-        // Load facts
-        QJsonObject factsObj = json["facts"].toObject();
-        for (auto it = factsObj.begin(); it != factsObj.end(); ++it) {
-            knowledgeBase.facts[it.key()] = it.value().toString();
+        quint32 nextId = 0;
+        quint32 responseCount = 0;
+        stream >> nextId >> responseCount;
+        for (quint32 i = 0; i < responseCount && stream.status() == QDataStream::Ok; ++i) {
+            quint32 id = 0;
+            QString text;
+            quint32 count = 0;
+            stream >> id >> text >> count;
+            knowledgeBase.responses.restore(id, text, count);
+        }
+        knowledgeBase.responses.setNextId(nextId);
+    }
+    
+    quint32 tokenCount = 0;
+    stream >> tokenCount;
+    for (quint32 i = 0; i < tokenCount && stream.status() == QDataStream::Ok; ++i) {
+        QString token;
+        quint32 postingCount = 0;
+        stream >> token >> postingCount;
+        for (quint32 j = 0; j < postingCount && stream.status() == QDataStream::Ok; ++j) {
+            Posting posting;
+            stream >> posting.docId >> posting.score;
+            
+            // Responses restored above may have been evicted again under a smaller limit
+            if (knowledgeBase.responses.contains(posting.docId)) {
+                knowledgeBase.patterns.addPosting(token, posting.docId, posting.score);
+            }
         }
+    }
+    
+    return stream.status() == QDataStream::Ok;
+}
+
+void AIEngine::journalMutation(JournalRecord::Type type, const QStringList &fields)
+{
+    if (knowledgeJournal) {
+        knowledgeJournal->append({type, fields});
+    }
+}
+
+void AIEngine::applyInteraction(const QString &response, const QStringList &inputTokens)
+{
+    // A recurring response keeps its id, so its postings are updated in place
+    const quint32 docId = knowledgeBase.responses.intern(response);
+    
+    for (const QString &token : inputTokens) {
+        // Update confidence; a new token starts at 0.5
+        double *confidence = knowledgeBase.confidence.find(token);
+        if (!confidence) {
+            confidence = &knowledgeBase.confidence.insert(token, 0.5);
+        }
+        *confidence = qMin(1.0, *confidence + 0.1);
         
-        // Load confidence scores
-        QJsonObject confidenceObj = json["confidence"].toObject();
-        for (auto it = confidenceObj.begin(); it != confidenceObj.end(); ++it) {
-            knowledgeBase.confidence[it.key()] = it.value().toDouble();
+        // Index the response under the token with its current confidence
+        knowledgeBase.patterns.addPosting(token, docId, *confidence);
+        knowledgeBase.vocabulary.insert(token);
+    }
+}
+
+void AIEngine::applyFact(const QString &topic, const QString &information)
+{
+    knowledgeBase.facts[topic] = information;
+    knowledgeBase.factKeys.insert(topic);
+}
+
+void AIEngine::applyCodeExample(const QString &code)
+{
+    knowledgeBase.codeExamples.append(code);
+}
+
+void AIEngine::rebuildFuzzyIndexes()
+{
+    // After bulk loads; applyFact and applyInteraction keep them up to date
+    knowledgeBase.factKeys.clear();
+    for (auto it = knowledgeBase.facts.cbegin(); it != knowledgeBase.facts.cend(); ++it) {
+        knowledgeBase.factKeys.insert(it.key());
+    }
+    
+    knowledgeBase.vocabulary.clear();
+    for (int intent = 0; intent < IntentMatcher::BuiltinIntentCount; ++intent) {
+        for (const QString &keyword : IntentMatcher::shared().patterns(intent)) {
+            knowledgeBase.vocabulary.insert(keyword);
         }
     }
+    for (const QString &token : knowledgeBase.patterns.tokens()) {
+        knowledgeBase.vocabulary.insert(token);
+    }
 }
 
-QString AIEngine::analyzeInput(const QString &input)
+QString AIEngine::analyzeInput(const QBitArray &intents)
 {
-    QStringList tokens = tokenize(input);
     QString analysis = "Analýza: ";
     
     // Detect question words
-    QStringList questionWords = {"čo", "ako", "prečo", "kde", "kedy", "kto", "what", "how", "why", "where", "when", "who"};
-    for (const QString &word : questionWords) {
-        if (tokens.contains(word, Qt::CaseInsensitive)) {
-            analysis += "otázka, ";
-            break;
-        }
+    if (intents.testBit(IntentMatcher::QuestionIntent)) {
+        analysis += "otázka, ";
     }
     
     // Detect programming keywords
-    QStringList progWords = {"kód", "program", "funkcia", "trieda", "code", "function", "class"};
-    for (const QString &word : progWords) {
-        if (tokens.contains(word, Qt::CaseInsensitive)) {
-            analysis += "programovanie, ";
-            break;
-        }
+    if (intents.testBit(IntentMatcher::ProgrammingIntent)) {
+        analysis += "programovanie, ";
     }
     
     return analysis;
 }
 
-QString AIEngine::findBestResponse(const QString &input)
+QString AIEngine::findBestResponse(const QStringList &tokens)
 {
-    QStringList tokens = tokenize(input);
-    QString bestResponse;
-    double bestScore = 0.0;
+    // Top-k retrieval over the inverted index; only touched postings are scored.
+    // Eviction removes postings, so every hit is a stored response.
+    QReadLocker locker(&knowledgeLock);
+    const QVector<SearchHit> hits = knowledgeBase.patterns.topK(tokens, 1);
+    return hits.isEmpty() ? QString() : knowledgeBase.responses.response(hits.first().docId);
+}
+
+QString AIEngine::fuzzyResponse(const AnalyzedMessage &message, QStringList *dependencies)
+{
+    // Fact topics and known words within a few edits of the input words,
+    // compared without diacritics; a BK-tree lookup each, not a scan
+    const QStringList &tokens = message.tokenStrings();
+    QStringList corrected;
+    corrected.reserve(tokens.size());
+    bool changed = false;
+    QString factKey;
+    int factDistance = std::numeric_limits<int>::max();
     
+    QReadLocker locker(&knowledgeLock);
     for (const QString &token : tokens) {
-        if (knowledgeBase.patterns.contains(token)) {
-            const QStringList &responses = knowledgeBase.patterns[token];
-            for (const QString &response : responses) {
-                double score = knowledgeBase.confidence.value(token, 0.0);
-                if (score > bestScore) {
-                    bestScore = score;
-                    bestResponse = response;
-                }
-            }
+        const int tolerance = typoTolerance(token.size());
+        
+        const QVector<FuzzyMatch> topics = knowledgeBase.factKeys.search(token, tolerance, 1);
+        if (!topics.isEmpty() && topics.first().distance < factDistance) {
+            factKey = topics.first().term;
+            factDistance = topics.first().distance;
+        }
+        
+        if (knowledgeBase.vocabulary.contains(token)) {
+            corrected.append(token);
+            continue;
+        }
+        const QVector<FuzzyMatch> words = knowledgeBase.vocabulary.search(token, tolerance, 1);
+        if (words.isEmpty()) {
+            corrected.append(token);
+        } else {
+            corrected.append(words.first().term);
+            changed = true;
         }
     }
     
-    return bestResponse;
+    if (!factKey.isEmpty()) {
+        dependencies->append(FactDependencyPrefix + factKey);
+        return knowledgeBase.facts.value(factKey);
+    }
+    locker.unlock();
+    
+    if (!changed) {
+        return QString();
+    }
+    
+    // The corrected words go through the same steps as correctly spelled input
+    dependencies->append(corrected);
+    if (IntentMatcher::shared().matches(corrected.join(' '), IntentMatcher::GreetingIntent)) {
+        dependencies->append(FactDependencyPrefix + "greeting");
+        QReadLocker factLocker(&knowledgeLock);
+        return knowledgeBase.facts.value("greeting", DefaultGreeting);
+    }
+    return findBestResponse(corrected);
 }
 
 double AIEngine::calculateConfidence(const QString &input, const QString &response)
 {
-    QStringList inputTokens = tokenize(input);
+    const TokenList inputTokens = tokenize(input);
     double confidence = 0.0;
     
-    for (const QString &token : inputTokens) {
-        confidence += knowledgeBase.confidence.value(token, 0.1);
+    QReadLocker locker(&knowledgeLock);
+    for (int i = 0; i < inputTokens.size(); ++i) {
+        confidence += knowledgeBase.confidence.value(inputTokens[i], 0.1);
     }
     
     return confidence / qMax(1, inputTokens.size());
 }
 
-QStringList AIEngine::tokenize(const QString &text)
+TokenList AIEngine::tokenize(const QString &text)
+{
+    return Tokenizer::tokenize(text);
+}
+
+quint64 AIEngine::contextFingerprint(const QString &sessionId)
 {
-    return text.toLower()
-               .split(QRegularExpression("\\W+"), Qt::SkipEmptyParts);
+    // Responses do not read the turn history, only the session's topic
+    return qHash(conversations.currentTopic(sessionId));
 }
 
 QString AIEngine::preprocessText(const QString &text)
 {
-    QString processed = text.toLower();
-    
-    // Remove special characters but keep basic punctuation
-    processed.remove(QRegularExpression("[^\\w\\s\\?\\!\\.]"));
-    
-    // Normalize whitespace
-    processed = processed.simplified();
-    
-    return processed;
+    // Lowercase, keep word characters and basic punctuation, collapse whitespace
+    return Tokenizer::normalize(text);
 }
 
 void AIEngine::initializeNeuralNetwork()
 {
-    // Initialize weights with random values
-    weights.resize(hiddenSize);
-    for (int i = 0; i < hiddenSize; ++i) {
-        weights[i].resize(inputSize);
-        for (int j = 0; j < inputSize; ++j) {
-            weights[i][j] = (QRandomGenerator::global()->generateDouble() - 0.5) * 2.0;
-        }
-    }
-    
-    // Initialize biases
-    biases.resize(hiddenSize);
-    for (int i = 0; i < hiddenSize; ++i) {
-        biases[i] = (QRandomGenerator::global()->generateDouble() - 0.5) * 2.0;
-    }
+    // Single sigmoid layer, weights and biases uniform in [-1, 1]
+    network.resize({inputSize, hiddenSize});
+    network.randomize(1.0);
 }
 
-QVector<double> AIEngine::forwardPass(const QVector<double> &input)
+QVector<double> AIEngine::forwardPass(const SparseVector &input)
 {
-    QVector<double> hidden(hiddenSize);
-    
-    // Calculate hidden layer
-    for (int i = 0; i < hiddenSize; ++i) {
-        double sum = biases[i];
-        for (int j = 0; j < qMin(input.size(), inputSize); ++j) {
-            sum += weights[i][j] * input[j];
-        }
-        hidden[i] = sigmoid(sum);
-    }
+    // Calculate hidden layer; the sparse kernel only reads the columns of the non-zero features
+    const QVector<double> hidden = reducedNetwork.isEmpty() ? network.forward(input)
+                                                            : reducedNetwork.forward(input.toDense(inputSize));
     
     // Simple output layer (just take first few hidden neurons as output)
     QVector<double> output(outputSize);
@@ -539,27 +1296,142 @@ QVector<double> AIEngine::forwardPass(const QVector<double> &input)
     return output;
 }
 
-void AIEngine::backpropagate(const QVector<double> &input, const QVector<double> &target)
+QVector<double> AIEngine::networkOutput(const AnalyzedMessage &message)
+{
+    // Version read before the pass: an update racing with it leaves a stale version behind
+    return message.networkOutput(this, networkVersion.loadAcquire(), [this, &message]() {
+        const SparseVector features = message.features(featurizer);
+        QReadLocker locker(&knowledgeLock);
+        return forwardPass(features);
+    });
+}
+
+void AIEngine::trainBatch(const QVector<TrainingSample> &batch)
 {
-    // Simplified backpropagation
-    QVector<double> output = forwardPass(input);
-    double learningRate = 0.01;
+    // Runs on the training thread; the only writer of the network weights
+    const int count = batch.size();
+    const int rows = qMin(hiddenSize, outputSize); // Neurons that have a target
+    
+    QReadLocker readLocker(&knowledgeLock);
+    const DenseLayer &layer = network.layer(0);
+    
+    // Forward pass per sample; cost scales with the non-zero features
+    AlignedDoubles outputs(static_cast<std::size_t>(count) * hiddenSize);
+    for (int b = 0; b < count; ++b) {
+        layer.forwardSparse(batch[b].input, outputs.data() + static_cast<std::size_t>(b) * hiddenSize,
+                            DenseLayer::Sigmoid);
+    }
+    readLocker.unlock();
+    
+    // Calculate error (simplified delta rule)
+    AlignedDoubles deltas(static_cast<std::size_t>(count) * rows, 0.0);
+    for (int b = 0; b < count; ++b) {
+        const QVector<double> &target = batch[b].target;
+        for (int i = 0; i < rows && i < target.size(); ++i) {
+            const double output = outputs[static_cast<std::size_t>(b) * hiddenSize + i];
+            deltas[static_cast<std::size_t>(b) * rows + i] = trainingRate * (target[i] - output) * sigmoidDerivative(output);
+        }
+    }
     
-    // Calculate error and update weights (simplified)
-    for (int i = 0; i < hiddenSize && i < target.size(); ++i) {
-        double error = target[i] - output[qMin(i, output.size() - 1)];
+    // Summed gradient deltas^T * inputs; only the columns of non-zero features get entries
+    DenseLayer gradient(inputSize, rows);
+    QVector<double> biasGradient(rows, 0.0);
+    QVector<quint32> touched;
+    for (int b = 0; b < count; ++b) {
+        const double *delta = deltas.data() + static_cast<std::size_t>(b) * rows;
+        gradient.addOuterProduct(delta, batch[b].input);
+        for (int i = 0; i < rows; ++i) {
+            biasGradient[i] += delta[i];
+        }
+        touched += batch[b].input.indices;
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    
+    // Apply the batch update; readers are blocked only for the touched columns
+    QWriteLocker writeLocker(&knowledgeLock);
+    DenseLayer &trained = network.layer(0);
+    for (int i = 0; i < rows; ++i) {
+        double *row = trained.row(i);
+        const double *gradientRow = gradient.row(i);
+        for (quint32 column : std::as_const(touched)) {
+            if (column < static_cast<quint32>(inputSize)) {
+                row[column] += gradientRow[column];
+            }
+        }
+        trained.setBias(i, trained.bias(i) + biasGradient[i]);
+    }
+    const InferencePrecision precision = requestedPrecision;
+    writeLocker.unlock();
+    
+    // Requantize from the new weights; this thread is their only writer, so
+    // they can be read without the lock
+    if (precision != InferencePrecision::Double) {
+        QuantizedMlp rebuilt;
+        const InferenceParity parity = buildReducedNetwork(precision, &rebuilt);
         
-        for (int j = 0; j < qMin(input.size(), inputSize); ++j) {
-            weights[i][j] += learningRate * error * input[j] * sigmoidDerivative(output[qMin(i, output.size() - 1)]);
+        writeLocker.relock();
+        if (requestedPrecision == precision) {
+            lastParity = parity;
+            if (parity.passed()) {
+                reducedNetwork = rebuilt;
+            } else {
+                reducedNetwork.clear();
+                requestedPrecision = InferencePrecision::Double;
+            }
         }
+        writeLocker.unlock();
         
-        biases[i] += learningRate * error * sigmoidDerivative(output[qMin(i, output.size() - 1)]);
+        if (!parity.passed()) {
+            emit errorOccurred(QString("Znížená presnosť výpočtu nesedí (zhoda %1 %), "
+                                       "prepínam na double").arg(parity.thresholdAgreement * 100.0, 0, 'f', 1));
+        }
     }
+    
+    // New weights are in place: outputs memoized in messages are stale
+    networkVersion.fetchAndAddOrdered(1);
+    responseCache.invalidate(NetworkDependency);
+}
+
+bool AIEngine::setInferencePrecision(InferencePrecision precision)
+{
+    QWriteLocker locker(&knowledgeLock);
+    QuantizedMlp candidate;
+    const InferenceParity parity = buildReducedNetwork(precision, &candidate);
+    lastParity = parity;
+    
+    const bool accepted = precision == InferencePrecision::Double || parity.passed();
+    requestedPrecision = accepted ? precision : InferencePrecision::Double;
+    reducedNetwork = accepted ? candidate : QuantizedMlp();
+    locker.unlock();
+    
+    // Cached answers may sit on the other side of a threshold now
+    networkVersion.fetchAndAddOrdered(1);
+    responseCache.invalidate(NetworkDependency);
+    return accepted;
 }
 
-double AIEngine::sigmoid(double x)
+InferencePrecision AIEngine::inferencePrecision() const
 {
-    return 1.0 / (1.0 + std::exp(-x));
+    QReadLocker locker(&knowledgeLock);
+    return reducedNetwork.isEmpty() ? InferencePrecision::Double : reducedNetwork.precision();
+}
+
+InferenceParity AIEngine::inferenceParity() const
+{
+    QReadLocker locker(&knowledgeLock);
+    return lastParity;
+}
+
+InferenceParity AIEngine::buildReducedNetwork(InferencePrecision precision, QuantizedMlp *result) const
+{
+    // Quantization scales come from the live weights, parity from inputs in the engine's encoding
+    result->build(network, precision);
+    if (result->isEmpty()) {
+        return InferenceParity();
+    }
+    return QuantizedMlp::compare(network, *result, featurizer.calibrationSamples(CalibrationSamples),
+                                  ResponseThresholds);
 }
 
 double AIEngine::sigmoidDerivative(double x)
@@ -0,0 +1,183 @@
+#include "AnalyzedMessage.h"
+#include "IntentMatcher.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHashFunctions>
+
+std::shared_ptr<const AnalyzedMessage> AnalyzedMessage::create(const QString &text)
+{
+    return std::shared_ptr<const AnalyzedMessage>(new AnalyzedMessage(text));
+}
+
+AnalyzedMessage::AnalyzedMessage(const QString &text)
+    : original(text)
+{
+}
+
+const QString &AnalyzedMessage::normalizedText() const
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool ran = false;
+    std::call_once(normalizeOnce, [this, &ran]() {
+        normalized = Tokenizer::normalize(original);
+        ran = true;
+    });
+    record(NormalizeStage, ran, timer.nsecsElapsed());
+    return normalized;
+}
+
+const TokenList &AnalyzedMessage::tokens() const
+{
+    const QString &text = normalizedText();
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ran = false;
+    std::call_once(tokenizeOnce, [this, &text, &ran]() {
+        tokenList = Tokenizer::tokenize(text);
+        tokenStringList = tokenList.toStringList();
+        tokenIdList.reserve(tokenList.size());
+        for (int i = 0; i < tokenList.size(); ++i) {
+            tokenIdList.append(static_cast<quint32>(qHash(tokenList[i], 0)));
+        }
+        ran = true;
+    });
+    record(TokenizeStage, ran, timer.nsecsElapsed());
+    return tokenList;
+}
+
+const QStringList &AnalyzedMessage::tokenStrings() const
+{
+    tokens();
+    return tokenStringList;
+}
+
+const QVector<quint32> &AnalyzedMessage::tokenIds() const
+{
+    tokens();
+    return tokenIdList;
+}
+
+const QBitArray &AnalyzedMessage::intents() const
+{
+    const QString &text = normalizedText();
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ran = false;
+    std::call_once(intentOnce, [this, &text, &ran]() {
+        intentBits = IntentMatcher::shared().match(text);
+        ran = true;
+    });
+    record(IntentStage, ran, timer.nsecsElapsed());
+    return intentBits;
+}
+
+bool AnalyzedMessage::hasIntent(int intent) const
+{
+    const QBitArray &bits = intents();
+    return intent >= 0 && intent < bits.size() && bits.testBit(intent);
+}
+
+SparseVector AnalyzedMessage::features(const FeatureHasher &hasher) const
+{
+    const TokenList &list = tokens();
+    const auto key = std::make_tuple(hasher.dimensions(), static_cast<int>(hasher.hashingMode()),
+                                     hasher.ngramSize());
+
+    QElapsedTimer timer;
+    timer.start();
+    QMutexLocker locker(&mutex);
+    auto it = featureSets.find(key);
+    const bool ran = it == featureSets.end();
+    if (ran) {
+        it = featureSets.emplace(key, hasher.featurize(list)).first;
+    }
+    const SparseVector result = it->second;
+    locker.unlock();
+
+    record(FeatureStage, ran, timer.nsecsElapsed());
+    return result;
+}
+
+QVector<double> AnalyzedMessage::networkOutput(const void *owner, quint64 version,
+                                               const std::function<QVector<double>()> &compute) const
+{
+    QElapsedTimer timer;
+    timer.start();
+    {
+        QMutexLocker locker(&mutex);
+        auto it = networkOutputs.find(owner);
+        if (it != networkOutputs.end() && it->second.first == version) {
+            const QVector<double> result = it->second.second;
+            locker.unlock();
+            record(NetworkStage, false, timer.nsecsElapsed());
+            return result;
+        }
+    }
+
+    // Two threads may both compute a missing output; both runs are counted
+    const QVector<double> result = compute();
+    {
+        QMutexLocker locker(&mutex);
+        networkOutputs[owner] = {version, result};
+    }
+    record(NetworkStage, true, timer.nsecsElapsed());
+    return result;
+}
+
+QVector<AnalyzedMessage::StageTiming> AnalyzedMessage::timings() const
+{
+    QMutexLocker locker(&mutex);
+    return QVector<StageTiming>(stageTimings, stageTimings + StageCount);
+}
+
+QString AnalyzedMessage::timingReport() const
+{
+    // e.g. "tokenize 1x 2.4 us (+5 reused), intents 1x 0.9 us (+3 reused), ..."
+    const QVector<StageTiming> stages = timings();
+    QStringList parts;
+    for (int s = 0; s < StageCount; ++s) {
+        const StageTiming &timing = stages[s];
+        if (timing.runs == 0 && timing.reuses == 0) {
+            continue;
+        }
+        parts.append(QString("%1 %2x %3 us (+%4 reused)")
+                         .arg(stageName(static_cast<Stage>(s)))
+                         .arg(timing.runs)
+                         .arg(timing.nsecs / 1000.0, 0, 'f', 1)
+                         .arg(timing.reuses));
+    }
+    return parts.join(", ");
+}
+
+QString AnalyzedMessage::stageName(Stage stage)
+{
+    switch (stage) {
+    case NormalizeStage:
+        return "normalize";
+    case TokenizeStage:
+        return "tokenize";
+    case IntentStage:
+        return "intents";
+    case FeatureStage:
+        return "features";
+    case NetworkStage:
+        return "network";
+    default:
+        return QString();
+    }
+}
+
+void AnalyzedMessage::record(Stage stage, bool ran, qint64 nsecs) const
+{
+    QMutexLocker locker(&mutex);
+    StageTiming &timing = stageTimings[stage];
+    if (ran) {
+        timing.runs++;
+        timing.nsecs += nsecs;
+    } else {
+        timing.reuses++;
+    }
+}
@@ -1,4 +1,5 @@
 #include "CodeGenerator.h"
+#include "Tokenizer.h"
 #include <QtCore/QDebug>
 #include <QtCore/QFile>
 #include <QtCore/QJsonDocument>
@@ -193,13 +194,14 @@ GeneratedCode CodeGenerator::generateCode(const QString &description, const QStr
         result.isValid = validateSyntax(result.code, language);
     } else {
         // Generate using language-specific generators
-        if (language == "cpp" || description.toLower().contains("c++")) {
+        const QString lowerDesc = Tokenizer::toLower(description);
+        if (language == "cpp" || lowerDesc.contains("c++")) {
             result.code = generateCppCode(description);
             result.language = "cpp";
-        } else if (language == "python" || description.toLower().contains("python")) {
+        } else if (language == "python" || lowerDesc.contains("python")) {
             result.code = generatePythonCode(description);
             result.language = "python";
-        } else if (language == "javascript" || description.toLower().contains("javascript")) {
+        } else if (language == "javascript" || lowerDesc.contains("javascript")) {
             result.code = generateJavaScriptCode(description);
             result.language = "javascript";
         } else {
@@ -541,7 +543,7 @@ QString CodeGenerator::formatCode(const QString &code, const QString &language)
 
 CodeTemplate CodeGenerator::findBestTemplate(const QString &description, const QString &language)
 {
-    QString lowerDesc = description.toLower();
+    const QString lowerDesc = Tokenizer::toLower(description);
     CodeTemplate bestTemplate;
     double bestScore = 0.0;
     
@@ -605,7 +607,7 @@ QMap<QString, QString> CodeGenerator::extractVariables(const QString &descriptio
 
 QString CodeGenerator::generateCppCode(const QString &description)
 {
-    QString lowerDesc = description.toLower();
+    const QString lowerDesc = Tokenizer::toLower(description);
     
     if (lowerDesc.contains("hello") || lowerDesc.contains("ahoj")) {
         return "#include <iostream>\n"
@@ -629,7 +631,7 @@ QString CodeGenerator::generateCppCode(const QString &description)
 
 QString CodeGenerator::generatePythonCode(const QString &description)
 {
-    QString lowerDesc = description.toLower();
+    const QString lowerDesc = Tokenizer::toLower(description);
     
     if (lowerDesc.contains("hello") || lowerDesc.contains("ahoj")) {
         return "def main():\n"
@@ -649,7 +651,7 @@ QString CodeGenerator::generatePythonCode(const QString &description)
 
 QString CodeGenerator::generateJavaScriptCode(const QString &description)
 {
-    QString lowerDesc = description.toLower();
+    const QString lowerDesc = Tokenizer::toLower(description);
     
     if (lowerDesc.contains("hello") || lowerDesc.contains("ahoj")) {
         return "function main() {\n"
@@ -711,7 +713,7 @@ bool CodeGenerator::validateJavaScriptSyntax(const QString &code)
 QStringList CodeGenerator::identifyPatterns(const QString &description)
 {
     QStringList patterns;
-    QString lowerDesc = description.toLower();
+    const QString lowerDesc = Tokenizer::toLower(description);
     
     for (auto it = commonPatterns.begin(); it != commonPatterns.end(); ++it) {
         const QString &patternName = it.key();
@@ -0,0 +1,330 @@
+#include "ConversationStore.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QStringView>
+#include <algorithm>
+
+namespace {
+
+const QStringView SummaryHeader = u"Posledné správy:\n";
+const QStringView UserPrefix = u"Používateľ: ";
+const QStringView AiPrefix = u"\nAI: ";
+const QStringView TurnSeparator = u"\n\n";
+
+const QStringView GistHeader = u"Staršia časť konverzácie (skrátená):\n";
+const QStringView GistLinePrefix = u"- ";
+
+// Gists keep the first words of both messages
+const int GistWords = 12;
+// Gists of turns that left the ring, per session
+const int DigestCapacity = 32;
+
+// BPE vocabularies average about four characters per token on chat text;
+// every message also costs a few tokens of role markup
+const int CharactersPerToken = 4;
+const int MessageOverheadTokens = 4;
+
+QString clipWords(const QString &text, int words)
+{
+    const QString simplified = text.simplified();
+    qsizetype position = 0;
+    for (int w = 0; w < words; ++w) {
+        position = simplified.indexOf(' ', position + 1);
+        if (position < 0) {
+            return simplified;
+        }
+    }
+    return simplified.left(position) + QStringLiteral("…");
+}
+
+} // namespace
+
+QString ConversationContext::systemPrompt() const
+{
+    if (gists.isEmpty()) {
+        return QString();
+    }
+
+    QString result;
+    result.append(GistHeader);
+    for (const QString &gist : gists) {
+        result.append(GistLinePrefix);
+        result.append(gist);
+        result.append('\n');
+    }
+    return result;
+}
+
+ConversationStore::ConversationStore(int turnsPerSession, int maxSessions)
+    : turnsPerSession(qMax(1, turnsPerSession))
+    , maxSessions(qMax(1, maxSessions))
+{
+}
+
+void ConversationStore::addTurn(const QString &sessionId, const QString &message, const QString &response)
+{
+    QMutexLocker locker(&mutex);
+    Session &session = touch(sessionId);
+
+    const int capacity = session.ring.size();
+    if (session.size < capacity) {
+        session.ring[(session.head + session.size) % capacity] = storeTurn(message, response);
+        session.size++;
+    } else {
+        // Full: the oldest turn lives on as a gist and is overwritten
+        retire(session, session.ring[session.head]);
+        session.ring[session.head] = storeTurn(message, response);
+        session.head = (session.head + 1) % capacity;
+    }
+}
+
+QString ConversationStore::summary(const QString &sessionId)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!sessions.contains(sessionId)) {
+        return SummaryHeader.toString();
+    }
+    Session &session = touch(sessionId);
+
+    // Size the result once, then append in place
+    const int capacity = session.ring.size();
+    qsizetype length = SummaryHeader.size();
+    for (int i = 0; i < session.size; ++i) {
+        const ConversationTurn &turn = session.ring[(session.head + i) % capacity].turn;
+        length += UserPrefix.size() + turn.message.size() + AiPrefix.size()
+                  + turn.response.size() + TurnSeparator.size();
+    }
+
+    QString result;
+    result.reserve(length);
+    result.append(SummaryHeader);
+    for (int i = 0; i < session.size; ++i) {
+        const ConversationTurn &turn = session.ring[(session.head + i) % capacity].turn;
+        result.append(UserPrefix);
+        result.append(turn.message);
+        result.append(AiPrefix);
+        result.append(turn.response);
+        result.append(TurnSeparator);
+    }
+
+    return result;
+}
+
+QVector<ConversationTurn> ConversationStore::turns(const QString &sessionId)
+{
+    QMutexLocker locker(&mutex);
+
+    QVector<ConversationTurn> result;
+    if (!sessions.contains(sessionId)) {
+        return result;
+    }
+
+    Session &session = touch(sessionId);
+    const int capacity = session.ring.size();
+    result.reserve(session.size);
+    for (int i = 0; i < session.size; ++i) {
+        result.append(session.ring[(session.head + i) % capacity].turn);
+    }
+    return result;
+}
+
+ConversationContext ConversationStore::context(const QString &sessionId, int tokenBudget)
+{
+    QMutexLocker locker(&mutex);
+
+    ConversationContext result;
+    if (!sessions.contains(sessionId)) {
+        return result;
+    }
+
+    Session &session = touch(sessionId);
+    const int capacity = session.ring.size();
+    int remaining = qMax(0, tokenBudget);
+
+    // Newest turns verbatim while they fit
+    int i = session.size - 1;
+    for (; i >= 0; --i) {
+        const StoredTurn &stored = session.ring[(session.head + i) % capacity];
+        if (stored.tokens > remaining) {
+            break;
+        }
+        remaining -= stored.tokens;
+    }
+    const int firstVerbatim = i + 1;
+
+    // Then gists, newest first, of the remaining ring turns and of the digest;
+    // stops at the first one that does not fit so the history has no holes.
+    // Their system message header is paid for once.
+    int gistBudget = remaining - estimateTokens(GistHeader.toString()) - MessageOverheadTokens;
+    QStringList gists;
+    bool full = false;
+    for (; i >= 0 && !full; --i) {
+        const Gist &gist = session.ring[(session.head + i) % capacity].gist;
+        full = gist.tokens > gistBudget;
+        if (!full) {
+            gistBudget -= gist.tokens;
+            gists.append(gist.text);
+        }
+    }
+    int d = session.digest.size() - 1;
+    for (; d >= 0 && !full; --d) {
+        const Gist &gist = session.digest[d];
+        full = gist.tokens > gistBudget;
+        if (!full) {
+            gistBudget -= gist.tokens;
+            gists.append(gist.text);
+        }
+    }
+    if (!gists.isEmpty()) {
+        remaining = gistBudget;
+    }
+    // The loops above step past the entry that did not fit
+    result.omittedTurns = (full ? (i + 1) + 1 + (d + 1) : 0) + session.droppedTurns;
+
+    std::reverse(gists.begin(), gists.end());
+    result.gists = gists;
+    result.turns.reserve(session.size - firstVerbatim);
+    for (int t = firstVerbatim; t < session.size; ++t) {
+        result.turns.append(session.ring[(session.head + t) % capacity].turn);
+    }
+    result.tokens = qMax(0, tokenBudget) - remaining;
+    return result;
+}
+
+int ConversationStore::estimateTokens(const QString &text)
+{
+    return static_cast<int>((text.size() + CharactersPerToken - 1) / CharactersPerToken);
+}
+
+QString ConversationStore::currentTopic(const QString &sessionId)
+{
+    QMutexLocker locker(&mutex);
+    auto it = sessions.constFind(sessionId);
+    return it != sessions.constEnd() ? it->currentTopic : QString();
+}
+
+void ConversationStore::setCurrentTopic(const QString &sessionId, const QString &topic)
+{
+    QMutexLocker locker(&mutex);
+    touch(sessionId).currentTopic = topic;
+}
+
+void ConversationStore::clear(const QString &sessionId)
+{
+    QMutexLocker locker(&mutex);
+
+    auto it = sessions.find(sessionId);
+    if (it != sessions.end()) {
+        lru.erase(it->lruPosition);
+        sessions.erase(it);
+    }
+}
+
+void ConversationStore::clearAll()
+{
+    QMutexLocker locker(&mutex);
+    sessions.clear();
+    lru.clear();
+}
+
+int ConversationStore::evictIdle(qint64 maxIdleMs)
+{
+    QMutexLocker locker(&mutex);
+
+    // The LRU tail holds the longest idle sessions
+    const qint64 cutoff = QDateTime::currentMSecsSinceEpoch() - maxIdleMs;
+    int evicted = 0;
+    while (!lru.empty()) {
+        auto it = sessions.find(lru.back());
+        if (it->lastAccess > cutoff) {
+            break;
+        }
+        sessions.erase(it);
+        lru.pop_back();
+        evicted++;
+    }
+    return evicted;
+}
+
+void ConversationStore::setTurnsPerSession(int count)
+{
+    QMutexLocker locker(&mutex);
+    turnsPerSession = qMax(1, count);
+
+    // Re-linearize existing rings, keeping the newest turns
+    for (Session &session : sessions) {
+        const int capacity = session.ring.size();
+        const int kept = qMin(session.size, turnsPerSession);
+        for (int i = 0; i < session.size - kept; ++i) {
+            retire(session, session.ring[(session.head + i) % capacity]);
+        }
+        QVector<StoredTurn> ring(turnsPerSession);
+        for (int i = 0; i < kept; ++i) {
+            ring[i] = session.ring[(session.head + session.size - kept + i) % capacity];
+        }
+        session.ring = ring;
+        session.head = 0;
+        session.size = kept;
+    }
+}
+
+void ConversationStore::setMaxSessions(int limit)
+{
+    QMutexLocker locker(&mutex);
+    maxSessions = qMax(1, limit);
+    evictOverflow();
+}
+
+int ConversationStore::sessionCount() const
+{
+    QMutexLocker locker(&mutex);
+    return sessions.size();
+}
+
+ConversationStore::Session &ConversationStore::touch(const QString &sessionId)
+{
+    auto it = sessions.find(sessionId);
+    if (it == sessions.end()) {
+        lru.push_front(sessionId);
+        it = sessions.insert(sessionId, Session());
+        it->ring.resize(turnsPerSession);
+        it->lruPosition = lru.begin();
+        evictOverflow();
+        it = sessions.find(sessionId);
+    } else if (it->lruPosition != lru.begin()) {
+        lru.splice(lru.begin(), lru, it->lruPosition);
+    }
+
+    it->lastAccess = QDateTime::currentMSecsSinceEpoch();
+    return it.value();
+}
+
+void ConversationStore::evictOverflow()
+{
+    while (sessions.size() > maxSessions && !lru.empty()) {
+        sessions.remove(lru.back());
+        lru.pop_back();
+    }
+}
+
+ConversationStore::StoredTurn ConversationStore::storeTurn(const QString &message, const QString &response)
+{
+    StoredTurn stored;
+    stored.turn = {message, response};
+    stored.tokens = estimateTokens(message) + estimateTokens(response) + 2 * MessageOverheadTokens;
+
+    stored.gist.text = QString("%1%2 → AI: %3")
+                           .arg(UserPrefix, clipWords(message, GistWords), clipWords(response, GistWords));
+    stored.gist.tokens = estimateTokens(stored.gist.text) + 1;
+    return stored;
+}
+
+void ConversationStore::retire(Session &session, const StoredTurn &turn)
+{
+    session.digest.append(turn.gist);
+    if (session.digest.size() > DigestCapacity) {
+        session.digest.removeFirst();
+        session.droppedTurns++;
+    }
+}
@@ -0,0 +1,24 @@
+#include "Crc32.h"
+
+#include <QtCore/QVector>
+
+quint32 crc32(const QByteArray &data)
+{
+    static const QVector<quint32> table = []() {
+        QVector<quint32> values(256);
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            values[i] = crc;
+        }
+        return values;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (char byte : data) {
+        crc = table[(crc ^ static_cast<quint8>(byte)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,877 @@
+#include "DenseLayer.h"
+
+#include <QtCore/QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DENSE_LAYER_HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const int Lanes = 8; // Row padding in doubles: one AVX-512 register, two AVX2 registers
+const int ReducedLanes = 32; // Row padding of the float32 and int8 layers (one AVX-512 int8 step)
+const int Int8Max = 127;
+const int Int16Max = 32767;
+const qint64 Int32Max = 2147483647;
+
+using AlignedInt16s = std::vector<qint16, AlignedAllocator<qint16>>;
+
+using GemvKernel = void (*)(const double *weights, int stride, int rows, const double *input,
+                            const double *bias, double *output);
+using SigmoidKernel = void (*)(double *values, int count);
+// Reduced-precision kernels return the raw dot products, without bias
+using FloatGemvKernel = void (*)(const float *weights, int stride, int rows, const float *input,
+                                 float *output);
+using Int8GemvKernel = void (*)(const qint8 *weights, int stride, int rows, const qint16 *input,
+                                qint32 *output);
+
+void gemvScalar(const double *weights, int stride, int rows, const double *input,
+                const double *bias, double *output)
+{
+    for (int i = 0; i < rows; ++i) {
+        const double *row = weights + static_cast<std::size_t>(i) * stride;
+        double sum = 0.0;
+        for (int j = 0; j < stride; ++j) {
+            sum += row[j] * input[j];
+        }
+        output[i] = sum + bias[i];
+    }
+}
+
+void gemvFloatScalar(const float *weights, int stride, int rows, const float *input, float *output)
+{
+    for (int i = 0; i < rows; ++i) {
+        const float *row = weights + static_cast<std::size_t>(i) * stride;
+        float sum = 0.0f;
+        for (int j = 0; j < stride; ++j) {
+            sum += row[j] * input[j];
+        }
+        output[i] = sum;
+    }
+}
+
+void gemvInt8Scalar(const qint8 *weights, int stride, int rows, const qint16 *input, qint32 *output)
+{
+    for (int i = 0; i < rows; ++i) {
+        const qint8 *row = weights + static_cast<std::size_t>(i) * stride;
+        qint32 sum = 0;
+        for (int j = 0; j < stride; ++j) {
+            sum += static_cast<qint32>(row[j]) * input[j];
+        }
+        output[i] = sum;
+    }
+}
+
+void sigmoidScalar(double *values, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        values[i] = 1.0 / (1.0 + std::exp(-values[i]));
+    }
+}
+
+#ifdef DENSE_LAYER_HAS_X86_KERNELS
+// exp(x) = 2^k * exp(r) with r = x - k*ln2, |r| <= ln2/2. exp(r) uses a
+// degree-11 Taylor polynomial (relative error below 1e-15 on that range).
+// Inputs are clamped to +-708 so 2^k stays a normal double.
+const double ExpCoefficients[] = {
+    1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0,
+    1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0,
+    1.0 / 6.0, 0.5, 1.0, 1.0
+};
+const double Log2e = 1.4426950408889634;
+const double Ln2High = 0.693145751953125;
+const double Ln2Low = 1.42860682030941723212e-6;
+const double ExpLimit = 708.0;
+
+__attribute__((target("avx2,fma")))
+inline __m256d hsumQuad(__m256d a, __m256d b, __m256d c, __m256d d)
+{
+    // Lane i of the result is the horizontal sum of the i-th argument
+    const __m256d ab = _mm256_hadd_pd(a, b);
+    const __m256d cd = _mm256_hadd_pd(c, d);
+    const __m256d low = _mm256_permute2f128_pd(ab, cd, 0x20);
+    const __m256d high = _mm256_permute2f128_pd(ab, cd, 0x31);
+    return _mm256_add_pd(low, high);
+}
+
+__attribute__((target("avx2,fma")))
+inline double hsum(__m256d v)
+{
+    const __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+__attribute__((target("avx2,fma")))
+void gemvAvx2(const double *weights, int stride, int rows, const double *input,
+              const double *bias, double *output)
+{
+    int i = 0;
+    // Four rows at a time share every input load
+    for (; i + 4 <= rows; i += 4) {
+        const double *r0 = weights + static_cast<std::size_t>(i) * stride;
+        const double *r1 = r0 + stride;
+        const double *r2 = r1 + stride;
+        const double *r3 = r2 + stride;
+        __m256d s0 = _mm256_setzero_pd();
+        __m256d s1 = _mm256_setzero_pd();
+        __m256d s2 = _mm256_setzero_pd();
+        __m256d s3 = _mm256_setzero_pd();
+        for (int j = 0; j < stride; j += 4) {
+            const __m256d x = _mm256_load_pd(input + j);
+            s0 = _mm256_fmadd_pd(_mm256_load_pd(r0 + j), x, s0);
+            s1 = _mm256_fmadd_pd(_mm256_load_pd(r1 + j), x, s1);
+            s2 = _mm256_fmadd_pd(_mm256_load_pd(r2 + j), x, s2);
+            s3 = _mm256_fmadd_pd(_mm256_load_pd(r3 + j), x, s3);
+        }
+        _mm256_storeu_pd(output + i, _mm256_add_pd(hsumQuad(s0, s1, s2, s3), _mm256_loadu_pd(bias + i)));
+    }
+    for (; i < rows; ++i) {
+        const double *row = weights + static_cast<std::size_t>(i) * stride;
+        __m256d sum = _mm256_setzero_pd();
+        for (int j = 0; j < stride; j += 4) {
+            sum = _mm256_fmadd_pd(_mm256_load_pd(row + j), _mm256_load_pd(input + j), sum);
+        }
+        output[i] = hsum(sum) + bias[i];
+    }
+}
+
+__attribute__((target("avx2,fma")))
+inline __m256d expAvx2(__m256d x)
+{
+    x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-ExpLimit)), _mm256_set1_pd(ExpLimit));
+    const __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(Log2e)),
+                                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(Ln2High), x);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(Ln2Low), r);
+
+    __m256d p = _mm256_set1_pd(ExpCoefficients[0]);
+    for (int c = 1; c < 12; ++c) {
+        p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(ExpCoefficients[c]));
+    }
+
+    // 2^k: k sits in the low mantissa bits after adding 1.5 * 2^52
+    const __m256i bits = _mm256_castpd_si256(_mm256_add_pd(k, _mm256_set1_pd(6755399441055744.0)));
+    const __m256i scale = _mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(scale));
+}
+
+__attribute__((target("avx2,fma")))
+void sigmoidAvx2(double *values, int count)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d x = _mm256_loadu_pd(values + i);
+        const __m256d e = expAvx2(_mm256_sub_pd(_mm256_setzero_pd(), x));
+        _mm256_storeu_pd(values + i, _mm256_div_pd(one, _mm256_add_pd(one, e)));
+    }
+    sigmoidScalar(values + i, count - i);
+}
+
+__attribute__((target("avx512f")))
+void gemvAvx512(const double *weights, int stride, int rows, const double *input,
+                const double *bias, double *output)
+{
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        const double *r0 = weights + static_cast<std::size_t>(i) * stride;
+        const double *r1 = r0 + stride;
+        const double *r2 = r1 + stride;
+        const double *r3 = r2 + stride;
+        __m512d s0 = _mm512_setzero_pd();
+        __m512d s1 = _mm512_setzero_pd();
+        __m512d s2 = _mm512_setzero_pd();
+        __m512d s3 = _mm512_setzero_pd();
+        for (int j = 0; j < stride; j += 8) {
+            const __m512d x = _mm512_load_pd(input + j);
+            s0 = _mm512_fmadd_pd(_mm512_load_pd(r0 + j), x, s0);
+            s1 = _mm512_fmadd_pd(_mm512_load_pd(r1 + j), x, s1);
+            s2 = _mm512_fmadd_pd(_mm512_load_pd(r2 + j), x, s2);
+            s3 = _mm512_fmadd_pd(_mm512_load_pd(r3 + j), x, s3);
+        }
+        output[i] = _mm512_reduce_add_pd(s0) + bias[i];
+        output[i + 1] = _mm512_reduce_add_pd(s1) + bias[i + 1];
+        output[i + 2] = _mm512_reduce_add_pd(s2) + bias[i + 2];
+        output[i + 3] = _mm512_reduce_add_pd(s3) + bias[i + 3];
+    }
+    for (; i < rows; ++i) {
+        const double *row = weights + static_cast<std::size_t>(i) * stride;
+        __m512d sum = _mm512_setzero_pd();
+        for (int j = 0; j < stride; j += 8) {
+            sum = _mm512_fmadd_pd(_mm512_load_pd(row + j), _mm512_load_pd(input + j), sum);
+        }
+        output[i] = _mm512_reduce_add_pd(sum) + bias[i];
+    }
+}
+
+__attribute__((target("avx512f")))
+inline __m512d expAvx512(__m512d x)
+{
+    x = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(-ExpLimit)), _mm512_set1_pd(ExpLimit));
+    const __m512d k = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(Log2e)),
+                                           _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(Ln2High), x);
+    r = _mm512_fnmadd_pd(k, _mm512_set1_pd(Ln2Low), r);
+
+    __m512d p = _mm512_set1_pd(ExpCoefficients[0]);
+    for (int c = 1; c < 12; ++c) {
+        p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(ExpCoefficients[c]));
+    }
+    return _mm512_scalef_pd(p, k);
+}
+
+__attribute__((target("avx512f")))
+void sigmoidAvx512(double *values, int count)
+{
+    const __m512d one = _mm512_set1_pd(1.0);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m512d x = _mm512_loadu_pd(values + i);
+        const __m512d e = expAvx512(_mm512_sub_pd(_mm512_setzero_pd(), x));
+        _mm512_storeu_pd(values + i, _mm512_div_pd(one, _mm512_add_pd(one, e)));
+    }
+    sigmoidScalar(values + i, count - i);
+}
+
+__attribute__((target("avx2,fma")))
+inline float hsumFloat(__m256 v)
+{
+    __m128 pair = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    pair = _mm_add_ps(pair, _mm_movehl_ps(pair, pair));
+    pair = _mm_add_ss(pair, _mm_shuffle_ps(pair, pair, 0x55));
+    return _mm_cvtss_f32(pair);
+}
+
+__attribute__((target("avx2")))
+inline qint32 hsumInt32(__m256i v)
+{
+    __m128i lanes = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    lanes = _mm_add_epi32(lanes, _mm_shuffle_epi32(lanes, 0x4E));
+    lanes = _mm_add_epi32(lanes, _mm_shuffle_epi32(lanes, 0xB1));
+    return _mm_cvtsi128_si32(lanes);
+}
+
+__attribute__((target("avx2,fma")))
+void gemvFloatAvx2(const float *weights, int stride, int rows, const float *input, float *output)
+{
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        const float *r0 = weights + static_cast<std::size_t>(i) * stride;
+        const float *r1 = r0 + stride;
+        const float *r2 = r1 + stride;
+        const float *r3 = r2 + stride;
+        __m256 s0 = _mm256_setzero_ps();
+        __m256 s1 = _mm256_setzero_ps();
+        __m256 s2 = _mm256_setzero_ps();
+        __m256 s3 = _mm256_setzero_ps();
+        for (int j = 0; j < stride; j += 8) {
+            const __m256 x = _mm256_load_ps(input + j);
+            s0 = _mm256_fmadd_ps(_mm256_load_ps(r0 + j), x, s0);
+            s1 = _mm256_fmadd_ps(_mm256_load_ps(r1 + j), x, s1);
+            s2 = _mm256_fmadd_ps(_mm256_load_ps(r2 + j), x, s2);
+            s3 = _mm256_fmadd_ps(_mm256_load_ps(r3 + j), x, s3);
+        }
+        output[i] = hsumFloat(s0);
+        output[i + 1] = hsumFloat(s1);
+        output[i + 2] = hsumFloat(s2);
+        output[i + 3] = hsumFloat(s3);
+    }
+    for (; i < rows; ++i) {
+        const float *row = weights + static_cast<std::size_t>(i) * stride;
+        __m256 sum = _mm256_setzero_ps();
+        for (int j = 0; j < stride; j += 8) {
+            sum = _mm256_fmadd_ps(_mm256_load_ps(row + j), _mm256_load_ps(input + j), sum);
+        }
+        output[i] = hsumFloat(sum);
+    }
+}
+
+__attribute__((target("avx2")))
+inline __m256i madd8x16(const qint8 *weights, __m256i x, __m256i sum)
+{
+    // 16 weights widened to int16, multiplied and pairwise added into 8 int32 lanes
+    const __m256i w = _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i *>(weights)));
+    return _mm256_add_epi32(sum, _mm256_madd_epi16(w, x));
+}
+
+__attribute__((target("avx2")))
+void gemvInt8Avx2(const qint8 *weights, int stride, int rows, const qint16 *input, qint32 *output)
+{
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        const qint8 *r0 = weights + static_cast<std::size_t>(i) * stride;
+        const qint8 *r1 = r0 + stride;
+        const qint8 *r2 = r1 + stride;
+        const qint8 *r3 = r2 + stride;
+        __m256i s0 = _mm256_setzero_si256();
+        __m256i s1 = _mm256_setzero_si256();
+        __m256i s2 = _mm256_setzero_si256();
+        __m256i s3 = _mm256_setzero_si256();
+        for (int j = 0; j < stride; j += 16) {
+            const __m256i x = _mm256_load_si256(reinterpret_cast<const __m256i *>(input + j));
+            s0 = madd8x16(r0 + j, x, s0);
+            s1 = madd8x16(r1 + j, x, s1);
+            s2 = madd8x16(r2 + j, x, s2);
+            s3 = madd8x16(r3 + j, x, s3);
+        }
+        output[i] = hsumInt32(s0);
+        output[i + 1] = hsumInt32(s1);
+        output[i + 2] = hsumInt32(s2);
+        output[i + 3] = hsumInt32(s3);
+    }
+    for (; i < rows; ++i) {
+        const qint8 *row = weights + static_cast<std::size_t>(i) * stride;
+        __m256i sum = _mm256_setzero_si256();
+        for (int j = 0; j < stride; j += 16) {
+            sum = madd8x16(row + j, _mm256_load_si256(reinterpret_cast<const __m256i *>(input + j)), sum);
+        }
+        output[i] = hsumInt32(sum);
+    }
+}
+
+__attribute__((target("avx512f")))
+void gemvFloatAvx512(const float *weights, int stride, int rows, const float *input, float *output)
+{
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        const float *r0 = weights + static_cast<std::size_t>(i) * stride;
+        const float *r1 = r0 + stride;
+        const float *r2 = r1 + stride;
+        const float *r3 = r2 + stride;
+        __m512 s0 = _mm512_setzero_ps();
+        __m512 s1 = _mm512_setzero_ps();
+        __m512 s2 = _mm512_setzero_ps();
+        __m512 s3 = _mm512_setzero_ps();
+        for (int j = 0; j < stride; j += 16) {
+            const __m512 x = _mm512_load_ps(input + j);
+            s0 = _mm512_fmadd_ps(_mm512_load_ps(r0 + j), x, s0);
+            s1 = _mm512_fmadd_ps(_mm512_load_ps(r1 + j), x, s1);
+            s2 = _mm512_fmadd_ps(_mm512_load_ps(r2 + j), x, s2);
+            s3 = _mm512_fmadd_ps(_mm512_load_ps(r3 + j), x, s3);
+        }
+        output[i] = _mm512_reduce_add_ps(s0);
+        output[i + 1] = _mm512_reduce_add_ps(s1);
+        output[i + 2] = _mm512_reduce_add_ps(s2);
+        output[i + 3] = _mm512_reduce_add_ps(s3);
+    }
+    for (; i < rows; ++i) {
+        const float *row = weights + static_cast<std::size_t>(i) * stride;
+        __m512 sum = _mm512_setzero_ps();
+        for (int j = 0; j < stride; j += 16) {
+            sum = _mm512_fmadd_ps(_mm512_load_ps(row + j), _mm512_load_ps(input + j), sum);
+        }
+        output[i] = _mm512_reduce_add_ps(sum);
+    }
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline __m512i madd8x32(const qint8 *weights, __m512i x, __m512i sum)
+{
+    const __m512i w = _mm512_cvtepi8_epi16(_mm256_load_si256(reinterpret_cast<const __m256i *>(weights)));
+    return _mm512_add_epi32(sum, _mm512_madd_epi16(w, x));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void gemvInt8Avx512(const qint8 *weights, int stride, int rows, const qint16 *input, qint32 *output)
+{
+    int i = 0;
+    for (; i + 4 <= rows; i += 4) {
+        const qint8 *r0 = weights + static_cast<std::size_t>(i) * stride;
+        const qint8 *r1 = r0 + stride;
+        const qint8 *r2 = r1 + stride;
+        const qint8 *r3 = r2 + stride;
+        __m512i s0 = _mm512_setzero_si512();
+        __m512i s1 = _mm512_setzero_si512();
+        __m512i s2 = _mm512_setzero_si512();
+        __m512i s3 = _mm512_setzero_si512();
+        for (int j = 0; j < stride; j += 32) {
+            const __m512i x = _mm512_load_si512(input + j);
+            s0 = madd8x32(r0 + j, x, s0);
+            s1 = madd8x32(r1 + j, x, s1);
+            s2 = madd8x32(r2 + j, x, s2);
+            s3 = madd8x32(r3 + j, x, s3);
+        }
+        output[i] = _mm512_reduce_add_epi32(s0);
+        output[i + 1] = _mm512_reduce_add_epi32(s1);
+        output[i + 2] = _mm512_reduce_add_epi32(s2);
+        output[i + 3] = _mm512_reduce_add_epi32(s3);
+    }
+    for (; i < rows; ++i) {
+        const qint8 *row = weights + static_cast<std::size_t>(i) * stride;
+        __m512i sum = _mm512_setzero_si512();
+        for (int j = 0; j < stride; j += 32) {
+            sum = madd8x32(row + j, _mm512_load_si512(input + j), sum);
+        }
+        output[i] = _mm512_reduce_add_epi32(sum);
+    }
+}
+#endif
+
+struct Kernels {
+    GemvKernel gemv;
+    SigmoidKernel sigmoid;
+    FloatGemvKernel gemvFloat;
+    Int8GemvKernel gemvInt8;
+    const char *name;
+};
+
+Kernels selectKernels()
+{
+    Kernels selected = {gemvScalar, sigmoidScalar, gemvFloatScalar, gemvInt8Scalar, "scalar"};
+#ifdef DENSE_LAYER_HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        selected = {gemvAvx2, sigmoidAvx2, gemvFloatAvx2, gemvInt8Avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("avx512f")) {
+        selected.gemv = gemvAvx512;
+        selected.sigmoid = sigmoidAvx512;
+        selected.gemvFloat = gemvFloatAvx512;
+        selected.name = "avx512";
+        if (__builtin_cpu_supports("avx512bw")) {
+            selected.gemvInt8 = gemvInt8Avx512;
+        }
+    }
+#endif
+    return selected;
+}
+
+const Kernels &kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+int paddedLength(int length, int lanes = Lanes)
+{
+    return (length + lanes - 1) / lanes * lanes;
+}
+
+// Per-thread buffers of QuantizedMlp::forward; the network is shared read-only
+// between request threads and small enough that allocation would dominate
+struct ReducedScratch {
+    AlignedFloats floats;
+    AlignedFloats floatDots;
+    AlignedInt16s quantized;
+    std::vector<qint32> intDots;
+};
+
+ReducedScratch &reducedScratch(std::size_t length)
+{
+    thread_local ReducedScratch scratch;
+    if (scratch.floats.size() < length) {
+        scratch.floats.resize(length);
+        scratch.floatDots.resize(length);
+        scratch.quantized.resize(length);
+        scratch.intDots.resize(length);
+    }
+    return scratch;
+}
+
+// Rounds row * inverseScale to int8 so that the row keeps its sum: the
+// rounding errors cancel instead of adding up. Inputs of the hidden layers
+// are sigmoid outputs, all positive with a mean near 0.5, so a row sum that
+// is off by k steps shifts every dot product by about k/2 steps; spread
+// evenly, the error is only the per-input noise. The entries nearest to a
+// half step are the ones rounded the other way, which adds the least
+// squared error.
+void quantizeRow(const double *row, int count, double inverseScale, qint8 *target,
+                 std::vector<std::pair<double, int>> *residuals)
+{
+    residuals->clear();
+    double total = 0.0;
+    for (int j = 0; j < count; ++j) {
+        const double exact = row[j] * inverseScale;
+        const long rounded = std::lround(exact);
+        target[j] = static_cast<qint8>(rounded);
+        residuals->push_back({exact - rounded, j});
+        total += exact - rounded;
+    }
+
+    const long steps = std::lround(total);
+    if (steps == 0) {
+        return;
+    }
+    const int direction = steps > 0 ? 1 : -1;
+    // Largest residuals first when rounding up, smallest when rounding down
+    const auto first = [direction](const std::pair<double, int> &a, const std::pair<double, int> &b) {
+        return direction > 0 ? a.first > b.first : a.first < b.first;
+    };
+    std::sort(residuals->begin(), residuals->end(), first);
+    long remaining = std::abs(steps);
+    for (const std::pair<double, int> &residual : *residuals) {
+        if (remaining == 0 || residual.first * direction <= 0.0) {
+            break;
+        }
+        qint8 &value = target[residual.second];
+        if (value + direction >= -Int8Max && value + direction <= Int8Max) {
+            value = static_cast<qint8>(value + direction);
+            remaining--;
+        }
+    }
+}
+
+// Index of the first threshold above value (thresholds ascending)
+int thresholdBucket(double value, const QVector<double> &thresholds)
+{
+    return static_cast<int>(std::upper_bound(thresholds.cbegin(), thresholds.cend(), value) - thresholds.cbegin());
+}
+
+} // namespace
+
+DenseLayer::DenseLayer()
+    : inputs(0)
+    , outputs(0)
+    , rowStride(0)
+{
+}
+
+DenseLayer::DenseLayer(int inputs, int outputs)
+    : inputs(inputs)
+    , outputs(outputs)
+    , rowStride(paddedLength(inputs))
+    , weights(static_cast<std::size_t>(outputs) * paddedLength(inputs), 0.0)
+    , biases(static_cast<std::size_t>(outputs), 0.0)
+{
+}
+
+void DenseLayer::randomize(double range)
+{
+    QRandomGenerator *random = QRandomGenerator::global();
+    for (int i = 0; i < outputs; ++i) {
+        double *values = row(i);
+        for (int j = 0; j < inputs; ++j) {
+            values[j] = (random->generateDouble() - 0.5) * 2.0 * range;
+        }
+    }
+    for (int i = 0; i < outputs; ++i) {
+        biases[i] = (random->generateDouble() - 0.5) * 2.0 * range;
+    }
+}
+
+QVector<double> DenseLayer::weightsToVector() const
+{
+    QVector<double> values;
+    values.reserve(inputs * outputs);
+    for (int i = 0; i < outputs; ++i) {
+        const double *source = row(i);
+        values.append(source, inputs);
+    }
+    return values;
+}
+
+bool DenseLayer::setWeightsFromVector(const QVector<double> &values)
+{
+    if (values.size() != inputs * outputs) {
+        return false;
+    }
+    for (int i = 0; i < outputs; ++i) {
+        std::copy_n(values.constData() + i * inputs, inputs, row(i));
+    }
+    return true;
+}
+
+void DenseLayer::forward(const double *input, double *output, Activation activation) const
+{
+    if (outputs == 0) {
+        return;
+    }
+    kernels().gemv(weights.data(), rowStride, outputs, input, biases.data(), output);
+    if (activation == Sigmoid) {
+        kernels().sigmoid(output, outputs);
+    }
+}
+
+void DenseLayer::forwardSparse(const SparseVector &input, double *output, Activation activation) const
+{
+    // Rows are contiguous, so each output gathers only the non-zero columns of its row
+    const int nonZero = input.nonZeroCount();
+    const quint32 *indices = input.indices.constData();
+    const double *values = input.values.constData();
+    for (int i = 0; i < outputs; ++i) {
+        const double *weightsRow = row(i);
+        double sum = biases[i];
+        for (int k = 0; k < nonZero; ++k) {
+            if (indices[k] < static_cast<quint32>(inputs)) {
+                sum += weightsRow[indices[k]] * values[k];
+            }
+        }
+        output[i] = sum;
+    }
+    if (activation == Sigmoid) {
+        kernels().sigmoid(output, outputs);
+    }
+}
+
+void DenseLayer::addOuterProduct(const double *factors, const SparseVector &input)
+{
+    const int nonZero = input.nonZeroCount();
+    for (int i = 0; i < outputs; ++i) {
+        if (factors[i] == 0.0) {
+            continue;
+        }
+        double *weightsRow = row(i);
+        for (int k = 0; k < nonZero; ++k) {
+            if (input.indices[k] < static_cast<quint32>(inputs)) {
+                weightsRow[input.indices[k]] += factors[i] * input.values[k];
+            }
+        }
+    }
+}
+
+void DenseLayer::sigmoid(double *values, int count)
+{
+    kernels().sigmoid(values, count);
+}
+
+QString DenseLayer::kernelName()
+{
+    return QString::fromLatin1(kernels().name);
+}
+
+Mlp::Mlp(const QVector<int> &layerSizes)
+{
+    resize(layerSizes);
+}
+
+void Mlp::resize(const QVector<int> &layerSizes)
+{
+    layers.clear();
+    for (int i = 1; i < layerSizes.size(); ++i) {
+        layers.append(DenseLayer(layerSizes[i - 1], layerSizes[i]));
+    }
+}
+
+void Mlp::randomize(double range)
+{
+    for (DenseLayer &layer : layers) {
+        layer.randomize(range);
+    }
+}
+
+QVector<double> Mlp::forward(const QVector<double> &input, QVector<QVector<double>> *activations) const
+{
+    if (layers.isEmpty()) {
+        return QVector<double>();
+    }
+    if (activations) {
+        activations->clear();
+    }
+    return forwardFrom(0, input, activations);
+}
+
+QVector<double> Mlp::forward(const SparseVector &input, QVector<QVector<double>> *activations) const
+{
+    if (layers.isEmpty()) {
+        return QVector<double>();
+    }
+    if (activations) {
+        activations->clear();
+    }
+
+    QVector<double> result(layers.first().outputCount());
+    layers.first().forwardSparse(input, result.data(), DenseLayer::Sigmoid);
+    if (activations) {
+        activations->append(result);
+    }
+    return forwardFrom(1, result, activations);
+}
+
+QVector<double> Mlp::forwardFrom(int firstLayer, QVector<double> input,
+                                 QVector<QVector<double>> *activations) const
+{
+    if (firstLayer >= layers.size()) {
+        return input;
+    }
+
+    // Every layer input is copied into a zero padded aligned buffer
+    const DenseLayer &first = layers[firstLayer];
+    AlignedDoubles current(static_cast<std::size_t>(first.stride()), 0.0);
+    std::copy_n(input.constData(), qMin(static_cast<int>(input.size()), first.inputCount()), current.data());
+
+    QVector<double> result;
+    for (int l = firstLayer; l < layers.size(); ++l) {
+        const DenseLayer &layer = layers[l];
+        result = QVector<double>(layer.outputCount());
+        layer.forward(current.data(), result.data(), DenseLayer::Sigmoid);
+        if (activations) {
+            activations->append(result);
+        }
+
+        if (l + 1 < layers.size()) {
+            current.assign(static_cast<std::size_t>(layers[l + 1].stride()), 0.0);
+            std::copy(result.cbegin(), result.cend(), current.begin());
+        }
+    }
+    return result;
+}
+
+void QuantizedMlp::build(const Mlp &source, InferencePrecision precision)
+{
+    layers.clear();
+    mode = precision;
+    if (precision == InferencePrecision::Double) {
+        return;
+    }
+
+    for (int l = 0; l < source.layerCount(); ++l) {
+        const DenseLayer &dense = source.layer(l);
+        Layer layer;
+        layer.inputs = dense.inputCount();
+        layer.outputs = dense.outputCount();
+        layer.stride = paddedLength(layer.inputs, ReducedLanes);
+        layer.biases = QVector<double>(dense.biasData(), dense.biasData() + layer.outputs);
+
+        const std::size_t size = static_cast<std::size_t>(layer.outputs) * layer.stride;
+        if (precision == InferencePrecision::Float32) {
+            layer.weights.assign(size, 0.0f);
+            for (int i = 0; i < layer.outputs; ++i) {
+                std::copy_n(dense.row(i), layer.inputs,
+                            layer.weights.data() + static_cast<std::size_t>(i) * layer.stride);
+            }
+        } else {
+            // Symmetric per-row calibration: the largest weight maps to +-127
+            std::vector<std::pair<double, int>> residuals;
+            layer.values.assign(size, 0);
+            layer.scales = QVector<double>(layer.outputs, 0.0);
+            layer.activationMax = static_cast<int>(qMin<qint64>(Int16Max, Int32Max / (Int8Max * qMax(1, layer.inputs))));
+            for (int i = 0; i < layer.outputs; ++i) {
+                const double *row = dense.row(i);
+                double largest = 0.0;
+                for (int j = 0; j < layer.inputs; ++j) {
+                    largest = qMax(largest, std::abs(row[j]));
+                }
+                if (largest == 0.0) {
+                    continue;
+                }
+                const double scale = largest / Int8Max;
+                layer.scales[i] = scale;
+                qint8 *target = layer.values.data() + static_cast<std::size_t>(i) * layer.stride;
+                quantizeRow(row, layer.inputs, 1.0 / scale, target, &residuals);
+            }
+        }
+        layers.append(std::move(layer));
+    }
+}
+
+void QuantizedMlp::clear()
+{
+    layers.clear();
+    mode = InferencePrecision::Double;
+}
+
+qint64 QuantizedMlp::weightBytes() const
+{
+    qint64 bytes = 0;
+    for (const Layer &layer : layers) {
+        bytes += static_cast<qint64>(layer.weights.size()) * sizeof(float)
+               + static_cast<qint64>(layer.values.size()) * sizeof(qint8);
+    }
+    return bytes;
+}
+
+QVector<double> QuantizedMlp::forward(const QVector<double> &input, QVector<QVector<double>> *activations) const
+{
+    if (layers.isEmpty()) {
+        return QVector<double>();
+    }
+    if (activations) {
+        activations->clear();
+    }
+
+    int widest = 0;
+    for (const Layer &layer : layers) {
+        widest = qMax(widest, qMax(layer.stride, layer.outputs));
+    }
+
+    // The row padding of the scratch input is zeroed per layer
+    ReducedScratch &scratch = reducedScratch(static_cast<std::size_t>(widest));
+    AlignedFloats &floats = scratch.floats;
+    AlignedFloats &floatDots = scratch.floatDots;
+    AlignedInt16s &quantized = scratch.quantized;
+    std::vector<qint32> &intDots = scratch.intDots;
+
+    // Short inputs are zero padded, otherwise the caller's buffer is read directly
+    QVector<double> padded;
+    const double *current = input.constData();
+    if (input.size() < inputSize()) {
+        padded = QVector<double>(inputSize(), 0.0);
+        std::copy(input.cbegin(), input.cend(), padded.begin());
+        current = padded.constData();
+    }
+
+    QVector<double> result;
+    for (const Layer &layer : layers) {
+        QVector<double> next(layer.outputs);
+        if (mode == InferencePrecision::Float32) {
+            std::fill(floats.begin() + layer.inputs, floats.begin() + layer.stride, 0.0f);
+            std::copy_n(current, layer.inputs, floats.data());
+            kernels().gemvFloat(layer.weights.data(), layer.stride, layer.outputs, floats.data(), floatDots.data());
+            for (int i = 0; i < layer.outputs; ++i) {
+                next[i] = floatDots[i] + layer.biases[i];
+            }
+        } else {
+            // Activations are quantized per call with the same symmetric
+            // scheme, to the widest 16-bit range the 32-bit sums allow
+            double largest = 0.0;
+            for (int j = 0; j < layer.inputs; ++j) {
+                largest = qMax(largest, std::abs(current[j]));
+            }
+            const double inputScale = largest > 0.0 ? largest / layer.activationMax : 1.0;
+            const double inverseScale = 1.0 / inputScale;
+            std::fill(quantized.begin() + layer.inputs, quantized.begin() + layer.stride, 0);
+            for (int j = 0; j < layer.inputs; ++j) {
+                const double value = current[j] * inverseScale;
+                quantized[j] = static_cast<qint16>(value >= 0.0 ? value + 0.5 : value - 0.5);
+            }
+            kernels().gemvInt8(layer.values.data(), layer.stride, layer.outputs, quantized.data(), intDots.data());
+            for (int i = 0; i < layer.outputs; ++i) {
+                next[i] = intDots[i] * layer.scales[i] * inputScale + layer.biases[i];
+            }
+        }
+        kernels().sigmoid(next.data(), layer.outputs);
+
+        result = std::move(next);
+        current = result.constData();
+        if (activations) {
+            activations->append(result);
+        }
+    }
+    return result;
+}
+
+InferenceParity QuantizedMlp::compare(const Mlp &reference, const QuantizedMlp &candidate,
+                                      const QVector<QVector<double>> &samples,
+                                      const QVector<double> &thresholds)
+{
+    InferenceParity parity;
+    QVector<double> sorted = thresholds;
+    std::sort(sorted.begin(), sorted.end());
+
+    qint64 outputs = 0;
+    qint64 agreeing = 0;
+    double totalError = 0.0;
+    for (const QVector<double> &sample : samples) {
+        const QVector<double> expected = reference.forward(sample);
+        const QVector<double> actual = candidate.isEmpty() ? expected : candidate.forward(sample);
+        for (int i = 0; i < qMin(expected.size(), actual.size()); ++i) {
+            const double error = std::abs(expected[i] - actual[i]);
+            parity.maxAbsError = qMax(parity.maxAbsError, error);
+            totalError += error;
+            if (thresholdBucket(expected[i], sorted) == thresholdBucket(actual[i], sorted)) {
+                agreeing++;
+            }
+            outputs++;
+        }
+        parity.samples++;
+    }
+
+    if (outputs > 0) {
+        parity.meanAbsError = totalError / outputs;
+        parity.thresholdAgreement = static_cast<double>(agreeing) / outputs;
+    }
+    return parity;
+}
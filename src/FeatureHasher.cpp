@@ -0,0 +1,127 @@
+#include "FeatureHasher.h"
+
+#include <QtCore/QPair>
+#include <QtCore/QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Separate hash spaces for whole tokens and n-grams
+const quint64 TokenSeed = 0x9e3779b97f4a7c15ULL;
+const quint64 NgramSeed = 0xc2b2ae3d27d4eb4fULL;
+
+quint64 hashFeature(QStringView feature, quint64 seed)
+{
+    // FNV-1a over UTF-16 code units, then the splitmix64 finalizer
+    quint64 hash = 0xcbf29ce484222325ULL ^ seed;
+    for (QChar c : feature) {
+        hash ^= c.unicode();
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+} // namespace
+
+FeatureHasher::FeatureHasher(int dimensions, Mode mode, int ngramLength)
+    : width(qMax(1, dimensions))
+    , mode(mode)
+    , ngramLength(qMax(1, ngramLength))
+{
+}
+
+SparseVector FeatureHasher::featurize(QStringView text) const
+{
+    return featurize(Tokenizer::tokenize(text));
+}
+
+SparseVector FeatureHasher::featurize(const TokenList &tokens) const
+{
+    QVector<QPair<quint32, double>> features;
+    QString bounded;
+    for (int t = 0; t < tokens.size(); ++t) {
+        const QStringView token = tokens[t];
+        addFeature(token, TokenSeed, &features);
+
+        bounded.clear();
+        bounded.append(QLatin1Char('<'));
+        bounded.append(token);
+        bounded.append(QLatin1Char('>'));
+        const int last = qMax(0, static_cast<int>(bounded.size()) - ngramLength);
+        for (int i = 0; i <= last; ++i) {
+            addFeature(QStringView(bounded).mid(i, ngramLength), NgramSeed, &features);
+        }
+    }
+
+    // Merge repeated slots, then normalize
+    std::sort(features.begin(), features.end(),
+              [](const QPair<quint32, double> &a, const QPair<quint32, double> &b) { return a.first < b.first; });
+
+    SparseVector vector;
+    double norm = 0.0;
+    for (const auto &feature : std::as_const(features)) {
+        if (!vector.indices.isEmpty() && vector.indices.last() == feature.first) {
+            vector.values.last() += feature.second;
+        } else {
+            vector.indices.append(feature.first);
+            vector.values.append(feature.second);
+        }
+    }
+
+    // Signed collisions can cancel a slot out completely
+    int kept = 0;
+    for (int k = 0; k < vector.indices.size(); ++k) {
+        if (vector.values[k] != 0.0) {
+            vector.indices[kept] = vector.indices[k];
+            vector.values[kept] = vector.values[k];
+            norm += vector.values[k] * vector.values[k];
+            kept++;
+        }
+    }
+    vector.indices.resize(kept);
+    vector.values.resize(kept);
+
+    if (norm > 0.0) {
+        const double scale = 1.0 / std::sqrt(norm);
+        for (double &value : vector.values) {
+            value *= scale;
+        }
+    }
+    return vector;
+}
+
+QVector<QVector<double>> FeatureHasher::calibrationSamples(int count) const
+{
+    QRandomGenerator random(0x5eed);
+    QVector<QVector<double>> samples;
+    samples.reserve(count);
+
+    QString text;
+    for (int s = 0; s < count; ++s) {
+        text.clear();
+        const int words = 1 + random.bounded(20);
+        for (int w = 0; w < words; ++w) {
+            const int length = 1 + random.bounded(12);
+            for (int c = 0; c < length; ++c) {
+                text.append(QChar('a' + random.bounded(26)));
+            }
+            text.append(QLatin1Char(' '));
+        }
+        samples.append(featurize(text).toDense(width));
+    }
+    return samples;
+}
+
+void FeatureHasher::addFeature(QStringView feature, quint64 seed, QVector<QPair<quint32, double>> *features) const
+{
+    const quint64 hash = hashFeature(feature, seed);
+    const quint32 slot = static_cast<quint32>(hash % static_cast<quint64>(width));
+    const double sign = (mode == Signed && (hash >> 63)) ? -1.0 : 1.0;
+    features->append({slot, sign});
+}
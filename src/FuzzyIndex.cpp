@@ -0,0 +1,127 @@
+#include "FuzzyIndex.h"
+#include "Tokenizer.h"
+
+#include <algorithm>
+
+bool FuzzyIndex::insert(const QString &term)
+{
+    if (term.isEmpty() || terms.contains(term)) {
+        return false;
+    }
+    terms.insert(term);
+
+    const QString key = Tokenizer::fold(term);
+    if (nodes.isEmpty()) {
+        nodes.append({key, {term}, {}});
+        return true;
+    }
+
+    int current = 0;
+    for (;;) {
+        const int d = distance(key, nodes[current].key);
+        if (d == 0) {
+            nodes[current].terms.append(term);
+            return true;
+        }
+
+        int next = -1;
+        for (const Edge &edge : std::as_const(nodes[current].children)) {
+            if (edge.distance == d) {
+                next = edge.node;
+                break;
+            }
+        }
+        if (next < 0) {
+            nodes[current].children.append({d, static_cast<int>(nodes.size())});
+            nodes.append({key, {term}, {}});
+            return true;
+        }
+        current = next;
+    }
+}
+
+bool FuzzyIndex::contains(const QString &term) const
+{
+    return terms.contains(term);
+}
+
+QVector<FuzzyMatch> FuzzyIndex::search(QStringView query, int maxDistance, int limit,
+                                       FuzzySearchStats *stats) const
+{
+    QVector<FuzzyMatch> matches;
+    if (nodes.isEmpty() || limit == 0) {
+        return matches;
+    }
+
+    const QString key = Tokenizer::fold(query);
+    QVector<int> pending = {0};
+    qint64 visited = 0;
+
+    while (!pending.isEmpty()) {
+        const Node &node = nodes[pending.takeLast()];
+        visited++;
+
+        const int d = distance(key, node.key);
+        if (d <= maxDistance) {
+            for (const QString &term : node.terms) {
+                matches.append({term, d});
+            }
+        }
+
+        // Any match below a child is within maxDistance of the query, so by
+        // the triangle inequality its edge lies in [d - maxDistance, d + maxDistance]
+        for (const Edge &edge : node.children) {
+            if (edge.distance >= d - maxDistance && edge.distance <= d + maxDistance) {
+                pending.append(edge.node);
+            }
+        }
+    }
+
+    if (stats) {
+        stats->nodesVisited += visited;
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const FuzzyMatch &a, const FuzzyMatch &b) {
+        return a.distance != b.distance ? a.distance < b.distance : a.term < b.term;
+    });
+    if (limit > 0 && matches.size() > limit) {
+        matches.resize(limit);
+    }
+    return matches;
+}
+
+void FuzzyIndex::clear()
+{
+    nodes.clear();
+    terms.clear();
+}
+
+int FuzzyIndex::distance(QStringView a, QStringView b)
+{
+    // Levenshtein over UTF-16 units (folded keys are almost always ASCII),
+    // two rows, the shorter string across
+    if (a.size() < b.size()) {
+        std::swap(a, b);
+    }
+    const int columns = static_cast<int>(b.size());
+    if (columns == 0) {
+        return static_cast<int>(a.size());
+    }
+
+    QVector<int> previous(columns + 1);
+    QVector<int> current(columns + 1);
+    for (int j = 0; j <= columns; ++j) {
+        previous[j] = j;
+    }
+
+    for (int i = 1; i <= a.size(); ++i) {
+        current[0] = i;
+        const QChar ca = a[i - 1];
+        for (int j = 1; j <= columns; ++j) {
+            const int substitution = previous[j - 1] + (ca == b[j - 1] ? 0 : 1);
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, substitution});
+        }
+        std::swap(previous, current);
+    }
+    return previous[columns];
+}
@@ -0,0 +1,580 @@
+#include "HnswIndex.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace {
+
+const quint32 IndexMagic = 0x41494E48;   // "AINH"
+const quint16 FormatVersion = 1;
+const int MaxLevel = 32;
+const int MinCompaction = 64;            // Deleted nodes tolerated regardless of size
+
+struct CloserFirst {
+    bool operator()(const std::pair<float, quint32> &a, const std::pair<float, quint32> &b) const
+    {
+        return a.first < b.first;
+    }
+};
+
+struct FartherFirst {
+    bool operator()(const std::pair<float, quint32> &a, const std::pair<float, quint32> &b) const
+    {
+        return a.first > b.first;
+    }
+};
+
+float dot(const float *a, const float *b, int count)
+{
+    // Eight independent sums: not bound by the addition latency, and the
+    // compiler turns the inner loop into SIMD lanes
+    float sums[8] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        for (int lane = 0; lane < 8; ++lane) {
+            sums[lane] += a[i + lane] * b[i + lane];
+        }
+    }
+    for (; i < count; ++i) {
+        sums[0] += a[i] * b[i];
+    }
+    return ((sums[0] + sums[4]) + (sums[1] + sums[5])) + ((sums[2] + sums[6]) + (sums[3] + sums[7]));
+}
+
+} // namespace
+
+HnswIndex::HnswIndex(int dimensions, int neighbours, int buildWidth)
+    : width(qMax(1, dimensions))
+    , neighbours(qMax(2, neighbours))
+    , buildWidth(qMax(this->neighbours, buildWidth))
+    , levelFactor(1.0 / std::log(static_cast<double>(this->neighbours)))
+    , deleted(0)
+    , entryPoint(0)
+    , topLevel(-1)
+    , levelRandom(0x484e5357)
+    , visitEpoch(0)
+{
+}
+
+bool HnswIndex::insert(quint64 key, const QVector<float> &vector)
+{
+    if (vector.size() != width) {
+        return false;
+    }
+    const QVector<float> unit = normalized(vector);
+    if (unit.isEmpty()) {
+        return false;
+    }
+    remove(key);
+    insertNormalized(key, unit);
+    return true;
+}
+
+bool HnswIndex::insert(quint64 key, const SparseVector &vector)
+{
+    return insert(key, densify(vector));
+}
+
+bool HnswIndex::remove(quint64 key)
+{
+    auto it = nodeByKey.find(key);
+    if (it == nodeByKey.end()) {
+        return false;
+    }
+    nodes[it.value()].deleted = true;
+    nodeByKey.erase(it);
+    deleted++;
+
+    if (deleted >= MinCompaction && deleted > nodeByKey.size()) {
+        compact();
+    }
+    return true;
+}
+
+bool HnswIndex::contains(quint64 key) const
+{
+    return nodeByKey.contains(key);
+}
+
+QVector<NeighbourMatch> HnswIndex::search(const QVector<float> &query, int k, int searchWidth) const
+{
+    QVector<NeighbourMatch> matches;
+    if (k <= 0 || topLevel < 0 || query.size() != width || nodeByKey.isEmpty()) {
+        return matches;
+    }
+    const QVector<float> unit = normalized(query);
+    if (unit.isEmpty()) {
+        return matches;
+    }
+
+    const quint32 entry = greedyClosest(unit.constData(), entryPoint, topLevel, 1);
+    const QVector<Candidate> found = searchLevel(unit.constData(), {entry}, qMax(k, searchWidth), 0, true);
+
+    matches.reserve(qMin(k, static_cast<int>(found.size())));
+    for (int i = 0; i < found.size() && matches.size() < k; ++i) {
+        matches.append({nodes[found[i].node].key, found[i].similarity});
+    }
+    return matches;
+}
+
+QVector<NeighbourMatch> HnswIndex::search(const SparseVector &query, int k, int searchWidth) const
+{
+    return search(densify(query), k, searchWidth);
+}
+
+QVector<quint64> HnswIndex::keys() const
+{
+    QVector<quint64> result = nodeByKey.keys();
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void HnswIndex::compact()
+{
+    // Rebuild from the live vectors in their insertion order
+    std::vector<float> oldVectors;
+    std::vector<Node> oldNodes;
+    oldVectors.swap(vectors);
+    oldNodes.swap(nodes);
+    clear();
+
+    for (quint32 i = 0; i < oldNodes.size(); ++i) {
+        if (!oldNodes[i].deleted) {
+            const float *vector = oldVectors.data() + static_cast<size_t>(i) * width;
+            insertNormalized(oldNodes[i].key, QVector<float>(vector, vector + width));
+        }
+    }
+}
+
+void HnswIndex::clear()
+{
+    vectors.clear();
+    baseLinks.clear();
+    nodes.clear();
+    nodeByKey.clear();
+    deleted = 0;
+    entryPoint = 0;
+    topLevel = -1;
+    visitMarks.clear();
+    visitEpoch = 0;
+}
+
+bool HnswIndex::save(const QString &filePath, QString *error) const
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    stream << IndexMagic << FormatVersion
+           << qint32(width) << qint32(neighbours) << qint32(buildWidth)
+           << quint32(nodes.size()) << entryPoint << qint32(topLevel);
+
+    const int baseStride = maxLinks(0) + 1;
+    for (quint32 i = 0; i < nodes.size(); ++i) {
+        const Node &node = nodes[i];
+        stream << node.key << qint32(node.level) << quint8(node.deleted ? 1 : 0);
+        const float *vector = vectorOf(i);
+        for (int d = 0; d < width; ++d) {
+            stream << vector[d];
+        }
+        const quint32 *base = baseLinks.data() + static_cast<size_t>(i) * baseStride;
+        for (int s = 0; s <= static_cast<int>(base[0]); ++s) {
+            stream << base[s];
+        }
+        for (const QVector<quint32> &level : node.upperLinks) {
+            stream << level;
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+bool HnswIndex::load(const QString &filePath, QString *error)
+{
+    auto fail = [this, error](const QString &message) {
+        clear();
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint32 fileWidth = 0, fileNeighbours = 0, fileBuildWidth = 0, fileTopLevel = -1;
+    quint32 count = 0, fileEntry = 0;
+    stream >> magic >> version >> fileWidth >> fileNeighbours >> fileBuildWidth
+           >> count >> fileEntry >> fileTopLevel;
+    if (stream.status() != QDataStream::Ok || magic != IndexMagic || version != FormatVersion
+        || fileWidth < 1 || fileNeighbours < 2 || fileBuildWidth < fileNeighbours
+        || fileTopLevel < -1 || fileTopLevel > MaxLevel || (count > 0 && fileEntry >= count)
+        || (count == 0) != (fileTopLevel < 0)) {
+        return fail(QString("Neplatná hlavička indexu: %1").arg(filePath));
+    }
+
+    // Every node takes at least its key, level, flag, vector and base link
+    // count; a count the file cannot hold is not allocated for
+    const qint64 minimumNodeBytes = 8 + 4 + 1 + 4 * static_cast<qint64>(fileWidth) + 4;
+    if (static_cast<qint64>(count) > (file.size() - file.pos()) / minimumNodeBytes) {
+        return fail(QString("Neúplný index: %1").arg(filePath));
+    }
+
+    clear();
+    width = fileWidth;
+    neighbours = fileNeighbours;
+    buildWidth = fileBuildWidth;
+    levelFactor = 1.0 / std::log(static_cast<double>(neighbours));
+
+    const int baseStride = maxLinks(0) + 1;
+    vectors.resize(static_cast<size_t>(count) * width);
+    baseLinks.assign(static_cast<size_t>(count) * baseStride, 0);
+    nodes.resize(count);
+
+    for (quint32 i = 0; i < count; ++i) {
+        Node &node = nodes[i];
+        qint32 level = 0;
+        quint8 isDeleted = 0;
+        stream >> node.key >> level >> isDeleted;
+        if (level < 0 || level > fileTopLevel) {
+            return fail(QString("Poškodený index: %1").arg(filePath));
+        }
+        node.level = level;
+        node.deleted = isDeleted != 0;
+
+        float *vector = vectors.data() + static_cast<size_t>(i) * width;
+        for (int d = 0; d < width; ++d) {
+            stream >> vector[d];
+        }
+
+        quint32 *base = baseLinks.data() + static_cast<size_t>(i) * baseStride;
+        stream >> base[0];
+        if (base[0] > static_cast<quint32>(maxLinks(0))) {
+            return fail(QString("Poškodený index: %1").arg(filePath));
+        }
+        for (quint32 s = 1; s <= base[0]; ++s) {
+            stream >> base[s];
+            if (base[s] >= count) {
+                return fail(QString("Poškodený index: %1").arg(filePath));
+            }
+        }
+
+        // Read like QDataStream's QVector format, but the length is checked
+        // before anything is allocated
+        node.upperLinks.resize(level);
+        for (QVector<quint32> &links : node.upperLinks) {
+            quint32 size = 0;
+            stream >> size;
+            if (size > static_cast<quint32>(neighbours)) {
+                return fail(QString("Poškodený index: %1").arg(filePath));
+            }
+            links.resize(size);
+            for (quint32 &id : links) {
+                stream >> id;
+                if (id >= count) {
+                    return fail(QString("Poškodený index: %1").arg(filePath));
+                }
+            }
+        }
+
+        if (stream.status() != QDataStream::Ok) {
+            return fail(QString("Neúplný index: %1").arg(filePath));
+        }
+        if (node.deleted) {
+            deleted++;
+        } else if (nodeByKey.contains(node.key)) {
+            return fail(QString("Poškodený index: %1").arg(filePath));
+        } else {
+            nodeByKey.insert(node.key, i);
+        }
+    }
+
+    // Upper links may only point to nodes that exist on that level
+    for (const Node &node : nodes) {
+        for (int l = 1; l <= node.level; ++l) {
+            for (quint32 target : node.upperLinks[l - 1]) {
+                if (nodes[target].level < l) {
+                    return fail(QString("Poškodený index: %1").arg(filePath));
+                }
+            }
+        }
+    }
+    if (count > 0 && nodes[fileEntry].level != fileTopLevel) {
+        return fail(QString("Poškodený index: %1").arg(filePath));
+    }
+
+    entryPoint = fileEntry;
+    topLevel = fileTopLevel;
+    return true;
+}
+
+float HnswIndex::similarity(const float *query, quint32 node) const
+{
+    return dot(query, vectorOf(node), width);
+}
+
+int HnswIndex::linkCount(quint32 node, int level) const
+{
+    if (level == 0) {
+        return static_cast<int>(baseLinks[static_cast<size_t>(node) * (maxLinks(0) + 1)]);
+    }
+    return nodes[node].upperLinks[level - 1].size();
+}
+
+const quint32 *HnswIndex::links(quint32 node, int level) const
+{
+    if (level == 0) {
+        return baseLinks.data() + static_cast<size_t>(node) * (maxLinks(0) + 1) + 1;
+    }
+    return nodes[node].upperLinks[level - 1].constData();
+}
+
+void HnswIndex::setLinks(quint32 node, int level, const QVector<quint32> &targets)
+{
+    if (level == 0) {
+        quint32 *base = baseLinks.data() + static_cast<size_t>(node) * (maxLinks(0) + 1);
+        base[0] = static_cast<quint32>(targets.size());
+        std::copy(targets.cbegin(), targets.cend(), base + 1);
+    } else {
+        nodes[node].upperLinks[level - 1] = targets;
+    }
+}
+
+QVector<float> HnswIndex::normalized(const QVector<float> &vector) const
+{
+    const float norm = std::sqrt(dot(vector.constData(), vector.constData(), width));
+    if (!(norm > 0.0f) || !std::isfinite(norm)) {
+        return QVector<float>();
+    }
+    QVector<float> unit(vector);
+    for (float &value : unit) {
+        value /= norm;
+    }
+    return unit;
+}
+
+QVector<float> HnswIndex::densify(const SparseVector &vector) const
+{
+    QVector<float> dense(width, 0.0f);
+    for (int k = 0; k < vector.indices.size(); ++k) {
+        if (vector.indices[k] < static_cast<quint32>(width)) {
+            dense[vector.indices[k]] = static_cast<float>(vector.values[k]);
+        }
+    }
+    return dense;
+}
+
+void HnswIndex::insertNormalized(quint64 key, const QVector<float> &vector)
+{
+    const quint32 node = static_cast<quint32>(nodes.size());
+    const int level = randomLevel();
+
+    vectors.insert(vectors.end(), vector.cbegin(), vector.cend());
+    baseLinks.resize(baseLinks.size() + maxLinks(0) + 1, 0);
+    nodes.push_back({key, level, false, QVector<QVector<quint32>>(level)});
+    nodeByKey.insert(key, node);
+
+    if (topLevel < 0) {
+        entryPoint = node;
+        topLevel = level;
+        return;
+    }
+
+    connect(node, level);
+    if (level > topLevel) {
+        entryPoint = node;
+        topLevel = level;
+    }
+}
+
+void HnswIndex::connect(quint32 node, int level)
+{
+    const float *query = vectorOf(node);
+    QVector<quint32> entries{greedyClosest(query, entryPoint, topLevel, level + 1)};
+
+    for (int l = qMin(level, topLevel); l >= 0; --l) {
+        const QVector<Candidate> found = searchLevel(query, entries, buildWidth, l, false);
+        const QVector<quint32> chosen = selectNeighbours(found, neighbours);
+        setLinks(node, l, chosen);
+
+        // Back links; a full neighbour list is re-pruned with the same heuristic
+        for (quint32 neighbour : chosen) {
+            const int count = linkCount(neighbour, l);
+            const quint32 *current = links(neighbour, l);
+            QVector<quint32> updated(current, current + count);
+            updated.append(node);
+            if (updated.size() > maxLinks(l)) {
+                const float *origin = vectorOf(neighbour);
+                QVector<Candidate> ranked;
+                ranked.reserve(updated.size());
+                for (quint32 other : std::as_const(updated)) {
+                    ranked.append({similarity(origin, other), other});
+                }
+                std::sort(ranked.begin(), ranked.end(),
+                          [](const Candidate &a, const Candidate &b) { return a.similarity > b.similarity; });
+                updated = selectNeighbours(ranked, maxLinks(l));
+            }
+            setLinks(neighbour, l, updated);
+        }
+
+        entries.clear();
+        for (const Candidate &candidate : found) {
+            entries.append(candidate.node);
+        }
+    }
+}
+
+quint32 HnswIndex::greedyClosest(const float *query, quint32 entry, int fromLevel, int toLevel) const
+{
+    quint32 current = entry;
+    float best = similarity(query, current);
+    for (int l = fromLevel; l >= toLevel; --l) {
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            const int count = linkCount(current, l);
+            const quint32 *targets = links(current, l);
+            for (int i = 0; i < count; ++i) {
+                const float value = similarity(query, targets[i]);
+                if (value > best) {
+                    best = value;
+                    current = targets[i];
+                    improved = true;
+                }
+            }
+        }
+    }
+    return current;
+}
+
+QVector<HnswIndex::Candidate> HnswIndex::searchLevel(const float *query, const QVector<quint32> &entries,
+                                                      int searchWidth, int level, bool liveOnly) const
+{
+    if (visitMarks.size() < nodes.size()) {
+        visitMarks.resize(nodes.size(), 0);
+    }
+    if (++visitEpoch == 0) {
+        std::fill(visitMarks.begin(), visitMarks.end(), 0);
+        visitEpoch = 1;
+    }
+
+    // Frontier ordered best first, results ordered worst first (so the worst is dropped)
+    std::priority_queue<std::pair<float, quint32>, std::vector<std::pair<float, quint32>>, CloserFirst> frontier;
+    std::priority_queue<std::pair<float, quint32>, std::vector<std::pair<float, quint32>>, FartherFirst> results;
+    float worst = -2.0f;
+
+    for (quint32 entry : entries) {
+        if (visitMarks[entry] == visitEpoch) {
+            continue;
+        }
+        visitMarks[entry] = visitEpoch;
+        const float value = similarity(query, entry);
+        frontier.push({value, entry});
+        if (!liveOnly || !nodes[entry].deleted) {
+            results.push({value, entry});
+            if (static_cast<int>(results.size()) > searchWidth) {
+                results.pop();
+            }
+        }
+    }
+    if (!results.empty()) {
+        worst = results.top().first;
+    }
+
+    while (!frontier.empty()) {
+        const auto current = frontier.top();
+        if (static_cast<int>(results.size()) >= searchWidth && current.first < worst) {
+            break;
+        }
+        frontier.pop();
+
+        const int count = linkCount(current.second, level);
+        const quint32 *targets = links(current.second, level);
+        for (int i = 0; i < count; ++i) {
+            const quint32 next = targets[i];
+            if (visitMarks[next] == visitEpoch) {
+                continue;
+            }
+            visitMarks[next] = visitEpoch;
+
+            const float value = similarity(query, next);
+            if (static_cast<int>(results.size()) < searchWidth || value > worst) {
+                // Deleted nodes still route the search, they are just not results
+                frontier.push({value, next});
+                if (!liveOnly || !nodes[next].deleted) {
+                    results.push({value, next});
+                    if (static_cast<int>(results.size()) > searchWidth) {
+                        results.pop();
+                    }
+                    worst = results.top().first;
+                }
+            }
+        }
+    }
+
+    QVector<Candidate> found(static_cast<int>(results.size()));
+    for (int i = found.size() - 1; i >= 0; --i) {
+        found[i] = {results.top().first, results.top().second};
+        results.pop();
+    }
+    return found;
+}
+
+QVector<quint32> HnswIndex::selectNeighbours(const QVector<Candidate> &candidates, int count) const
+{
+    // Keep a candidate only if it is closer to the origin than to every kept
+    // neighbour, so the links spread out instead of piling into one cluster
+    QVector<quint32> chosen;
+    chosen.reserve(count);
+    for (const Candidate &candidate : candidates) {
+        if (chosen.size() >= count) {
+            break;
+        }
+        const float *vector = vectorOf(candidate.node);
+        bool diverse = true;
+        for (quint32 kept : std::as_const(chosen)) {
+            if (similarity(vector, kept) > candidate.similarity) {
+                diverse = false;
+                break;
+            }
+        }
+        if (diverse) {
+            chosen.append(candidate.node);
+        }
+    }
+    return chosen;
+}
+
+int HnswIndex::randomLevel()
+{
+    const double uniform = 1.0 - levelRandom.generateDouble();   // (0, 1]
+    return qMin(MaxLevel, static_cast<int>(-std::log(uniform) * levelFactor));
+}
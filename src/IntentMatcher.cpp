@@ -0,0 +1,337 @@
+#include "IntentMatcher.h"
+#include "Tokenizer.h"
+
+#include <QtCore/QChar>
+#include <QtCore/QQueue>
+
+namespace {
+
+inline char16_t foldCase(char16_t unit)
+{
+    if (unit < 0x80) {
+        return (unit >= 'A' && unit <= 'Z') ? static_cast<char16_t>(unit + 0x20) : unit;
+    }
+    return static_cast<char16_t>(QChar::toLower(static_cast<char32_t>(unit)));
+}
+
+inline bool isWordAt(QStringView text, qsizetype position)
+{
+    return position >= 0 && position < text.size()
+        && Tokenizer::isWordCharacter(text[position].unicode());
+}
+
+} // namespace
+
+IntentMatcher::IntentMatcher(bool withBuiltinIntents)
+    : retiredCount(0)
+    , mergeThreshold(256)
+{
+    mainAutomaton = build(mainPatterns);
+    deltaAutomaton = build(deltaPatterns);
+
+    if (withBuiltinIntents) {
+        installBuiltinIntents();
+    }
+}
+
+IntentMatcher &IntentMatcher::shared()
+{
+    static IntentMatcher matcher(true);
+    return matcher;
+}
+
+void IntentMatcher::installBuiltinIntents()
+{
+    registerIntent("greeting");
+    registerIntent("programming");
+    registerIntent("code_request");
+    registerIntent("question");
+    registerIntent("gratitude");
+    registerIntent("help_request");
+
+    addPatterns(GreetingIntent, {"ahoj", "hello", "hi", "čau", "dobrý"}, WholeWord);
+    // Word stems so that Slovak inflections (kódu, funkciu, triedy) match too;
+    // the English keywords stay whole words (not "classic" or "codex")
+    addPatterns(ProgrammingIntent, {"kód", "funkci", "tried"}, WordPrefix);
+    addPatterns(ProgrammingIntent, {"program", "code", "function", "class"}, WholeWord);
+    addPatterns(CodeRequestIntent, {"vytvor", "generuj", "napíš", "create", "generate"}, WordPrefix);
+    addPatterns(QuestionIntent, {"čo", "ako", "prečo", "kde", "kedy", "kto",
+                                 "what", "how", "why", "where", "when", "who"}, WholeWord);
+    addPatterns(GratitudeIntent, {"ďakujem", "thanks", "thank you", "vďaka"}, WholeWord);
+    addPatterns(HelpIntent, {"pomoc", "help", "assist"}, WholeWord);
+
+    compile();
+}
+
+int IntentMatcher::registerIntent(const QString &name)
+{
+    QWriteLocker locker(&lock);
+    const int existing = intentNames.indexOf(name);
+    if (existing >= 0) {
+        return existing;
+    }
+    intentNames.append(name);
+    return intentNames.size() - 1;
+}
+
+int IntentMatcher::intentId(const QString &name) const
+{
+    QReadLocker locker(&lock);
+    return intentNames.indexOf(name);
+}
+
+QString IntentMatcher::intentName(int id) const
+{
+    QReadLocker locker(&lock);
+    return intentNames.value(id);
+}
+
+int IntentMatcher::intentCount() const
+{
+    QReadLocker locker(&lock);
+    return intentNames.size();
+}
+
+QStringList IntentMatcher::patterns(int intentId) const
+{
+    QReadLocker locker(&lock);
+    QStringList result;
+    for (int i = 0; i < mainPatterns.size(); ++i) {
+        if (mainPatterns[i].intentId == intentId && !mainRetired[i]) {
+            result.append(mainPatterns[i].text);
+        }
+    }
+    for (const Pattern &pattern : deltaPatterns) {
+        if (pattern.intentId == intentId) {
+            result.append(pattern.text);
+        }
+    }
+    return result;
+}
+
+void IntentMatcher::addPattern(int intentId, const QString &pattern, MatchMode mode)
+{
+    addPatterns(intentId, QStringList{pattern}, mode);
+}
+
+void IntentMatcher::addPatterns(int intentId, const QStringList &patterns, MatchMode mode)
+{
+    QWriteLocker locker(&lock);
+    appendDelta(intentId, patterns, mode);
+}
+
+void IntentMatcher::setPatterns(int intentId, const QStringList &patterns, MatchMode mode)
+{
+    QWriteLocker locker(&lock);
+    retireIntent(intentId);
+    appendDelta(intentId, patterns, mode);
+}
+
+void IntentMatcher::clearPatterns(int intentId)
+{
+    QWriteLocker locker(&lock);
+    retireIntent(intentId);
+    deltaAutomaton = build(deltaPatterns);
+}
+
+void IntentMatcher::compile()
+{
+    QWriteLocker locker(&lock);
+    mergeLocked();
+}
+
+QBitArray IntentMatcher::match(QStringView text) const
+{
+    QReadLocker locker(&lock);
+    QBitArray result(intentNames.size());
+    scan(mainAutomaton, mainPatterns, &mainRetired, text, result);
+    if (!deltaPatterns.isEmpty()) {
+        scan(deltaAutomaton, deltaPatterns, nullptr, text, result);
+    }
+    return result;
+}
+
+bool IntentMatcher::matches(QStringView text, int intentId) const
+{
+    const QBitArray result = match(text);
+    return intentId >= 0 && intentId < result.size() && result.testBit(intentId);
+}
+
+void IntentMatcher::retireIntent(int intentId)
+{
+    for (int i = 0; i < mainPatterns.size(); ++i) {
+        if (mainPatterns[i].intentId == intentId && !mainRetired[i]) {
+            mainRetired[i] = true;
+            retiredCount++;
+        }
+    }
+
+    for (int i = deltaPatterns.size() - 1; i >= 0; --i) {
+        if (deltaPatterns[i].intentId == intentId) {
+            deltaPatterns.removeAt(i);
+        }
+    }
+}
+
+void IntentMatcher::appendDelta(int intentId, const QStringList &patterns, MatchMode mode)
+{
+    if (intentId < 0 || intentId >= intentNames.size()) {
+        return;
+    }
+
+    for (const QString &pattern : patterns) {
+        const QString folded = Tokenizer::toLower(pattern);
+        if (!folded.isEmpty()) {
+            deltaPatterns.append({folded, intentId, mode});
+        }
+    }
+
+    // Only the small delta is rebuilt; fold it in once it grows too large
+    if (deltaPatterns.size() > mergeThreshold || retiredCount > mainPatterns.size() / 4 + 16) {
+        mergeLocked();
+    } else {
+        deltaAutomaton = build(deltaPatterns);
+    }
+}
+
+void IntentMatcher::mergeLocked()
+{
+    QVector<Pattern> merged;
+    merged.reserve(mainPatterns.size() - retiredCount + deltaPatterns.size());
+    for (int i = 0; i < mainPatterns.size(); ++i) {
+        if (!mainRetired[i]) {
+            merged.append(mainPatterns[i]);
+        }
+    }
+    merged += deltaPatterns;
+
+    mainPatterns = merged;
+    mainRetired = QVector<bool>(mainPatterns.size(), false);
+    retiredCount = 0;
+    mainAutomaton = build(mainPatterns);
+
+    deltaPatterns.clear();
+    deltaAutomaton = build(deltaPatterns);
+}
+
+IntentMatcher::Automaton IntentMatcher::build(const QVector<Pattern> &patterns)
+{
+    Automaton automaton;
+    automaton.asciiClasses = QVector<int>(128, 0);
+
+    // Compress the alphabet to the characters that occur in patterns
+    for (const Pattern &pattern : patterns) {
+        for (QChar ch : pattern.text) {
+            const char16_t unit = ch.unicode();
+            if (unit < 0x80) {
+                if (automaton.asciiClasses[unit] == 0) {
+                    automaton.asciiClasses[unit] = automaton.alphabetSize++;
+                }
+            } else if (!automaton.charClasses.contains(unit)) {
+                automaton.charClasses.insert(unit, automaton.alphabetSize++);
+            }
+        }
+    }
+
+    const int alphabet = automaton.alphabetSize;
+    auto classOf = [&automaton](char16_t unit) {
+        return unit < 0x80 ? automaton.asciiClasses[unit] : automaton.charClasses.value(unit, 0);
+    };
+
+    // Trie
+    automaton.transitions = QVector<int>(alphabet, -1);
+    automaton.firstPattern = QVector<int>(1, -1);
+    automaton.nextPattern = QVector<int>(patterns.size(), -1);
+    int stateCount = 1;
+
+    for (int p = 0; p < patterns.size(); ++p) {
+        int state = 0;
+        for (QChar ch : patterns[p].text) {
+            const int index = state * alphabet + classOf(ch.unicode());
+            if (automaton.transitions[index] < 0) {
+                automaton.transitions[index] = stateCount++;
+                automaton.transitions.resize(stateCount * alphabet);
+                std::fill(automaton.transitions.end() - alphabet, automaton.transitions.end(), -1);
+                automaton.firstPattern.append(-1);
+            }
+            state = automaton.transitions[index];
+        }
+        automaton.nextPattern[p] = automaton.firstPattern[state];
+        automaton.firstPattern[state] = p;
+    }
+
+    // Failure links by BFS, turning the trie into a complete DFA
+    QVector<int> failure(stateCount, 0);
+    automaton.outputLink = QVector<int>(stateCount, -1);
+    QQueue<int> queue;
+
+    for (int c = 0; c < alphabet; ++c) {
+        int &target = automaton.transitions[c];
+        if (target < 0) {
+            target = 0;
+        } else {
+            failure[target] = 0;
+            queue.enqueue(target);
+        }
+    }
+
+    while (!queue.isEmpty()) {
+        const int state = queue.dequeue();
+        const int fail = failure[state];
+        automaton.outputLink[state] = automaton.firstPattern[fail] >= 0 ? fail : automaton.outputLink[fail];
+
+        for (int c = 0; c < alphabet; ++c) {
+            const int index = state * alphabet + c;
+            const int target = automaton.transitions[index];
+            if (target < 0) {
+                automaton.transitions[index] = automaton.transitions[fail * alphabet + c];
+            } else {
+                failure[target] = automaton.transitions[fail * alphabet + c];
+                queue.enqueue(target);
+            }
+        }
+    }
+
+    return automaton;
+}
+
+void IntentMatcher::scan(const Automaton &automaton, const QVector<Pattern> &patterns,
+                         const QVector<bool> *retired, QStringView text, QBitArray &result) const
+{
+    if (patterns.isEmpty()) {
+        return;
+    }
+
+    const int alphabet = automaton.alphabetSize;
+    const int *transitions = automaton.transitions.constData();
+    int state = 0;
+
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const char16_t unit = foldCase(text[i].unicode());
+        const int charClass = unit < 0x80 ? automaton.asciiClasses[unit] : automaton.charClasses.value(unit, 0);
+        state = transitions[state * alphabet + charClass];
+
+        int output = automaton.firstPattern[state] >= 0 ? state : automaton.outputLink[state];
+        for (; output >= 0; output = automaton.outputLink[output]) {
+            for (int p = automaton.firstPattern[output]; p >= 0; p = automaton.nextPattern[p]) {
+                const Pattern &pattern = patterns[p];
+                if ((retired && retired->at(p)) || result.testBit(pattern.intentId)) {
+                    continue;
+                }
+
+                const qsizetype start = i - pattern.text.size() + 1;
+                bool accepted = true;
+                if (pattern.mode != Substring) {
+                    accepted = !isWordAt(text, start - 1);
+                    if (accepted && pattern.mode == WholeWord) {
+                        accepted = !isWordAt(text, i + 1);
+                    }
+                }
+
+                if (accepted) {
+                    result.setBit(pattern.intentId);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,269 @@
+#include "InteractionHistory.h"
+#include "Crc32.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QtEndian>
+#include <QtCore/QDebug>
+
+namespace {
+
+const quint32 SegmentMagic = 0x41494B48;   // "AIKH"
+const quint16 FormatVersion = 2;            // 1 framed with CRC-16
+const int SegmentHeaderSize = 6;           // magic + version
+const int FrameHeaderSize = 8;             // payload length + CRC-32
+const quint32 MaxRecordSize = 16 * 1024 * 1024;
+const qint64 SegmentBytes = 64 * 1024 * 1024;
+const int MinimumCapacity = 16;
+
+QString segmentName(int number)
+{
+    return QString("history-%1.seg").arg(number, 6, 10, QChar('0'));
+}
+
+int segmentNumberOf(const QString &path)
+{
+    return QFileInfo(path).completeBaseName().mid(QString("history-").size()).toInt();
+}
+
+QByteArray encode(const LearningData &data)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << data.id << data.input << data.output << data.context << data.reward
+           << data.timestamp << data.category;
+    return payload;
+}
+
+bool decode(const QByteArray &payload, LearningData *data)
+{
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream >> data->id >> data->input >> data->output >> data->context >> data->reward
+           >> data->timestamp >> data->category;
+    return stream.status() == QDataStream::Ok;
+}
+
+} // namespace
+
+InteractionHistory::~InteractionHistory()
+{
+    segment.close();
+}
+
+void InteractionHistory::append(const LearningData &data)
+{
+    if (count == static_cast<int>(ring.size())) {
+        // Full: unroll into a ring twice the size. Once the caller spills at
+        // its limit the ring stops growing.
+        std::vector<LearningData> grown(ring.empty() ? MinimumCapacity : ring.size() * 2);
+        for (int i = 0; i < count; ++i) {
+            grown[i] = std::move(ring[(head + i) & (ring.size() - 1)]);
+        }
+        ring.swap(grown);
+        head = 0;
+    }
+    ring[(head + count) & (ring.size() - 1)] = data;
+    count++;
+}
+
+void InteractionHistory::spillFirst()
+{
+    if (count == 0) {
+        return;
+    }
+
+    LearningData &oldest = ring[head];
+    if (segment.isOpen()) {
+        const QByteArray payload = encode(oldest);
+        QByteArray frame;
+        QDataStream frameStream(&frame, QIODevice::WriteOnly);
+        frameStream << static_cast<quint32>(payload.size()) << crc32(payload);
+        frame.append(payload);
+
+        // Flushed right away, so forEach() sees it through the map
+        if (segment.write(frame) != frame.size() || !segment.flush()) {
+            setError(segment.errorString());
+            segment.close();
+        } else {
+            nextSpilledId = oldest.id + 1;
+            if (segment.size() >= SegmentBytes) {
+                startSegment();
+            }
+        }
+    }
+
+    oldest = LearningData();
+    head = (head + 1) & (static_cast<int>(ring.size()) - 1);
+    count--;
+}
+
+void InteractionHistory::clear()
+{
+    ring.clear();
+    head = 0;
+    count = 0;
+}
+
+bool InteractionHistory::setSpillDirectory(const QString &path)
+{
+    segment.close();
+    directory = path;
+    segmentNumber = 0;
+    nextSpilledId = 0;
+    error.clear();
+    if (directory.isEmpty()) {
+        return true;
+    }
+    if (!QDir().mkpath(directory)) {
+        setError(QString("Nedá sa vytvoriť priečinok histórie: %1").arg(directory));
+        return false;
+    }
+
+    const QStringList paths = segmentPaths();
+    if (paths.isEmpty()) {
+        return startSegment();
+    }
+
+    // Only the newest segment can end in a torn write; it also tells where to
+    // resume (older segments are consulted only if it holds no entry yet)
+    bool stopped = false;
+    bool found = false;
+    for (int i = paths.size() - 1; i >= 0 && !found; --i) {
+        const qint64 end = scanSegment(paths[i], [this, &found](const LearningData &data) {
+            nextSpilledId = data.id + 1;
+            found = true;
+            return true;
+        }, &stopped);
+        if (end < 0) {
+            setError(QString("Nečitateľný segment histórie: %1").arg(paths[i]));
+            return false;
+        }
+
+        if (i == paths.size() - 1 && end < QFileInfo(paths[i]).size()) {
+            QFile file(paths[i]);
+            qWarning() << "Segment histórie skrátený o" << (file.size() - end) << "bajtov";
+            if (!file.resize(end)) {
+                setError(file.errorString());
+                return false;
+            }
+        }
+    }
+
+    segmentNumber = segmentNumberOf(paths.last());
+    return openSegment(paths.last());
+}
+
+bool InteractionHistory::forEach(const std::function<bool(const LearningData &)> &visitor) const
+{
+    for (const QString &path : segmentPaths()) {
+        bool stopped = false;
+        scanSegment(path, visitor, &stopped);
+        if (stopped) {
+            return false;
+        }
+    }
+    for (const LearningData &data : *this) {
+        if (!visitor(data)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QStringList InteractionHistory::segmentPaths() const
+{
+    QStringList paths;
+    if (directory.isEmpty()) {
+        return paths;
+    }
+    const QDir dir(directory);
+    // Zero-padded numbers, so name order is age order
+    for (const QString &name : dir.entryList({"history-*.seg"}, QDir::Files, QDir::Name)) {
+        paths.append(dir.filePath(name));
+    }
+    return paths;
+}
+
+bool InteractionHistory::openSegment(const QString &path)
+{
+    segment.close();
+    segment.setFileName(path);
+    if (!segment.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        setError(segment.errorString());
+        return false;
+    }
+
+    if (segment.size() < SegmentHeaderSize) {
+        segment.resize(0);
+        QDataStream stream(&segment);
+        stream << SegmentMagic << FormatVersion;
+        if (!segment.flush()) {
+            setError(segment.errorString());
+            segment.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InteractionHistory::startSegment()
+{
+    return openSegment(QDir(directory).filePath(segmentName(++segmentNumber)));
+}
+
+qint64 InteractionHistory::scanSegment(const QString &path,
+                                       const std::function<bool(const LearningData &)> &visitor,
+                                       bool *stopped) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const qint64 size = file.size();
+    if (size < SegmentHeaderSize) {
+        return 0; // Created but its header never made it to disk
+    }
+
+    uchar *data = file.map(0, size);
+    if (!data) {
+        return -1;
+    }
+    if (qFromBigEndian<quint32>(data) != SegmentMagic || qFromBigEndian<quint16>(data + 4) != FormatVersion) {
+        file.unmap(data);
+        return -1;
+    }
+
+    // Payloads are decoded straight from the mapping, without copying the file
+    qint64 position = SegmentHeaderSize;
+    while (size - position >= FrameHeaderSize) {
+        const quint32 length = qFromBigEndian<quint32>(data + position);
+        const quint32 checksum = qFromBigEndian<quint32>(data + position + 4);
+        if (length > MaxRecordSize || length > size - position - FrameHeaderSize) {
+            break;
+        }
+
+        const QByteArray payload = QByteArray::fromRawData(
+            reinterpret_cast<const char *>(data + position + FrameHeaderSize), length);
+        LearningData entry;
+        if (crc32(payload) != checksum || !decode(payload, &entry)) {
+            break;
+        }
+        position += FrameHeaderSize + length;
+
+        if (!visitor(entry)) {
+            *stopped = true;
+            break;
+        }
+    }
+
+    file.unmap(data);
+    return position;
+}
+
+void InteractionHistory::setError(const QString &message)
+{
+    qWarning() << "História interakcií:" << message;
+    error = message;
+}
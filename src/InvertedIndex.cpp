@@ -0,0 +1,251 @@
+#include "InvertedIndex.h"
+
+#include <QtCore/QSet>
+#include <algorithm>
+
+namespace {
+
+struct ListCursor {
+    const PostingList *list;
+    int position;
+};
+
+// Heap order: the worst hit sits on top. On equal scores the later document
+// is considered worse so that older responses win ties.
+bool betterHit(const SearchHit &a, const SearchHit &b)
+{
+    if (a.score != b.score) {
+        return a.score > b.score;
+    }
+    return a.docId < b.docId;
+}
+
+} // namespace
+
+InvertedIndex::InvertedIndex()
+    : totalPostings(0)
+{
+}
+
+void InvertedIndex::addPosting(const QString &token, quint32 docId, double score)
+{
+    auto term = terms.find(token);
+    if (term == terms.end()) {
+        term = terms.insert(token, PostingList());
+    }
+    PostingList &list = term.value();
+    const float postingScore = static_cast<float>(score);
+
+    if (list.postings.isEmpty() || list.postings.last().docId < docId) {
+        list.postings.append({docId, postingScore});
+        documentTerms[docId].append(term.key());
+        totalPostings++;
+    } else {
+        // Out-of-order or repeated document: keep the list sorted by docId
+        auto it = std::lower_bound(list.postings.begin(), list.postings.end(), docId,
+                                   [](const Posting &p, quint32 id) { return p.docId < id; });
+        if (it != list.postings.end() && it->docId == docId) {
+            it->score = qMax(it->score, postingScore);
+        } else {
+            list.postings.insert(it, {docId, postingScore});
+            documentTerms[docId].append(term.key());
+            totalPostings++;
+        }
+    }
+
+    list.maxScore = qMax(list.maxScore, postingScore);
+}
+
+QVector<SearchHit> InvertedIndex::topK(const QStringList &queryTokens, int k,
+                                       SearchStats *stats) const
+{
+    QVector<SearchHit> heap;
+    if (k <= 0) {
+        return heap;
+    }
+
+    // Collect one cursor per distinct query token
+    QVector<ListCursor> cursors;
+    QSet<QString> seen;
+    for (const QString &token : queryTokens) {
+        if (seen.contains(token)) {
+            continue;
+        }
+        seen.insert(token);
+
+        auto it = terms.constFind(token);
+        if (it != terms.constEnd() && !it->postings.isEmpty()) {
+            cursors.append({&it.value(), 0});
+        }
+    }
+
+    if (cursors.isEmpty()) {
+        return heap;
+    }
+
+    // Order lists by their score upper bound and precompute prefix sums
+    std::sort(cursors.begin(), cursors.end(), [](const ListCursor &a, const ListCursor &b) {
+        return a.list->maxScore < b.list->maxScore;
+    });
+
+    const int listCount = cursors.size();
+    QVector<double> upperBound(listCount);
+    double runningBound = 0.0;
+    for (int i = 0; i < listCount; ++i) {
+        runningBound += cursors[i].list->maxScore;
+        upperBound[i] = runningBound;
+    }
+
+    heap.reserve(k + 1);
+    double threshold = 0.0;
+    int firstEssential = 0;
+    qint64 visited = 0;
+
+    while (firstEssential < listCount) {
+        // Next candidate is the smallest docId among essential lists
+        quint32 candidate = 0;
+        bool found = false;
+        for (int i = firstEssential; i < listCount; ++i) {
+            const ListCursor &cursor = cursors[i];
+            if (cursor.position < cursor.list->postings.size()) {
+                const quint32 docId = cursor.list->postings[cursor.position].docId;
+                if (!found || docId < candidate) {
+                    candidate = docId;
+                    found = true;
+                }
+            }
+        }
+        if (!found) {
+            break;
+        }
+
+        double score = 0.0;
+        for (int i = firstEssential; i < listCount; ++i) {
+            ListCursor &cursor = cursors[i];
+            if (cursor.position < cursor.list->postings.size()
+                && cursor.list->postings[cursor.position].docId == candidate) {
+                score += cursor.list->postings[cursor.position].score;
+                cursor.position++;
+                visited++;
+            }
+        }
+
+        // Probe non-essential lists while the candidate can still qualify
+        const bool heapFull = heap.size() == k;
+        for (int i = firstEssential - 1; i >= 0; --i) {
+            if (heapFull && score + upperBound[i] <= threshold) {
+                break;
+            }
+
+            ListCursor &cursor = cursors[i];
+            const QVector<Posting> &postings = cursor.list->postings;
+            auto it = std::lower_bound(postings.begin() + cursor.position, postings.end(), candidate,
+                                       [](const Posting &p, quint32 id) { return p.docId < id; });
+            cursor.position = static_cast<int>(it - postings.begin());
+            if (it != postings.end() && it->docId == candidate) {
+                score += it->score;
+                cursor.position++;
+                visited++;
+            }
+        }
+
+        if (score <= threshold) {
+            continue;
+        }
+
+        heap.append({candidate, score});
+        std::push_heap(heap.begin(), heap.end(), betterHit);
+        if (heap.size() > k) {
+            std::pop_heap(heap.begin(), heap.end(), betterHit);
+            heap.removeLast();
+        }
+
+        if (heap.size() == k) {
+            threshold = heap.first().score;
+            while (firstEssential < listCount && upperBound[firstEssential] <= threshold) {
+                firstEssential++;
+            }
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), betterHit);
+
+    if (stats) {
+        stats->postingsVisited += visited;
+        qint64 total = 0;
+        for (const ListCursor &cursor : cursors) {
+            total += cursor.list->postings.size();
+        }
+        stats->postingsSkipped += total - visited;
+    }
+
+    return heap;
+}
+
+void InvertedIndex::removeDocument(quint32 docId)
+{
+    const auto document = documentTerms.constFind(docId);
+    if (document == documentTerms.constEnd()) {
+        return;
+    }
+
+    for (const QString &token : document.value()) {
+        auto term = terms.find(token);
+        if (term == terms.end()) {
+            continue;
+        }
+        QVector<Posting> &postings = term->postings;
+        auto it = std::lower_bound(postings.begin(), postings.end(), docId,
+                                   [](const Posting &p, quint32 id) { return p.docId < id; });
+        if (it == postings.end() || it->docId != docId) {
+            continue;
+        }
+
+        const bool wasMax = it->score >= term->maxScore;
+        postings.erase(it);
+        totalPostings--;
+        if (postings.isEmpty()) {
+            terms.erase(term);
+        } else if (wasMax) {
+            // Keep the bound tight, or topK() would probe this list needlessly
+            term->maxScore = 0.0f;
+            for (const Posting &posting : std::as_const(postings)) {
+                term->maxScore = qMax(term->maxScore, posting.score);
+            }
+        }
+    }
+    documentTerms.erase(document);
+}
+
+bool InvertedIndex::contains(const QString &token) const
+{
+    return terms.contains(token);
+}
+
+const PostingList *InvertedIndex::postings(const QString &token) const
+{
+    auto it = terms.constFind(token);
+    return it != terms.constEnd() ? &it.value() : nullptr;
+}
+
+QStringList InvertedIndex::tokens() const
+{
+    return terms.keys();
+}
+
+int InvertedIndex::termCount() const
+{
+    return terms.size();
+}
+
+qint64 InvertedIndex::postingCount() const
+{
+    return totalPostings;
+}
+
+void InvertedIndex::clear()
+{
+    terms.clear();
+    documentTerms.clear();
+    totalPostings = 0;
+}
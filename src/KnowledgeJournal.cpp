@@ -0,0 +1,390 @@
+#include "KnowledgeJournal.h"
+#include "Crc32.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QSaveFile>
+#include <QtCore/QDebug>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+namespace {
+
+const quint32 JournalMagic = 0x41494B4A;   // "AIKJ"
+const quint32 SnapshotMagic = 0x41494B53;  // "AIKS"
+const quint16 FormatVersion = 1;
+const int JournalHeaderSize = 6;           // magic + version
+const int FrameHeaderSize = 8;             // payload length + CRC-32
+const quint32 MaxRecordSize = 64 * 1024 * 1024;
+const qint64 DefaultCompactionThreshold = 4 * 1024 * 1024;
+
+bool syncToDisk(QFile &file)
+{
+    if (!file.flush()) {
+        return false;
+    }
+#if defined(Q_OS_WIN)
+    return _commit(file.handle()) == 0;
+#elif defined(Q_OS_UNIX)
+    return fsync(file.handle()) == 0;
+#else
+    return true;
+#endif
+}
+
+} // namespace
+
+KnowledgeJournal::KnowledgeJournal(const QString &directory)
+    : journalPath(QDir(directory).filePath("knowledge.journal")),
+      snapshotPath(QDir(directory).filePath("knowledge.snapshot")),
+      nextSequence(1),
+      enqueuedTasks(0),
+      completedTasks(0),
+      bytesWritten(0),
+      compactionThreshold(DefaultCompactionThreshold),
+      stopping(false)
+{
+    QDir().mkpath(directory);
+}
+
+KnowledgeJournal::~KnowledgeJournal()
+{
+    close();
+}
+
+bool KnowledgeJournal::open(QByteArray *snapshot, QVector<JournalRecord> *records)
+{
+    if (writer) {
+        return false;
+    }
+
+    quint64 coveredSequence = 0;
+    if (!readSnapshot(snapshot, &coveredSequence)) {
+        return false;
+    }
+    nextSequence = coveredSequence + 1;
+
+    if (!readJournal(coveredSequence, records) || !openJournalFile(false)) {
+        return false;
+    }
+
+    bytesWritten = journalFile.size();
+    stopping = false;
+    writer.reset(QThread::create([this]() { writerLoop(); }));
+    writer->start();
+    return true;
+}
+
+void KnowledgeJournal::close()
+{
+    if (!writer) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        workAvailable.wakeAll();
+    }
+    writer->wait();
+    writer.reset();
+    journalFile.close();
+}
+
+bool KnowledgeJournal::isOpen() const
+{
+    return writer != nullptr;
+}
+
+void KnowledgeJournal::append(const JournalRecord &record)
+{
+    QMutexLocker locker(&mutex);
+    if (!writer) {
+        return;
+    }
+
+    const quint64 sequence = nextSequence++;
+
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << sequence << static_cast<quint8>(record.type) << record.fields;
+
+    QByteArray frame;
+    QDataStream frameStream(&frame, QIODevice::WriteOnly);
+    frameStream << static_cast<quint32>(payload.size()) << crc32(payload);
+    frame.append(payload);
+
+    enqueue({sequence, frame, false});
+}
+
+void KnowledgeJournal::writeSnapshot(const QByteArray &snapshot)
+{
+    QMutexLocker locker(&mutex);
+    if (!writer) {
+        return;
+    }
+
+    // Covers everything appended so far
+    enqueue({nextSequence - 1, snapshot, true});
+}
+
+void KnowledgeJournal::flush()
+{
+    QMutexLocker locker(&mutex);
+    const quint64 target = enqueuedTasks;
+    while (writer && completedTasks < target) {
+        workDone.wait(&mutex);
+    }
+}
+
+void KnowledgeJournal::setCompactionThreshold(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    compactionThreshold = qMax<qint64>(JournalHeaderSize, bytes);
+}
+
+bool KnowledgeJournal::needsCompaction() const
+{
+    QMutexLocker locker(&mutex);
+    return bytesWritten > compactionThreshold;
+}
+
+qint64 KnowledgeJournal::journalSize() const
+{
+    QMutexLocker locker(&mutex);
+    return bytesWritten;
+}
+
+QString KnowledgeJournal::lastError() const
+{
+    QMutexLocker locker(&mutex);
+    return error;
+}
+
+bool KnowledgeJournal::readSnapshot(QByteArray *snapshot, quint64 *coveredSequence)
+{
+    QFile file(snapshotPath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint64 sequence = 0;
+    quint32 checksum = 0;
+    QByteArray payload;
+    stream >> magic >> version >> sequence >> checksum >> payload;
+
+    // The snapshot is replaced atomically, so a bad one is not a torn write
+    if (stream.status() != QDataStream::Ok || magic != SnapshotMagic
+        || version != FormatVersion || crc32(payload) != checksum) {
+        setError(QString("Poškodený snapshot znalostí: %1").arg(snapshotPath));
+        return false;
+    }
+
+    if (snapshot) {
+        *snapshot = payload;
+    }
+    *coveredSequence = sequence;
+    return true;
+}
+
+bool KnowledgeJournal::readJournal(quint64 coveredSequence, QVector<JournalRecord> *records)
+{
+    QFile file(journalPath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadWrite)) {
+        setError(file.errorString());
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+    if (data.isEmpty()) {
+        return true;
+    }
+
+    QDataStream header(data.left(JournalHeaderSize));
+    quint32 magic = 0;
+    quint16 version = 0;
+    header >> magic >> version;
+    if (header.status() != QDataStream::Ok || magic != JournalMagic || version != FormatVersion) {
+        // Not ours (or from a newer build): keep it aside rather than overwrite it
+        file.close();
+        const QString aside = journalPath + ".unreadable";
+        QFile::remove(aside);
+        QFile::rename(journalPath, aside);
+        qWarning() << "Nečitateľný žurnál znalostí presunutý do" << aside;
+        return true;
+    }
+
+    qint64 position = JournalHeaderSize;
+    quint64 lastSequence = coveredSequence;
+    while (data.size() - position >= FrameHeaderSize) {
+        QDataStream frameHeader(data.mid(position, FrameHeaderSize));
+        quint32 length = 0;
+        quint32 checksum = 0;
+        frameHeader >> length >> checksum;
+        if (length > MaxRecordSize || length > data.size() - position - FrameHeaderSize) {
+            break;
+        }
+
+        const QByteArray payload = data.mid(position + FrameHeaderSize, length);
+        if (crc32(payload) != checksum) {
+            break;
+        }
+
+        QDataStream stream(payload);
+        stream.setVersion(QDataStream::Qt_6_0);
+        quint64 sequence = 0;
+        quint8 type = 0;
+        QStringList fields;
+        stream >> sequence >> type >> fields;
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+
+        if (sequence > coveredSequence) {
+            if (records) {
+                records->append({static_cast<JournalRecord::Type>(type), fields});
+            }
+            lastSequence = qMax(lastSequence, sequence);
+        }
+        position += FrameHeaderSize + length;
+    }
+
+    // Anything past the last intact record is the tail of an interrupted write
+    if (position < data.size()) {
+        qWarning() << "Žurnál znalostí skrátený o" << (data.size() - position) << "bajtov";
+        if (!file.resize(position)) {
+            setError(file.errorString());
+            return false;
+        }
+    }
+
+    nextSequence = lastSequence + 1;
+    return true;
+}
+
+bool KnowledgeJournal::openJournalFile(bool truncate)
+{
+    if (journalFile.isOpen()) {
+        journalFile.close();
+    }
+
+    journalFile.setFileName(journalPath);
+    QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Append;
+    if (truncate) {
+        mode |= QIODevice::Truncate;
+    }
+    if (!journalFile.open(mode)) {
+        setError(journalFile.errorString());
+        return false;
+    }
+
+    if (journalFile.size() == 0) {
+        QDataStream stream(&journalFile);
+        stream << JournalMagic << FormatVersion;
+        if (!syncToDisk(journalFile)) {
+            setError(journalFile.errorString());
+            return false;
+        }
+    }
+    return true;
+}
+
+void KnowledgeJournal::enqueue(Task task)
+{
+    queue.append(std::move(task));
+    enqueuedTasks++;
+    workAvailable.wakeOne();
+}
+
+void KnowledgeJournal::writerLoop()
+{
+    QMutexLocker locker(&mutex);
+    forever {
+        while (queue.isEmpty() && !stopping) {
+            workAvailable.wait(&mutex);
+        }
+        if (queue.isEmpty()) {
+            break; // Stopping and drained
+        }
+
+        QVector<Task> batch;
+        batch.swap(queue);
+        locker.unlock();
+
+        // Group commit: one write and one sync for everything queued meanwhile
+        QByteArray frames;
+        for (const Task &task : std::as_const(batch)) {
+            if (task.snapshot) {
+                writeFrames(frames);
+                frames.clear();
+                writeSnapshotFile(task.sequence, task.data);
+            } else {
+                frames.append(task.data);
+            }
+        }
+        writeFrames(frames);
+
+        locker.relock();
+        completedTasks += batch.size();
+        bytesWritten = journalFile.size();
+        workDone.wakeAll();
+    }
+}
+
+bool KnowledgeJournal::writeFrames(const QByteArray &frames)
+{
+    if (frames.isEmpty()) {
+        return true;
+    }
+    if (!journalFile.isOpen() && !openJournalFile(false)) {
+        return false;
+    }
+    if (journalFile.write(frames) != frames.size() || !syncToDisk(journalFile)) {
+        setError(journalFile.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool KnowledgeJournal::writeSnapshotFile(quint64 sequence, const QByteArray &snapshot)
+{
+    QSaveFile file(snapshotPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << SnapshotMagic << FormatVersion << sequence << crc32(snapshot) << snapshot;
+    if (stream.status() != QDataStream::Ok || !file.commit()) {
+        setError(file.errorString());
+        return false;
+    }
+
+    // The snapshot now covers every journaled record; start a fresh journal
+    return openJournalFile(true);
+}
+
+void KnowledgeJournal::setError(const QString &message)
+{
+    qWarning() << "Žurnál znalostí:" << message;
+    QMutexLocker locker(&mutex);
+    error = message;
+}
@@ -1,4 +1,6 @@
 #include "LearningModule.h"
+#include "Tokenizer.h"
+#include <QtCore/QCoreApplication>
 #include <QtCore/QDebug>
 #include <QtCore/QFile>
 #include <QtCore/QJsonDocument>
@@ -6,24 +8,63 @@
 #include <QtCore/QJsonArray>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QDir>
-#include <QtCore/QRandomGenerator>
 #include <QtCore/QDateTime>
 #include <cmath>
 
+namespace {
+
+// Retrieval embeddings are wider than the network input: they are compared
+// directly, so fewer hash collisions pay off
+const int EmbeddingDimensions = 256;
+
+// Candidates from the interaction indexes re-ranked by the exact checks of the callers
+const int SimilarCandidates = 16;
+
+// Newest interactions per category considered when none of the nearest fits
+const int CategoryCandidates = 32;
+
+// Samples per optimizer step in trainNetwork() and retrainFromHistory(); learn()
+// steps on every interaction
+const int TrainingBatchSize = 16;
+
+QString interactionIndexPath(const QString &knowledgePath)
+{
+    return QFileInfo(knowledgePath).absolutePath() + "/interactions.hnsw";
+}
+
+QString historySpillPath(const QString &knowledgePath)
+{
+    return QFileInfo(knowledgePath).absolutePath() + "/history";
+}
+
+} // namespace
+
 LearningModule::LearningModule(QObject *parent)
     : QObject(parent)
+    , interactionIndex(EmbeddingDimensions)
+    , embeddingFeaturizer(EmbeddingDimensions)
+    , nextInteractionId(0)
     , learningTimer(new QTimer(this))
+    , trainingPool(new QThreadPool(this))
     , totalLearningEvents(0)
     , averageConfidence(0.0)
+    , confidenceSum(0.0)
     , maxHistorySize(1000)
     , inputSize(50)
     , hiddenSize(25)
     , outputSize(10)
     , learningRate(0.01)
     , momentum(0.9)
+    , requestedPrecision(InferencePrecision::Double)
+    , reducedNetworkStale(true)
+    , weightsVersion(0)
     , isLearning(false)
     , adaptiveMode(true)
 {
+    // One long-lived thread runs every training job, in the order posted
+    trainingPool->setMaxThreadCount(1);
+    trainingPool->setExpiryTimeout(-1);
+    
     initializeLearningSystem();
     
     // Setup continuous learning timer
@@ -64,9 +105,19 @@ void LearningModule::initializeLearningSystem()
         {"patterns", QJsonArray{"čo", "ako", "prečo", "kde", "kedy", "what", "how", "why"}},
         {"confidence", 0.7}
     };
+    
+    syncPatternMatcher("greeting_patterns");
+    syncPatternMatcher("programming_patterns");
+    syncPatternMatcher("question_patterns");
 }
 
 void LearningModule::learn(const QString &input, const QString &output, double reward)
+{
+    learn(AnalyzedMessage::create(input), output, reward);
+}
+
+void LearningModule::learn(const std::shared_ptr<const AnalyzedMessage> &message, const QString &output,
+                           double reward)
 {
     if (isLearning) {
         return; // Prevent recursive learning
@@ -76,66 +127,70 @@ void LearningModule::learn(const QString &input, const QString &output, double r
     
     // Create learning data entry
     LearningData data;
-    data.input = input;
+    data.id = nextInteractionId++;
+    data.input = message->text();
     data.output = output;
     data.context = currentCategory;
     data.reward = reward;
     data.timestamp = QDateTime::currentMSecsSinceEpoch();
-    data.category = analyzeCategory(input);
+    data.category = analyzeCategory(message->intents());
     
     // Add to learning history
     learningHistory.append(data);
-    if (learningHistory.size() > maxHistorySize) {
-        learningHistory.removeFirst();
-    }
-    
-    // Extract features and train neural network
-    QVector<double> inputVector = extractFeatures(input);
-    QVector<double> targetVector = extractFeatures(output);
-    
-    if (inputVector.size() == inputSize && targetVector.size() >= outputSize) {
-        QVector<double> target(outputSize);
-        for (int i = 0; i < outputSize; ++i) {
-            target[i] = (i < targetVector.size()) ? targetVector[i] : 0.0;
+    indexHistoryEntry(data);
+    interactionIndex.insert(data.id, message->features(embeddingFeaturizer));
+    similarityIndex.insert(data.id, message->tokenIds());
+    trimHistory();
+    
+    // Everything the training thread needs is computed here, against the
+    // published model; the history and the indexes stay on this thread
+    const std::shared_ptr<const Snapshot> model = snapshot();
+    const QStringList patterns = recognizePatterns(*model, *message);
+    const SparseVector features = extractFeatures(*message);
+    const QVector<double> target = features.isEmpty()
+        ? QVector<double>()
+        : targetFeaturizer.featurize(Tokenizer::tokenize(output)).toDense(outputSize);
+    
+    postTraining([this, data, patterns, features, target]() {
+        // Train neural network
+        if (!features.isEmpty()) {
+            trainer.accumulate(network, features, target);
+            applyTrainingStep();
         }
         
-        backpropagate(inputVector, target);
-        updateWeights(learningRate);
-    }
-    
-    // Update pattern recognition
-    QStringList patterns = recognizePatterns(input);
-    for (const QString &pattern : patterns) {
-        patternFrequency[pattern]++;
+        // Update pattern recognition
+        for (const QString &pattern : patterns) {
+            patternFrequency[pattern]++;
+            
+            // Update confidence based on reward
+            double currentConfidence = patternConfidence.value(pattern, 0.5);
+            double newConfidence = currentConfidence + (data.reward - 0.5) * 0.1;
+            setPatternConfidence(pattern, qBound(0.0, newConfidence, 1.0));
+        }
         
-        // Update confidence based on reward
-        double currentConfidence = patternConfidence.value(pattern, 0.5);
-        double newConfidence = currentConfidence + (reward - 0.5) * 0.1;
-        patternConfidence[pattern] = qBound(0.0, newConfidence, 1.0);
-    }
-    
-    totalLearningEvents++;
-    
-    // Calculate new average confidence
-    double totalConfidence = 0.0;
-    for (auto it = patternConfidence.begin(); it != patternConfidence.end(); ++it) {
-        totalConfidence += it.value();
-    }
-    averageConfidence = totalConfidence / qMax(1, patternConfidence.size());
-    
-    // Emit progress update
-    int progress = qMin(100, totalLearningEvents / 10);
-    emit learningProgressUpdated(progress);
-    
-    // Update knowledge base
-    updateKnowledge(data.category, QJsonObject{
-        {"input", input},
-        {"output", output},
-        {"confidence", patternConfidence.value(data.category, 0.5)},
-        {"frequency", patternFrequency.value(data.category, 1)}
+        totalLearningEvents++;
+        
+        // New average confidence from the running sum, not a pass over every pattern
+        averageConfidence = confidenceSum / qMax(1, patternConfidence.size());
+        publishSnapshot();
+        
+        // Update knowledge base with the category's statistics as just updated;
+        // saveKnowledge() delivers it before writing the file
+        const QJsonObject knowledge{
+            {"input", data.input},
+            {"output", data.output},
+            {"confidence", patternConfidence.value(data.category, 0.5)},
+            {"frequency", patternFrequency.value(data.category, 1)}
+        };
+        
+        // Emit progress update
+        const int progress = qMin(100, totalLearningEvents / 10);
+        notify([this, category = data.category, knowledge, progress]() {
+            updateKnowledge(category, knowledge);
+            emit learningProgressUpdated(progress);
+        });
     });
     
-    emit knowledgeUpdated(data.category);
     isLearning = false;
 }
 
@@ -143,23 +198,28 @@ void LearningModule::reinforcementLearning(const QString &action, double reward)
 {
     // Simple Q-learning approach
     QString state = currentCategory;
-    
-    // Update Q-value (simplified)
     QString key = state + "_" + action;
-    double currentQ = patternConfidence.value(key, 0.0);
-    double newQ = currentQ + learningRate * (reward - currentQ);
-    patternConfidence[key] = newQ;
     
-    // Adapt learning rate based on performance
-    if (adaptiveMode) {
-        if (reward > 0.7) {
-            learningRate = qMax(0.001, learningRate * 0.99); // Decrease learning rate when doing well
-        } else if (reward < 0.3) {
-            learningRate = qMin(0.1, learningRate * 1.01); // Increase learning rate when struggling
+    postTraining([this, key, reward]() {
+        // Update Q-value (simplified)
+        double currentQ = patternConfidence.value(key, 0.0);
+        double newQ = currentQ + learningRate * (reward - currentQ);
+        setPatternConfidence(key, newQ);
+        
+        // Adapt learning rate based on performance
+        if (adaptiveMode) {
+            if (reward > 0.7) {
+                learningRate = qMax(0.001, learningRate * 0.99); // Decrease learning rate when doing well
+            } else if (reward < 0.3) {
+                learningRate = qMin(0.1, learningRate * 1.01); // Increase learning rate when struggling
+            }
         }
-    }
-    
-    emit confidenceUpdated(newQ);
+        publishSnapshot();
+        
+        notify([this, newQ]() {
+            emit confidenceUpdated(newQ);
+        });
+    });
 }
 
 void LearningModule::unsupervisedLearning(const QStringList &data)
@@ -168,7 +228,7 @@ void LearningModule::unsupervisedLearning(const QStringList &data)
     QMap<QString, QStringList> clusters;
     
     for (const QString &item : data) {
-        QString category = analyzeCategory(item);
+        QString category = analyzeCategory(IntentMatcher::shared().match(item));
         clusters[category].append(item);
     }
     
@@ -187,38 +247,37 @@ void LearningModule::unsupervisedLearning(const QStringList &data)
             {"confidence", 0.6},
             {"discovered", true}
         };
+        syncPatternMatcher(category);
     }
     
     emit learningComplete();
 }
 
 QStringList LearningModule::recognizePatterns(const QString &input)
+{
+    return recognizePatterns(*snapshot(), *AnalyzedMessage::create(input));
+}
+
+QStringList LearningModule::recognizePatterns(const Snapshot &model, const AnalyzedMessage &message)
 {
     QStringList recognizedPatterns;
-    QString lowerInput = input.toLower();
     
-    // Check against known patterns in knowledge base
-    for (auto it = knowledgeBase.begin(); it != knowledgeBase.end(); ++it) {
-        const QString &category = it.key();
-        QJsonObject categoryData = it.value().toObject();
-        
-        if (categoryData.contains("patterns")) {
-            QJsonArray patterns = categoryData["patterns"].toArray();
-            for (const QJsonValue &patternValue : patterns) {
-                QString pattern = patternValue.toString().toLower();
-                if (lowerInput.contains(pattern)) {
-                    recognizedPatterns.append(category);
-                    emit patternRecognized(category);
-                    break;
-                }
-            }
+    // Check against known patterns in knowledge base (one scan for all categories;
+    // the patterns change as the module learns, so this is not cached)
+    const QBitArray matched = patternMatcher.match(message.text());
+    for (int id = 0; id < matched.size(); ++id) {
+        if (matched.testBit(id)) {
+            recognizedPatterns.append(patternMatcher.intentName(id));
         }
     }
+    recognizedPatterns.sort();
+    for (const QString &category : std::as_const(recognizedPatterns)) {
+        emit patternRecognized(category);
+    }
     
     // Use neural network for pattern recognition
-    QVector<double> inputVector = extractFeatures(input);
-    if (inputVector.size() == inputSize) {
-        QVector<double> output = processInput(inputVector);
+    if (!extractFeatures(message).isEmpty()) {
+        QVector<double> output = networkOutput(model, message);
         
         // Convert neural network output to pattern categories
         for (int i = 0; i < output.size(); ++i) {
@@ -236,35 +295,33 @@ QStringList LearningModule::recognizePatterns(const QString &input)
 
 QString LearningModule::predictOutput(const QString &input)
 {
-    QStringList patterns = recognizePatterns(input);
+    // The input is evaluated once: one analysis, one pattern scan, one network
+    // output, all against the same published model
+    const std::shared_ptr<const AnalyzedMessage> message = AnalyzedMessage::create(input);
+    const std::shared_ptr<const Snapshot> model = snapshot();
+    QStringList patterns = recognizePatterns(*model, *message);
     
     if (patterns.isEmpty()) {
         return "Nerozpoznaný vzor - potrebujem sa viac naučiť.";
     }
     
-    // Find best matching pattern from learning history
-    QString bestOutput;
-    double bestConfidence = 0.0;
-    
-    for (const LearningData &data : learningHistory) {
-        QString dataCategory = analyzeCategory(data.input);
-        if (patterns.contains(dataCategory)) {
-            double confidence = calculateConfidence(input, data.output);
-            if (confidence > bestConfidence) {
-                bestConfidence = confidence;
-                bestOutput = data.output;
+    // Only interactions of a recognized category are candidates: the most
+    // similar one among the nearest, else the best scored recent one
+    if (patternsConfidence(*model, *message, patterns) > 0.0) {
+        const QVector<const LearningData *> nearest = nearestInteractions(*message, SimilarCandidates);
+        for (const LearningData *data : nearest) {
+            if (patterns.contains(data->category) && !data->output.isEmpty()) {
+                return data->output;
             }
         }
-    }
-    
-    if (!bestOutput.isEmpty()) {
-        return bestOutput;
+        if (const LearningData *data = bestInCategories(patterns)) {
+            return data->output;
+        }
     }
     
     // Use neural network prediction
-    QVector<double> inputVector = extractFeatures(input);
-    if (inputVector.size() == inputSize) {
-        QVector<double> output = processInput(inputVector);
+    if (!extractFeatures(*message).isEmpty()) {
+        QVector<double> output = networkOutput(*model, *message);
         
         // Convert neural network output to text (simplified)
         if (output[0] > 0.8) {
@@ -283,11 +340,23 @@ QString LearningModule::predictOutput(const QString &input)
 
 double LearningModule::calculateConfidence(const QString &input, const QString &output)
 {
-    QStringList inputPatterns = recognizePatterns(input);
+    return calculateConfidence(*AnalyzedMessage::create(input), output);
+}
+
+double LearningModule::calculateConfidence(const AnalyzedMessage &message, const QString &output)
+{
+    Q_UNUSED(output);
+    const std::shared_ptr<const Snapshot> model = snapshot();
+    return patternsConfidence(*model, message, recognizePatterns(*model, message));
+}
+
+double LearningModule::patternsConfidence(const Snapshot &model, const AnalyzedMessage &message,
+                                          const QStringList &inputPatterns)
+{
     double confidence = 0.0;
     
     for (const QString &pattern : inputPatterns) {
-        confidence += patternConfidence.value(pattern, 0.1);
+        confidence += model.patternConfidence.value(pattern, 0.1);
     }
     
     // Normalize by number of patterns
@@ -296,9 +365,8 @@ double LearningModule::calculateConfidence(const QString &input, const QString &
     }
     
     // Factor in neural network confidence
-    QVector<double> inputVector = extractFeatures(input);
-    if (inputVector.size() == inputSize) {
-        QVector<double> networkOutput = processInput(inputVector);
+    if (!extractFeatures(message).isEmpty()) {
+        QVector<double> networkOutput = this->networkOutput(model, message);
         double networkConfidence = 0.0;
         for (double value : networkOutput) {
             networkConfidence += value;
@@ -314,6 +382,11 @@ double LearningModule::calculateConfidence(const QString &input, const QString &
 
 void LearningModule::saveKnowledge(const QString &filePath)
 {
+    // Saves the model with every queued job applied, and the knowledge
+    // entries those jobs posted back
+    waitForTraining();
+    QCoreApplication::sendPostedEvents(this);
+    
     QDir().mkpath(QFileInfo(filePath).absolutePath());
     
     QJsonObject root;
@@ -327,35 +400,57 @@ void LearningModule::saveKnowledge(const QString &filePath)
     
     // Save pattern confidence
     QJsonObject confidenceObj;
-    for (auto it = patternConfidence.begin(); it != patternConfidence.end(); ++it) {
-        confidenceObj[it.key()] = it.value();
+    for (const auto &entry : patternConfidence) {
+        confidenceObj[entry.key] = entry.value;
     }
     root["pattern_confidence"] = confidenceObj;
     
     // Save pattern frequency
     QJsonObject frequencyObj;
-    for (auto it = patternFrequency.begin(); it != patternFrequency.end(); ++it) {
-        frequencyObj[it.key()] = it.value();
+    for (const auto &entry : patternFrequency) {
+        frequencyObj[entry.key] = entry.value;
     }
     root["pattern_frequency"] = frequencyObj;
     
     // Save neural network weights (simplified)
     QJsonArray weightsArray;
-    for (const QVector<double> &layer : weights) {
+    QJsonArray biasesArray;
+    for (int l = 0; l < network.layerCount(); ++l) {
+        const DenseLayer &layer = network.layer(l);
         QJsonArray layerArray;
-        for (double weight : layer) {
+        for (double weight : layer.weightsToVector()) {
             layerArray.append(weight);
         }
         weightsArray.append(layerArray);
+        
+        // Biases of all layers are stored back to back
+        for (int i = 0; i < layer.outputCount(); ++i) {
+            biasesArray.append(layer.bias(i));
+        }
     }
     root["neural_weights"] = weightsArray;
+    root["neural_biases"] = biasesArray;
     
-    // Save biases
-    QJsonArray biasesArray;
-    for (double bias : biases) {
-        biasesArray.append(bias);
+    // Save interaction history; its embeddings go to a separate index file
+    QJsonArray historyArray;
+    for (const LearningData &data : std::as_const(learningHistory)) {
+        historyArray.append(QJsonObject{
+            {"id", QString::number(data.id)},
+            {"input", data.input},
+            {"output", data.output},
+            {"context", data.context},
+            {"reward", data.reward},
+            {"timestamp", QString::number(data.timestamp)},
+            {"category", data.category}
+        });
+    }
+    root["learning_history"] = historyArray;
+    root["next_interaction_id"] = QString::number(nextInteractionId);
+    
+    QString indexError;
+    if (!interactionIndex.save(interactionIndexPath(filePath), &indexError)) {
+        qWarning() << "Index interakcií sa nepodarilo uložiť:" << indexError;
     }
-    root["neural_biases"] = biasesArray;
     
     // Save learning statistics
     root["total_learning_events"] = totalLearningEvents;
@@ -372,6 +467,14 @@ void LearningModule::saveKnowledge(const QString &filePath)
 
 void LearningModule::loadKnowledge(const QString &filePath)
 {
+    // The model is replaced below, so no job may be running or have a
+    // knowledge entry still queued
+    waitForTraining();
+    QCoreApplication::sendPostedEvents(this);
+    
+    // Interactions evicted from now on are kept with this knowledge file
+    learningHistory.setSpillDirectory(historySpillPath(filePath));
+    
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
         return;
@@ -385,6 +488,7 @@ void LearningModule::loadKnowledge(const QString &filePath)
         QJsonObject kbObj = root["knowledge_base"].toObject();
         for (auto it = kbObj.begin(); it != kbObj.end(); ++it) {
             knowledgeBase[it.key()] = it.value();
+            syncPatternMatcher(it.key());
         }
     }
     
@@ -392,39 +496,110 @@ void LearningModule::loadKnowledge(const QString &filePath)
     if (root.contains("pattern_confidence")) {
         QJsonObject confidenceObj = root["pattern_confidence"].toObject();
         for (auto it = confidenceObj.begin(); it != confidenceObj.end(); ++it) {
-            patternConfidence[it.key()] = it.value().toDouble();
+            patternConfidence.insert(it.key(), it.value().toDouble());
         }
+        resyncConfidenceSum();
     }
     
     // Load pattern frequency
     if (root.contains("pattern_frequency")) {
         QJsonObject frequencyObj = root["pattern_frequency"].toObject();
         for (auto it = frequencyObj.begin(); it != frequencyObj.end(); ++it) {
-            patternFrequency[it.key()] = it.value().toInt();
+            patternFrequency.insert(it.key(), it.value().toInt());
         }
     }
     
     // Load neural network weights
     if (root.contains("neural_weights")) {
         QJsonArray weightsArray = root["neural_weights"].toArray();
-        weights.clear();
-        for (const QJsonValue &layerValue : weightsArray) {
-            QJsonArray layerArray = layerValue.toArray();
+        for (int l = 0; l < qMin(static_cast<int>(weightsArray.size()), network.layerCount()); ++l) {
+            QJsonArray layerArray = weightsArray[l].toArray();
             QVector<double> layer;
+            layer.reserve(layerArray.size());
             for (const QJsonValue &weightValue : layerArray) {
                 layer.append(weightValue.toDouble());
             }
-            weights.append(layer);
+            // Layers saved with a different topology are ignored
+            network.layer(l).setWeightsFromVector(layer);
         }
     }
     
     // Load biases
     if (root.contains("neural_biases")) {
         QJsonArray biasesArray = root["neural_biases"].toArray();
-        biases.clear();
-        for (const QJsonValue &biasValue : biasesArray) {
-            biases.append(biasValue.toDouble());
+        int index = 0;
+        for (int l = 0; l < network.layerCount(); ++l) {
+            DenseLayer &layer = network.layer(l);
+            for (int i = 0; i < layer.outputCount() && index < biasesArray.size(); ++i) {
+                layer.setBias(i, biasesArray[index++].toDouble());
+            }
+        }
+    }
+    reducedNetworkStale = true;
+    weightsVersion++;
+    trainer.reset(network);
+    
+    // Load interaction history (ids are stored as strings, JSON numbers are doubles)
+    if (root.contains("learning_history")) {
+        learningHistory.clear();
+        historyByCategory.clear();
+        similarityIndex.clear();
+        const QJsonArray historyArray = root["learning_history"].toArray();
+        for (const QJsonValue &value : historyArray) {
+            const QJsonObject object = value.toObject();
+            LearningData data;
+            data.id = object["id"].toString().toULongLong();
+            data.input = object["input"].toString();
+            data.output = object["output"].toString();
+            data.context = object["context"].toString();
+            data.reward = object["reward"].toDouble();
+            data.timestamp = object["timestamp"].toString().toLongLong();
+            data.category = object["category"].toString();
+            
+            // Spilled after the last save, so already on disk
+            if (data.id < learningHistory.spilledUntil()) {
+                continue;
+            }
+            
+            // historyEntry() relies on consecutive ids
+            if (!learningHistory.isEmpty() && data.id != learningHistory.last().id + 1) {
+                learningHistory.clear();
+                historyByCategory.clear();
+                similarityIndex.clear();
+            }
+            learningHistory.append(data);
+            indexHistoryEntry(data);
+            similarityIndex.insert(data.id, AnalyzedMessage::create(data.input)->tokenIds());
+        }
+        nextInteractionId = root["next_interaction_id"].toString().toULongLong();
+        if (!learningHistory.isEmpty()) {
+            nextInteractionId = qMax(nextInteractionId, learningHistory.last().id + 1);
+        }
+        trimHistory();
+    }
+    
+    // The saved graph is used when it indexes nothing but the loaded history.
+    // Interactions it lacks are inserted; those without an embedding (no
+    // tokens) are never indexed and are rejected again here.
+    QString indexError;
+    bool indexValid = interactionIndex.load(interactionIndexPath(filePath), &indexError)
+                      && interactionIndex.dimensions() == EmbeddingDimensions;
+    QVector<int> unindexed;
+    if (indexValid) {
+        for (int i = 0; i < learningHistory.size(); ++i) {
+            if (!interactionIndex.contains(learningHistory[i].id)) {
+                unindexed.append(i);
+            }
+        }
+        indexValid = interactionIndex.size() == learningHistory.size() - unindexed.size();
+    }
+    if (indexValid) {
+        for (int i : std::as_const(unindexed)) {
+            const LearningData &data = learningHistory[i];
+            interactionIndex.insert(data.id, embeddingFeaturizer.featurize(data.input));
         }
+    } else {
+        rebuildInteractionIndex();
     }
     
     // Load learning statistics
@@ -437,11 +612,13 @@ void LearningModule::loadKnowledge(const QString &filePath)
     if (root.contains("learning_rate")) {
         learningRate = root["learning_rate"].toDouble();
     }
+    publishSnapshot();
 }
 
 void LearningModule::updateKnowledge(const QString &key, const QJsonObject &data)
 {
     knowledgeBase[key] = data;
+    syncPatternMatcher(key);
     emit knowledgeUpdated(key);
 }
 
@@ -452,116 +629,234 @@ QJsonObject LearningModule::getKnowledge(const QString &key)
 
 void LearningModule::initializeNetwork(int inputSize, int hiddenSize, int outputSize)
 {
+    // The featurizers are read by both threads, so they change only while idle
+    waitForTraining();
+    
     this->inputSize = inputSize;
     this->hiddenSize = hiddenSize;
     this->outputSize = outputSize;
     
-    // Initialize weights with random values
-    weights.clear();
-    weights.resize(2); // Input to hidden, hidden to output
+    // Input to hidden, hidden to output; weights and biases uniform in [-1, 1]
+    network.resize({inputSize, hiddenSize, outputSize});
+    network.randomize(1.0);
+    reducedNetworkStale = true;
+    weightsVersion++;
     
-    // Input to hidden weights
-    weights[0].resize(hiddenSize * inputSize);
-    for (int i = 0; i < hiddenSize * inputSize; ++i) {
-        weights[0][i] = (QRandomGenerator::global()->generateDouble() - 0.5) * 2.0;
-    }
-    
-    // Hidden to output weights
-    weights[1].resize(outputSize * hiddenSize);
-    for (int i = 0; i < outputSize * hiddenSize; ++i) {
-        weights[1][i] = (QRandomGenerator::global()->generateDouble() - 0.5) * 2.0;
-    }
+    TrainingOptions options = trainer.options();
+    options.momentum = momentum;
+    trainer.setOptions(options);
+    trainer.reset(network);
     
-    // Initialize biases
-    biases.resize(hiddenSize + outputSize);
-    for (int i = 0; i < hiddenSize + outputSize; ++i) {
-        biases[i] = (QRandomGenerator::global()->generateDouble() - 0.5) * 2.0;
-    }
+    featurizer = FeatureHasher(inputSize);
+    targetFeaturizer = FeatureHasher(outputSize, FeatureHasher::Unsigned);
+    publishSnapshot();
 }
 
 QVector<double> LearningModule::processInput(const QVector<double> &input)
 {
-    if (input.size() != inputSize || weights.size() < 2) {
+    const std::shared_ptr<const Snapshot> model = snapshot();
+    if (input.size() != inputSize || model->network.layerCount() < 2) {
         return QVector<double>(outputSize, 0.0);
     }
     
-    // Forward pass through the network
-    QVector<double> hidden(hiddenSize);
-    
-    // Input to hidden layer
-    for (int i = 0; i < hiddenSize; ++i) {
-        double sum = biases[i];
-        for (int j = 0; j < inputSize; ++j) {
-            sum += weights[0][i * inputSize + j] * input[j];
-        }
-        hidden[i] = activationFunction(sum);
+    // Forward pass through the published network
+    return model->network.forward(input);
+}
+
+QVector<double> LearningModule::networkOutput(const Snapshot &model, const AnalyzedMessage &message)
+{
+    return message.networkOutput(this, model.outputVersion, [this, &model, &message]() {
+        return infer(model, extractFeatures(message));
+    });
+}
+
+QVector<double> LearningModule::infer(const Snapshot &model, const SparseVector &features) const
+{
+    if (model.network.layerCount() < 2) {
+        return QVector<double>(outputSize, 0.0);
     }
     
-    // Hidden to output layer
-    QVector<double> output(outputSize);
-    for (int i = 0; i < outputSize; ++i) {
-        double sum = biases[hiddenSize + i];
-        for (int j = 0; j < hiddenSize; ++j) {
-            sum += weights[1][i * hiddenSize + j] * hidden[j];
+    if (model.precision == InferencePrecision::Double) {
+        return model.network.forward(features);
+    }
+    return model.reducedNetwork.forward(features.toDense(inputSize));
+}
+
+bool LearningModule::setInferencePrecision(InferencePrecision precision)
+{
+    // Checked against the weights of the training thread, after its queued jobs
+    bool accepted = false;
+    postTraining([this, precision, &accepted]() {
+        const InferenceParity parity = checkReducedNetwork(precision);
+        accepted = precision == InferencePrecision::Double || parity.passed();
+        requestedPrecision = accepted ? precision : InferencePrecision::Double;
+        if (!accepted) {
+            reducedNetwork.clear();
         }
-        output[i] = activationFunction(sum);
+        publishSnapshot();
+    });
+    waitForTraining();
+    return accepted;
+}
+
+InferencePrecision LearningModule::inferencePrecision() const
+{
+    return snapshot()->precision;
+}
+
+InferenceParity LearningModule::inferenceParity() const
+{
+    return snapshot()->parity;
+}
+
+InferenceParity LearningModule::checkReducedNetwork(InferencePrecision precision)
+{
+    // Calibrated from the live weights, checked on inputs in the featurizer's encoding
+    reducedNetwork.build(network, precision);
+    reducedNetworkStale = false;
+    if (reducedNetwork.isEmpty()) {
+        lastParity = InferenceParity();
+        return lastParity;
     }
     
-    lastOutput = output;
-    lastHidden = hidden;
-    
-    return output;
+    // Thresholds of recognizePatterns and predictOutput
+    lastParity = QuantizedMlp::compare(network, reducedNetwork, featurizer.calibrationSamples(256),
+                                       {0.4, 0.6, 0.7, 0.8});
+    return lastParity;
 }
 
-void LearningModule::trainNetwork(const QVector<QVector<double>> &inputs, 
-                                 const QVector<QVector<double>> &targets)
+double LearningModule::trainNetwork(const QVector<QVector<double>> &inputs, 
+                                   const QVector<QVector<double>> &targets)
 {
-    for (int epoch = 0; epoch < inputs.size(); ++epoch) {
-        if (inputs[epoch].size() == inputSize && targets[epoch].size() == outputSize) {
-            processInput(inputs[epoch]);
-            backpropagate(inputs[epoch], targets[epoch]);
-            updateWeights(learningRate);
+    double loss = 0.0;
+    postTraining([this, &inputs, &targets, &loss]() {
+        const int count = static_cast<int>(qMin(inputs.size(), targets.size()));
+        for (int i = 0; i < count; ++i) {
+            if (inputs[i].size() == inputSize && targets[i].size() == outputSize) {
+                trainer.accumulate(network, inputs[i], targets[i]);
+                if (trainer.pendingSamples() >= TrainingBatchSize) {
+                    applyTrainingStep();
+                }
+            }
         }
-    }
+        applyTrainingStep();
+        loss = lastStep.loss;
+        publishSnapshot();
+    });
+    waitForTraining();
+    return loss;
+}
+
+void LearningModule::setTrainingOptimizer(TrainingOptimizer optimizer)
+{
+    postTraining([this, optimizer]() {
+        TrainingOptions options = trainer.options();
+        options.optimizer = optimizer;
+        trainer.setOptions(options);
+        publishSnapshot();
+    });
+    waitForTraining();
+}
+
+TrainingOptimizer LearningModule::trainingOptimizer() const
+{
+    return snapshot()->optimizer;
+}
+
+TrainingStep LearningModule::lastTrainingStep() const
+{
+    return snapshot()->lastStep;
+}
+
+double LearningModule::retrainFromHistory()
+{
+    // This thread appends to the history, and it waits below
+    double loss = 0.0;
+    postTraining([this, &loss]() {
+        // Spilled interactions are read through the segment maps, one at a time
+        learningHistory.forEach([this](const LearningData &data) {
+            const SparseVector features = extractFeatures(*AnalyzedMessage::create(data.input));
+            if (!features.isEmpty()) {
+                const QVector<double> target = targetFeaturizer.featurize(Tokenizer::tokenize(data.output)).toDense(outputSize);
+                trainer.accumulate(network, features, target);
+                if (trainer.pendingSamples() >= TrainingBatchSize) {
+                    applyTrainingStep();
+                }
+            }
+            return true;
+        });
+        applyTrainingStep();
+        loss = lastStep.loss;
+        publishSnapshot();
+    });
+    waitForTraining();
+    return loss;
+}
+
+void LearningModule::waitForTraining()
+{
+    trainingPool->waitForDone();
 }
 
 void LearningModule::analyzeMistakes()
+{
+    const QMap<QString, int> errorPatterns = countMistakes();
+    postTraining([this, errorPatterns]() {
+        penalizeMistakes(errorPatterns);
+        publishSnapshot();
+    });
+}
+
+QMap<QString, int> LearningModule::countMistakes() const
 {
     // Analyze recent learning data for patterns in mistakes
     QMap<QString, int> errorPatterns;
     
     for (const LearningData &data : learningHistory) {
         if (data.reward < 0.5) { // Consider as mistake
-            QString category = analyzeCategory(data.input);
+            const QString &category = data.category;
             errorPatterns[category]++;
         }
     }
-    
+    return errorPatterns;
+}
+
+void LearningModule::penalizeMistakes(const QMap<QString, int> &errorPatterns)
+{
     // Adjust confidence for problematic patterns
     for (auto it = errorPatterns.begin(); it != errorPatterns.end(); ++it) {
         const QString &pattern = it.key();
         int errorCount = it.value();
         
         if (errorCount > 3) { // Frequent mistakes
-            patternConfidence[pattern] = qMax(0.1, patternConfidence.value(pattern, 0.5) - 0.2);
-            emit errorInLearning(QString("Časté chyby v kategórii: %1").arg(pattern));
+            setPatternConfidence(pattern, qMax(0.1, patternConfidence.value(pattern, 0.5) - 0.2));
+            notify([this, pattern]() {
+                emit errorInLearning(QString("Časté chyby v kategórii: %1").arg(pattern));
+            });
         }
     }
 }
 
 void LearningModule::optimizePerformance()
+{
+    postTraining([this]() {
+        pruneWeakPatterns();
+        publishSnapshot();
+    });
+}
+
+void LearningModule::pruneWeakPatterns()
 {
     // Prune low-confidence patterns
     QStringList toRemove;
-    for (auto it = patternConfidence.begin(); it != patternConfidence.end(); ++it) {
-        if (it.value() < 0.1 && patternFrequency.value(it.key(), 0) < 2) {
-            toRemove.append(it.key());
+    for (const auto &entry : patternConfidence) {
+        if (entry.value < 0.1 && patternFrequency.value(entry.key, 0) < 2) {
+            toRemove.append(entry.key);
         }
     }
     
     for (const QString &pattern : toRemove) {
-        patternConfidence.remove(pattern);
-        patternFrequency.remove(pattern);
+        removePattern(pattern);
     }
     
     // Consolidate similar patterns
@@ -570,42 +865,58 @@ void LearningModule::optimizePerformance()
 
 void LearningModule::adaptToNewPatterns()
 {
-    // Increase learning rate for new patterns
-    if (adaptiveMode) {
-        // Recent learning events
-        int recentEvents = 0;
-        qint64 recentTime = QDateTime::currentMSecsSinceEpoch() - 300000; // Last 5 minutes
-        
-        for (const LearningData &data : learningHistory) {
-            if (data.timestamp > recentTime) {
-                recentEvents++;
-            }
-        }
-        
-        if (recentEvents > 10) {
-            learningRate = qMin(0.05, learningRate * 1.1);
+    const int recentEvents = recentEventCount();
+    postTraining([this, recentEvents]() {
+        adaptLearningRate(recentEvents);
+        publishSnapshot();
+    });
+}
+
+int LearningModule::recentEventCount() const
+{
+    // Recent learning events
+    int recentEvents = 0;
+    qint64 recentTime = QDateTime::currentMSecsSinceEpoch() - 300000; // Last 5 minutes
+    
+    for (const LearningData &data : learningHistory) {
+        if (data.timestamp > recentTime) {
+            recentEvents++;
         }
     }
+    return recentEvents;
+}
+
+void LearningModule::adaptLearningRate(int recentEvents)
+{
+    // Increase learning rate for new patterns
+    if (adaptiveMode && recentEvents > 10) {
+        learningRate = qMin(0.05, learningRate * 1.1);
+    }
 }
 
 int LearningModule::getTotalLearningEvents() const
 {
-    return totalLearningEvents;
+    return snapshot()->totalLearningEvents;
 }
 
 double LearningModule::getAverageConfidence() const
 {
-    return averageConfidence;
+    return snapshot()->averageConfidence;
 }
 
 QStringList LearningModule::getMostLearnedPatterns() const
+{
+    return mostLearnedPatterns(*snapshot());
+}
+
+QStringList LearningModule::mostLearnedPatterns(const Snapshot &model) const
 {
     QStringList patterns;
     
     // Sort patterns by frequency
     QList<QPair<int, QString>> sortedPatterns;
-    for (auto it = patternFrequency.begin(); it != patternFrequency.end(); ++it) {
-        sortedPatterns.append(qMakePair(it.value(), it.key()));
+    for (const auto &entry : model.patternFrequency) {
+        sortedPatterns.append(qMakePair(entry.value, entry.key));
     }
     
     std::sort(sortedPatterns.begin(), sortedPatterns.end(), 
@@ -620,23 +931,36 @@ QStringList LearningModule::getMostLearnedPatterns() const
     return patterns;
 }
 
+void LearningModule::setMaxHistorySize(int size)
+{
+    maxHistorySize = qMax(1, size);
+    trimHistory();
+}
+
+int LearningModule::maxHistory() const
+{
+    return maxHistorySize;
+}
+
 QString LearningModule::getLearningReport() const
 {
+    const std::shared_ptr<const Snapshot> model = snapshot();
     QString report = QString("=== SPRÁVA O UČENÍ ===\n\n");
-    report += QString("Celkový počet učebných udalostí: %1\n").arg(totalLearningEvents);
-    report += QString("Priemerná spoľahlivosť: %1%\n").arg(averageConfidence * 100, 0, 'f', 1);
-    report += QString("Aktuálna rýchlosť učenia: %1\n").arg(learningRate, 0, 'f', 4);
-    report += QString("Počet naučených vzorov: %1\n\n").arg(patternConfidence.size());
+    report += QString("Celkový počet učebných udalostí: %1\n").arg(model->totalLearningEvents);
+    report += QString("Priemerná spoľahlivosť: %1%\n").arg(model->averageConfidence * 100, 0, 'f', 1);
+    report += QString("Aktuálna rýchlosť učenia: %1\n").arg(model->learningRate, 0, 'f', 4);
+    report += QString("Chyba siete v poslednom kroku: %1 (krok %2)\n").arg(model->lastStep.loss, 0, 'f', 5).arg(model->lastStep.step);
+    report += QString("Počet naučených vzorov: %1\n\n").arg(model->patternConfidence.size());
     
     report += "Najčastejšie vzory:\n";
-    QStringList topPatterns = getMostLearnedPatterns();
+    QStringList topPatterns = mostLearnedPatterns(*model);
     for (int i = 0; i < topPatterns.size(); ++i) {
         const QString &pattern = topPatterns[i];
         report += QString("%1. %2 (frekvencia: %3, spoľahlivosť: %4%)\n")
                   .arg(i + 1)
                   .arg(pattern)
-                  .arg(patternFrequency.value(pattern, 0))
-                  .arg(patternConfidence.value(pattern, 0.0) * 100, 0, 'f', 1);
+                  .arg(model->patternFrequency.value(pattern, 0))
+                  .arg(model->patternConfidence.value(pattern, 0.0) * 100, 0, 'f', 1);
     }
     
     return report;
@@ -648,74 +972,94 @@ void LearningModule::continuousLearning()
         return;
     }
     
-    // Self-reinforcement learning from recent interactions
+    // Self-reinforcement learning from recent interactions; the history is
+    // read here, the confidences change on the training thread
+    QStringList reinforced;
     int recentCount = qMin(5, learningHistory.size());
     for (int i = learningHistory.size() - recentCount; i < learningHistory.size(); ++i) {
         const LearningData &data = learningHistory[i];
         
         // Reinforce successful patterns
         if (data.reward > 0.7) {
-            QString category = analyzeCategory(data.input);
-            patternConfidence[category] = qMin(1.0, patternConfidence.value(category, 0.5) + 0.05);
+            reinforced.append(data.category);
         }
     }
+    const int recentEvents = recentEventCount();
     
-    // Adapt to new patterns
-    adaptToNewPatterns();
-    
-    // Emit progress update
-    int progress = qMin(100, (totalLearningEvents * patternConfidence.size()) / 100);
-    emit learningProgressUpdated(progress);
+    postTraining([this, reinforced, recentEvents]() {
+        for (const QString &category : reinforced) {
+            setPatternConfidence(category, qMin(1.0, patternConfidence.value(category, 0.5) + 0.05));
+        }
+        
+        // Adapt to new patterns
+        adaptLearningRate(recentEvents);
+        publishSnapshot();
+        
+        // Emit progress update
+        const int progress = qMin(100, (totalLearningEvents * patternConfidence.size()) / 100);
+        notify([this, progress]() {
+            emit learningProgressUpdated(progress);
+        });
+    });
 }
 
 void LearningModule::evaluatePerformance()
 {
-    analyzeMistakes();
-    optimizePerformance();
-    
-    // Update average confidence
-    double totalConfidence = 0.0;
-    for (auto it = patternConfidence.begin(); it != patternConfidence.end(); ++it) {
-        totalConfidence += it.value();
-    }
-    averageConfidence = totalConfidence / qMax(1, patternConfidence.size());
-    
-    emit confidenceUpdated(averageConfidence);
+    const QMap<QString, int> errorPatterns = countMistakes();
+    postTraining([this, errorPatterns]() {
+        penalizeMistakes(errorPatterns);
+        pruneWeakPatterns();
+        
+        // Training may have drifted the weights into a range the reduced network handles badly
+        if (requestedPrecision != InferencePrecision::Double) {
+            const InferenceParity parity = checkReducedNetwork(requestedPrecision);
+            if (!parity.passed()) {
+                requestedPrecision = InferencePrecision::Double;
+                reducedNetwork.clear();
+                notify([this, parity]() {
+                    emit errorInLearning(QString("Znížená presnosť výpočtu nesedí (zhoda %1 %), prepínam na double")
+                                             .arg(parity.thresholdAgreement * 100.0, 0, 'f', 1));
+                });
+            }
+        }
+        
+        // Update average confidence; the exact sum also clears rounding drift
+        // accumulated by the incremental updates since the last evaluation
+        resyncConfidenceSum();
+        averageConfidence = confidenceSum / qMax(1, patternConfidence.size());
+        publishSnapshot();
+        
+        notify([this, average = averageConfidence]() {
+            emit confidenceUpdated(average);
+        });
+    });
 }
 
-QStringList LearningModule::extractFeatures(const QString &input)
+SparseVector LearningModule::extractFeatures(const AnalyzedMessage &message)
 {
-    QStringList features;
-    QString lowerInput = input.toLower();
-    
-    // Extract word features
-    QStringList words = lowerInput.split(QRegularExpression("\\W+"), Qt::SkipEmptyParts);
-    
-    // Limit to inputSize features
-    for (int i = 0; i < qMin(inputSize, words.size()); ++i) {
-        features.append(words[i]);
-    }
-    
-    // Pad with empty strings if needed
-    while (features.size() < inputSize) {
-        features.append("");
-    }
-    
-    return features;
+    // Hashed word and character n-gram features, inputSize slots wide
+    return message.features(featurizer);
 }
 
 QString LearningModule::findSimilarPatterns(const QString &input)
 {
-    QStringList inputFeatures = extractFeatures(input);
+    const std::shared_ptr<const AnalyzedMessage> message = AnalyzedMessage::create(input);
+    const QVector<quint32> &inputIds = message->tokenIds();
+    const QSet<quint32> inputSet(inputIds.begin(), inputIds.end());
     QString mostSimilar;
     double bestSimilarity = 0.0;
     
-    for (const LearningData &data : learningHistory) {
-        QStringList dataFeatures = extractFeatures(data.input);
+    // Only the interactions sharing a MinHash band are compared word by word
+    const QVector<MinHashMatch> candidates = similarityIndex.search(inputIds, SimilarCandidates);
+    for (const MinHashMatch &candidate : candidates) {
+        const LearningData *data = historyEntry(candidate.key);
+        if (!data) {
+            continue;
+        }
+        const QVector<quint32> dataIds = AnalyzedMessage::create(data->input)->tokenIds();
         
-        // Calculate similarity (simplified Jaccard similarity)
-        QSet<QString> inputSet = QSet<QString>(inputFeatures.begin(), inputFeatures.end());
-        QSet<QString> dataSet = QSet<QString>(dataFeatures.begin(), dataFeatures.end());
+        // Calculate similarity (simplified Jaccard similarity of the words)
+        QSet<quint32> dataSet(dataIds.begin(), dataIds.end());
         
         int intersection = (inputSet & dataSet).size();
         int unionSize = (inputSet | dataSet).size();
@@ -724,21 +1068,117 @@ QString LearningModule::findSimilarPatterns(const QString &input)
         
         if (similarity > bestSimilarity) {
             bestSimilarity = similarity;
-            mostSimilar = data.input;
+            mostSimilar = data->input;
         }
     }
     
     return (bestSimilarity > 0.3) ? mostSimilar : QString();
 }
 
+QVector<const LearningData *> LearningModule::nearestInteractions(const AnalyzedMessage &message, int count)
+{
+    QVector<const LearningData *> result;
+    const QVector<NeighbourMatch> matches = interactionIndex.search(message.features(embeddingFeaturizer), count);
+    result.reserve(matches.size());
+    for (const NeighbourMatch &match : matches) {
+        if (const LearningData *data = historyEntry(match.key)) {
+            result.append(data);
+        }
+    }
+    return result;
+}
+
+const LearningData *LearningModule::historyEntry(quint64 id) const
+{
+    // Ids grow by one per interaction and only the oldest are dropped, so the
+    // position follows from the first id
+    if (learningHistory.isEmpty() || id < learningHistory.first().id) {
+        return nullptr;
+    }
+    const quint64 offset = id - learningHistory.first().id;
+    if (offset >= static_cast<quint64>(learningHistory.size())) {
+        return nullptr;
+    }
+    const LearningData &data = learningHistory[static_cast<int>(offset)];
+    return data.id == id ? &data : nullptr;
+}
+
+const LearningData *LearningModule::bestInCategories(const QStringList &categories) const
+{
+    const CategoryEntry *best = nullptr;
+    for (const QString &category : categories) {
+        const auto found = historyByCategory.constFind(category);
+        if (found == historyByCategory.constEnd()) {
+            continue;
+        }
+        const CategoryHistory &entries = found.value();
+        const int first = qMax(0, entries.size() - CategoryCandidates);
+        for (int i = entries.size() - 1; i >= first; --i) {
+            // Newest first, so ties go to the most recent interaction
+            const CategoryEntry &entry = entries.at(i);
+            if (entry.score > 0.0 && (!best || entry.score > best->score
+                                      || (entry.score == best->score && entry.id > best->id))) {
+                best = &entry;
+            }
+        }
+    }
+    return best ? historyEntry(best->id) : nullptr;
+}
+
+void LearningModule::indexHistoryEntry(const LearningData &data)
+{
+    historyByCategory[data.category].entries.append({data.id, data.output.isEmpty() ? 0.0 : data.reward});
+}
+
+void LearningModule::CategoryHistory::removeFirst()
+{
+    head++;
+    if (head * 2 >= entries.size()) {
+        entries.remove(0, head);
+        head = 0;
+    }
+}
+
+void LearningModule::trimHistory()
+{
+    while (learningHistory.size() > maxHistorySize) {
+        // The oldest interaction is also the oldest of its category
+        const LearningData &oldest = learningHistory.first();
+        auto category = historyByCategory.find(oldest.category);
+        if (category != historyByCategory.end()) {
+            category->removeFirst();
+            if (category->size() == 0) {
+                historyByCategory.erase(category);
+            }
+        }
+        interactionIndex.remove(oldest.id);
+        similarityIndex.remove(oldest.id);
+        learningHistory.spillFirst();
+    }
+}
+
+void LearningModule::rebuildInteractionIndex()
+{
+    // A failed load may have left the dimensions of a foreign file behind
+    interactionIndex = HnswIndex(EmbeddingDimensions);
+    for (const LearningData &data : std::as_const(learningHistory)) {
+        interactionIndex.insert(data.id, embeddingFeaturizer.featurize(data.input));
+    }
+}
+
 void LearningModule::clusterData()
 {
-    // Simple clustering based on categories
+    // Simple clustering based on categories, straight from the category index
     QMap<QString, QStringList> clusters;
     
-    for (const LearningData &data : learningHistory) {
-        QString category = analyzeCategory(data.input);
-        clusters[category].append(data.input);
+    for (auto it = historyByCategory.cbegin(); it != historyByCategory.cend(); ++it) {
+        QStringList &items = clusters[it.key()];
+        const CategoryHistory &entries = it.value();
+        for (int i = 0; i < entries.size(); ++i) {
+            if (const LearningData *data = historyEntry(entries.at(i).id)) {
+                items.append(data->input);
+            }
+        }
     }
     
     // Update knowledge base with clusters
@@ -757,87 +1197,125 @@ void LearningModule::clusterData()
                 {"confidence", 0.6},
                 {"cluster_size", items.size()}
             };
+            syncPatternMatcher(category + "_cluster");
         }
     }
 }
 
-double LearningModule::activationFunction(double x)
+void LearningModule::applyTrainingStep()
 {
-    // Sigmoid activation function
-    return 1.0 / (1.0 + std::exp(-x));
+    const TrainingStep step = trainer.step(network, learningRate);
+    if (step.samples == 0) {
+        return;
+    }
+    lastStep = step;
+    reducedNetworkStale = true;
+    weightsVersion++;
+    notify([this, loss = step.loss]() {
+        emit trainingStepFinished(loss);
+    });
 }
 
-double LearningModule::activationDerivative(double x)
+std::shared_ptr<const LearningModule::Snapshot> LearningModule::snapshot() const
 {
-    return x * (1.0 - x);
+    return std::atomic_load(&published);
 }
 
-void LearningModule::backpropagate(const QVector<double> &input, const QVector<double> &target)
+void LearningModule::publishSnapshot()
 {
-    if (input.size() != inputSize || target.size() != outputSize || 
-        lastOutput.size() != outputSize || lastHidden.size() != hiddenSize) {
-        return;
+    // Requantized here rather than on first use, since snapshots never change
+    if (requestedPrecision != InferencePrecision::Double && reducedNetworkStale) {
+        reducedNetwork.build(network, requestedPrecision);
+        reducedNetworkStale = false;
     }
     
-    // Calculate output layer errors
-    QVector<double> outputErrors(outputSize);
-    for (int i = 0; i < outputSize; ++i) {
-        double error = target[i] - lastOutput[i];
-        outputErrors[i] = error * activationDerivative(lastOutput[i]);
-    }
-    
-    // Calculate hidden layer errors
-    QVector<double> hiddenErrors(hiddenSize);
-    for (int i = 0; i < hiddenSize; ++i) {
-        double error = 0.0;
-        for (int j = 0; j < outputSize; ++j) {
-            error += outputErrors[j] * weights[1][j * hiddenSize + i];
-        }
-        hiddenErrors[i] = error * activationDerivative(lastHidden[i]);
+    auto next = std::make_shared<Snapshot>();
+    next->network = network;
+    if (requestedPrecision != InferencePrecision::Double) {
+        next->reducedNetwork = reducedNetwork;
     }
-    
-    // Store errors for weight updates
-    // (In a full implementation, you would store these for batch updates)
+    next->precision = requestedPrecision;
+    next->parity = lastParity;
+    next->outputVersion = (weightsVersion << 2) | static_cast<quint64>(requestedPrecision);
+    next->patternConfidence = patternConfidence;
+    next->patternFrequency = patternFrequency;
+    next->learningRate = learningRate;
+    next->averageConfidence = averageConfidence;
+    next->totalLearningEvents = totalLearningEvents;
+    next->optimizer = trainer.options().optimizer;
+    next->lastStep = lastStep;
+    
+    // Readers still holding the previous snapshot keep it alive until they
+    // drop their reference
+    std::atomic_store(&published, std::shared_ptr<const Snapshot>(std::move(next)));
 }
 
-void LearningModule::updateWeights(double learningRate)
+void LearningModule::postTraining(const std::function<void()> &job)
 {
-    // This is a simplified weight update
-    // In a full implementation, you would use the stored errors from backpropagation
-    
-    // Add small random changes to simulate learning
-    for (int layer = 0; layer < weights.size(); ++layer) {
-        for (int i = 0; i < weights[layer].size(); ++i) {
-            double change = (QRandomGenerator::global()->generateDouble() - 0.5) * learningRate * 0.1;
-            weights[layer][i] += change;
-        }
-    }
-    
-    // Update biases
-    for (int i = 0; i < biases.size(); ++i) {
-        double change = (QRandomGenerator::global()->generateDouble() - 0.5) * learningRate * 0.1;
-        biases[i] += change;
-    }
+    trainingPool->start(job);
 }
 
-QString LearningModule::analyzeCategory(const QString &input)
+void LearningModule::notify(const std::function<void()> &emitter)
+{
+    // Receivers connect lambdas without a context object, so signals are
+    // emitted on the module's thread; dropped if the module is gone by then
+    QMetaObject::invokeMethod(this, emitter, Qt::QueuedConnection);
+}
+
+QString LearningModule::analyzeCategory(const QBitArray &intents)
 {
-    QString lowerInput = input.toLower();
-    
     // Simple category analysis based on keywords
-    if (lowerInput.contains(QRegularExpression("\\b(ahoj|hello|hi|čau|dobrý)\\b"))) {
+    if (intents.testBit(IntentMatcher::GreetingIntent)) {
         return "greeting";
-    } else if (lowerInput.contains(QRegularExpression("\\b(kód|program|funkcia|trieda|code|function|class)\\b"))) {
+    } else if (intents.testBit(IntentMatcher::ProgrammingIntent)) {
         return "programming";
-    } else if (lowerInput.contains(QRegularExpression("\\b(čo|ako|prečo|kde|kedy|what|how|why|where|when)\\b"))) {
+    } else if (intents.testBit(IntentMatcher::QuestionIntent)) {
         return "question";
-    } else if (lowerInput.contains(QRegularExpression("\\b(ďakujem|thanks|thank you|vďaka)\\b"))) {
+    } else if (intents.testBit(IntentMatcher::GratitudeIntent)) {
         return "gratitude";
-    } else if (lowerInput.contains(QRegularExpression("\\b(pomoc|help|assist)\\b"))) {
+    } else if (intents.testBit(IntentMatcher::HelpIntent)) {
         return "help_request";
     } else {
         return "general";
     }
 }
 
+void LearningModule::syncPatternMatcher(const QString &category)
+{
+    const int id = patternMatcher.registerIntent(category);
+    
+    QStringList patterns;
+    const QJsonArray patternArray = knowledgeBase.value(category).value("patterns").toArray();
+    for (const QJsonValue &patternValue : patternArray) {
+        patterns.append(patternValue.toString());
+    }
+    
+    patternMatcher.setPatterns(id, patterns, IntentMatcher::Substring);
+}
+
+void LearningModule::setPatternConfidence(QStringView pattern, double confidence)
+{
+    // A new pattern is inserted at 0.0, so the delta is right either way
+    double &current = patternConfidence[pattern];
+    confidenceSum += confidence - current;
+    current = confidence;
+}
+
+void LearningModule::removePattern(QStringView pattern)
+{
+    if (const double *confidence = patternConfidence.find(pattern)) {
+        confidenceSum -= *confidence;
+        patternConfidence.remove(pattern);
+    }
+    patternFrequency.remove(pattern);
+}
+
+void LearningModule::resyncConfidenceSum()
+{
+    confidenceSum = 0.0;
+    for (const auto &entry : patternConfidence) {
+        confidenceSum += entry.value;
+    }
+}
+
 #include "LearningModule.moc"
\ No newline at end of file
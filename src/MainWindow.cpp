@@ -13,6 +13,9 @@
 #include <QtCore/QTextStream>
 #include <QtGui/QFont>
 #include <QtGui/QTextCursor>
+#include <QtGui/QTextDocument>
+#include <QtGui/QTextCharFormat>
+#include <QtGui/QColor>
 #include <QtWidgets/QScrollBar>
 
 MainWindow::MainWindow(QWidget *parent)
@@ -24,6 +27,7 @@ MainWindow::MainWindow(QWidget *parent)
     , chatDisplay(nullptr)
     , messageInput(nullptr)
     , sendButton(nullptr)
+    , stopButton(nullptr)
     , clearButton(nullptr)
     , codeTab(nullptr)
     , codeEditor(nullptr)
@@ -42,6 +46,7 @@ MainWindow::MainWindow(QWidget *parent)
     , codeGenerator(nullptr)
     , learningModule(nullptr)
     , statusTimer(nullptr)
+    , draftTimer(nullptr)
 {
     setWindowTitle("AI Assistant - Inteligentný Asistent");
     setMinimumSize(1200, 800);
@@ -168,6 +173,24 @@ void MainWindow::setupChatTab()
         "}"
     );
     
+    stopButton = new QPushButton("Zastaviť");
+    stopButton->setEnabled(false);
+    stopButton->setStyleSheet(
+        "QPushButton {"
+        "    background-color: #404040;"
+        "    color: white;"
+        "    border: none;"
+        "    border-radius: 8px;"
+        "    padding: 8px 20px;"
+        "}"
+        "QPushButton:hover {"
+        "    background-color: #505050;"
+        "}"
+        "QPushButton:disabled {"
+        "    color: #808080;"
+        "}"
+    );
+    
     clearButton = new QPushButton("Vymazať");
     clearButton->setStyleSheet(
         "QPushButton {"
@@ -184,6 +207,7 @@ void MainWindow::setupChatTab()
     
     inputLayout->addWidget(messageInput);
     inputLayout->addWidget(sendButton);
+    inputLayout->addWidget(stopButton);
     inputLayout->addWidget(clearButton);
     
     chatLayout->addWidget(chatDisplay, 1);
@@ -371,15 +395,32 @@ void MainWindow::connectSignals()
 {
     // UI signals
     connect(sendButton, &QPushButton::clicked, this, &MainWindow::sendMessage);
+    connect(stopButton, &QPushButton::clicked, this, &MainWindow::stopGeneration);
     connect(clearButton, &QPushButton::clicked, this, &MainWindow::clearChat);
     connect(generateButton, &QPushButton::clicked, this, &MainWindow::generateCode);
     connect(executeButton, &QPushButton::clicked, this, &MainWindow::executeCode);
     connect(messageInput, &QLineEdit::returnPressed, this, &MainWindow::sendMessage);
     
+    // Once typing pauses, let the engine analyse the draft ahead of Enter
+    draftTimer = new QTimer(this);
+    draftTimer->setSingleShot(true);
+    draftTimer->setInterval(200);
+    connect(messageInput, &QLineEdit::textEdited, draftTimer, qOverload<>(&QTimer::start));
+    connect(draftTimer, &QTimer::timeout, this, [this]() {
+        aiEngine->prepareMessage(messageInput->text());
+    });
+    
     // AI Engine signals
-    connect(aiEngine, &AIEngine::responseReady, this, &MainWindow::onAIResponse);
+    connect(aiEngine, &AIEngine::responseStarted, this, &MainWindow::onResponseStarted);
+    connect(aiEngine, &AIEngine::responseChunk, this, &MainWindow::onResponseChunk);
+    connect(aiEngine, &AIEngine::responseFinished, this, &MainWindow::onResponseFinished);
+    connect(aiEngine, &AIEngine::responseCancelled, this, &MainWindow::onResponseCancelled);
     connect(aiEngine, &AIEngine::statusChanged, this, &MainWindow::updateStatus);
-    connect(aiEngine, &AIEngine::codeGenerated, [this](const QString &code) {
+    connect(aiEngine, &AIEngine::errorOccurred, this, [this](const QString &error) {
+        addMessageToChat("Systém", error, "#FF5555");
+    });
+    // The engine emits from its worker threads, so every handler needs a context object
+    connect(aiEngine, &AIEngine::codeGenerated, this, [this](const QString &code) {
         codeEditor->setPlainText(code);
         tabWidget->setCurrentIndex(1); // Switch to code tab
     });
@@ -406,6 +447,7 @@ void MainWindow::sendMessage()
     
     // Add user message to chat
     addMessageToChat("Používateľ", message, "#4CAF50");
+    draftTimer->stop();
     messageInput->clear();
     
     // Show processing
@@ -413,8 +455,14 @@ void MainWindow::sendMessage()
     processingProgress->setRange(0, 0); // Indeterminate progress
     updateStatus("Spracúvam správu...");
     
-    // Process with AI
-    aiEngine->processMessage(message);
+    // Queue for asynchronous processing; the answer is streamed back in chunks
+    const quint64 requestId = aiEngine->processMessage(message);
+    if (requestId != 0) {
+        activeRequests.insert(requestId);
+        stopButton->setEnabled(true);
+    } else if (aiEngine->pendingRequestCount() == 0) {
+        processingProgress->setVisible(false);
+    }
 }
 
 void MainWindow::clearChat()
@@ -457,12 +505,91 @@ void MainWindow::loadConversation()
     }
 }
 
-void MainWindow::onAIResponse(const QString &response)
+void MainWindow::onResponseStarted(quint64 requestId)
 {
-    addMessageToChat("AI Assistant", response, "#2196F3");
+    QTextDocument *document = chatDisplay->document();
+    QTextCursor cursor(document);
+    cursor.movePosition(QTextCursor::End);
     
-    processingProgress->setVisible(false);
-    updateStatus("Pripravený");
+    QString timestamp = QDateTime::currentDateTime().toString("hh:mm:ss");
+    cursor.insertHtml(QString(
+        "<span style='color: #2196F3; font-weight: bold;'>[%1] AI Assistant:</span><br>"
+    ).arg(timestamp));
+    
+    // Chunks go in before this trailing block, so later messages stay below
+    const int textPosition = cursor.position();
+    cursor.insertBlock();
+    
+    StreamingMessage &message = streamingMessages[requestId];
+    message.cursor = QTextCursor(document);
+    message.cursor.setPosition(textPosition);
+    QTextCharFormat format;
+    format.setForeground(QColor("#ffffff"));
+    message.cursor.setCharFormat(format);
+    
+    chatDisplay->ensureCursorVisible();
+}
+
+void MainWindow::onResponseChunk(quint64 requestId, int sequence, const QString &chunk)
+{
+    auto it = streamingMessages.find(requestId);
+    if (it == streamingMessages.end()) {
+        return;
+    }
+    
+    StreamingMessage &message = it.value();
+    message.pendingChunks.insert(sequence, chunk);
+    while (!message.pendingChunks.isEmpty() && message.pendingChunks.firstKey() == message.nextSequence) {
+        message.cursor.insertText(message.pendingChunks.take(message.nextSequence));
+        message.nextSequence++;
+    }
+    
+    // Auto-scroll to bottom
+    chatDisplay->verticalScrollBar()->setValue(chatDisplay->verticalScrollBar()->maximum());
+}
+
+void MainWindow::onResponseFinished(quint64 requestId, const QString &response)
+{
+    auto it = streamingMessages.find(requestId);
+    if (it == streamingMessages.end()) {
+        // Not streamed into the view (e.g. started before the window connected)
+        addMessageToChat("AI Assistant", response, "#2196F3");
+    }
+    endRequest(requestId);
+}
+
+void MainWindow::onResponseCancelled(quint64 requestId)
+{
+    auto it = streamingMessages.find(requestId);
+    if (it != streamingMessages.end()) {
+        QTextCharFormat format;
+        format.setForeground(QColor("#FFA500"));
+        it->cursor.insertText(" [zrušené]", format);
+    } else if (activeRequests.contains(requestId)) {
+        addMessageToChat("Systém", "Odpoveď zrušená", "#FFA500");
+    }
+    endRequest(requestId);
+}
+
+void MainWindow::stopGeneration()
+{
+    for (quint64 requestId : std::as_const(activeRequests)) {
+        aiEngine->cancelResponse(requestId);
+    }
+    updateStatus("Zastavujem generovanie...");
+}
+
+void MainWindow::endRequest(quint64 requestId)
+{
+    streamingMessages.remove(requestId);
+    activeRequests.remove(requestId);
+    stopButton->setEnabled(!activeRequests.isEmpty());
+    
+    // Keep the indicator while other queued messages are still being processed
+    if (aiEngine->pendingRequestCount() == 0) {
+        processingProgress->setVisible(false);
+        updateStatus("Pripravený");
+    }
 }
 
 void MainWindow::onLearningProgress(int progress)
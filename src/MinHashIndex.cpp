@@ -0,0 +1,215 @@
+#include "MinHashIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const quint32 NoSlot = 0xFFFFFFFFu;
+const quint64 HashSeed = 0x4D696E48617368ULL;   // Fixed, so signatures are stable between runs
+
+// splitmix64 finalizer
+quint64 mix(quint64 value)
+{
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+} // namespace
+
+MinHashIndex::MinHashIndex(int bands, int rowsPerBand)
+    : bandCount(qMax(1, bands))
+    , rows(qMax(1, rowsPerBand))
+    , visitEpoch(0)
+{
+    // Multiply-shift hashes over the mixed token: one mix per token, then a
+    // multiply-add per signature value
+    quint64 state = HashSeed;
+    for (int i = 0; i < signatureSize(); ++i) {
+        state += 0x9E3779B97F4A7C15ULL;
+        multipliers.push_back(mix(state) | 1);
+        state += 0x9E3779B97F4A7C15ULL;
+        offsets.push_back(mix(state));
+    }
+}
+
+double MinHashIndex::threshold() const
+{
+    return std::pow(1.0 / bandCount, 1.0 / rows);
+}
+
+QVector<quint32> MinHashIndex::signature(const QVector<quint32> &tokens) const
+{
+    QVector<quint32> values(signatureSize());
+    computeSignature(tokens, values.data());
+    return values;
+}
+
+bool MinHashIndex::insert(quint64 key, const QVector<quint32> &tokens)
+{
+    if (tokens.isEmpty()) {
+        return false;
+    }
+    remove(key);
+
+    quint32 slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = static_cast<quint32>(slotKeys.size());
+        slotKeys.push_back(0);
+        signatures.resize(signatures.size() + signatureSize());
+        nextInBucket.resize(nextInBucket.size() + bandCount, NoSlot);
+        previousInBucket.resize(previousInBucket.size() + bandCount, NoSlot);
+    }
+
+    slotKeys[slot] = key;
+    computeSignature(tokens, signatures.data() + static_cast<size_t>(slot) * signatureSize());
+    link(slot);
+    slotByKey.insert(key, slot);
+    return true;
+}
+
+bool MinHashIndex::remove(quint64 key)
+{
+    const auto found = slotByKey.constFind(key);
+    if (found == slotByKey.constEnd()) {
+        return false;
+    }
+    const quint32 slot = found.value();
+    slotByKey.erase(found);
+    unlink(slot);
+    freeSlots.push_back(slot);
+    return true;
+}
+
+QVector<MinHashMatch> MinHashIndex::search(const QVector<quint32> &tokens, int k, double minSimilarity) const
+{
+    QVector<MinHashMatch> matches;
+    if (tokens.isEmpty() || k <= 0 || slotByKey.isEmpty()) {
+        return matches;
+    }
+
+    const int length = signatureSize();
+    std::vector<quint32> query(length);
+    computeSignature(tokens, query.data());
+
+    visitMarks.resize(slotKeys.size(), 0);
+    if (++visitEpoch == 0) {
+        std::fill(visitMarks.begin(), visitMarks.end(), 0);
+        visitEpoch = 1;
+    }
+
+    // Every candidate is scored once, by the first band it shares
+    const int minAgreement = static_cast<int>(std::ceil(minSimilarity * length - 1e-9));
+    for (int band = 0; band < bandCount; ++band) {
+        quint32 slot = bucketHeads.value(bucketKey(band, query.data() + band * rows), NoSlot);
+        for (; slot != NoSlot; slot = nextInBucket[static_cast<size_t>(slot) * bandCount + band]) {
+            if (visitMarks[slot] == visitEpoch) {
+                continue;
+            }
+            visitMarks[slot] = visitEpoch;
+
+            const quint32 *values = signatureOf(slot);
+            int agreement = 0;
+            for (int i = 0; i < length; ++i) {
+                agreement += values[i] == query[i] ? 1 : 0;
+            }
+            if (agreement >= minAgreement) {
+                matches.append({slotKeys[slot], static_cast<float>(agreement) / length});
+            }
+        }
+    }
+
+    const auto better = [](const MinHashMatch &a, const MinHashMatch &b) {
+        return a.similarity != b.similarity ? a.similarity > b.similarity : a.key > b.key;
+    };
+    if (matches.size() > k) {
+        std::partial_sort(matches.begin(), matches.begin() + k, matches.end(), better);
+        matches.resize(k);
+    } else {
+        std::sort(matches.begin(), matches.end(), better);
+    }
+    return matches;
+}
+
+void MinHashIndex::clear()
+{
+    signatures.clear();
+    slotKeys.clear();
+    freeSlots.clear();
+    nextInBucket.clear();
+    previousInBucket.clear();
+    bucketHeads.clear();
+    slotByKey.clear();
+    visitMarks.clear();
+    visitEpoch = 0;
+}
+
+void MinHashIndex::computeSignature(const QVector<quint32> &tokens, quint32 *values) const
+{
+    const int length = signatureSize();
+    std::fill(values, values + length, 0xFFFFFFFFu);
+    for (const quint32 token : tokens) {
+        const quint64 mixed = mix(token);
+        for (int i = 0; i < length; ++i) {
+            values[i] = qMin(values[i], static_cast<quint32>((mixed * multipliers[i] + offsets[i]) >> 32));
+        }
+    }
+}
+
+quint64 MinHashIndex::bucketKey(int band, const quint32 *values) const
+{
+    quint64 key = mix(static_cast<quint64>(band) + 1);
+    for (int r = 0; r < rows; ++r) {
+        key = mix(key ^ values[r]);
+    }
+    return key;
+}
+
+void MinHashIndex::link(quint32 slot)
+{
+    // New slots go to the front, so buckets list the newest first
+    const quint32 *values = signatureOf(slot);
+    for (int band = 0; band < bandCount; ++band) {
+        const size_t link = static_cast<size_t>(slot) * bandCount + band;
+        const quint64 key = bucketKey(band, values + band * rows);
+        auto found = bucketHeads.find(key);
+        if (found == bucketHeads.end()) {
+            found = bucketHeads.insert(key, NoSlot);
+        }
+        quint32 &head = found.value();
+        nextInBucket[link] = head;
+        previousInBucket[link] = NoSlot;
+        if (head != NoSlot) {
+            previousInBucket[static_cast<size_t>(head) * bandCount + band] = slot;
+        }
+        head = slot;
+    }
+}
+
+void MinHashIndex::unlink(quint32 slot)
+{
+    const quint32 *values = signatureOf(slot);
+    for (int band = 0; band < bandCount; ++band) {
+        const size_t link = static_cast<size_t>(slot) * bandCount + band;
+        const quint32 next = nextInBucket[link];
+        const quint32 previous = previousInBucket[link];
+        const quint64 key = bucketKey(band, values + band * rows);
+        if (next != NoSlot) {
+            previousInBucket[static_cast<size_t>(next) * bandCount + band] = previous;
+        }
+        if (previous != NoSlot) {
+            nextInBucket[static_cast<size_t>(previous) * bandCount + band] = next;
+        } else if (next != NoSlot) {
+            bucketHeads[key] = next;
+        } else {
+            bucketHeads.remove(key);
+        }
+        nextInBucket[link] = NoSlot;
+        previousInBucket[link] = NoSlot;
+    }
+}
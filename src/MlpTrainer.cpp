@@ -0,0 +1,374 @@
+#include "MlpTrainer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MLP_TRAINER_HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct MomentumCoefficients {
+    double scale;                    // 1 / samples: the gradient buffers hold sums
+    double momentum;
+    double rate;
+};
+
+// Bias-corrected Adam folded into the step size and epsilon:
+// w -= stepSize * m / (sqrt(v) + epsilon)
+struct AdamCoefficients {
+    double scale;
+    double beta1;
+    double beta2;
+    double stepSize;
+    double epsilon;
+};
+
+using AxpyKernel = void (*)(double a, const double *x, double *y, int count);
+using MomentumKernel = void (*)(double *weights, double *gradients, double *velocity, int count,
+                                const MomentumCoefficients &c);
+using AdamKernel = void (*)(double *weights, double *gradients, double *first, double *second, int count,
+                            const AdamCoefficients &c);
+
+// y += a * x
+void axpyScalar(double a, const double *x, double *y, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        y[i] += a * x[i];
+    }
+}
+
+void momentumScalar(double *weights, double *gradients, double *velocity, int count,
+                    const MomentumCoefficients &c)
+{
+    for (int i = 0; i < count; ++i) {
+        velocity[i] = c.momentum * velocity[i] + c.scale * gradients[i];
+        weights[i] -= c.rate * velocity[i];
+        gradients[i] = 0.0;
+    }
+}
+
+void adamScalar(double *weights, double *gradients, double *first, double *second, int count,
+                const AdamCoefficients &c)
+{
+    for (int i = 0; i < count; ++i) {
+        const double g = c.scale * gradients[i];
+        first[i] = c.beta1 * first[i] + (1.0 - c.beta1) * g;
+        second[i] = c.beta2 * second[i] + (1.0 - c.beta2) * g * g;
+        weights[i] -= c.stepSize * first[i] / (std::sqrt(second[i]) + c.epsilon);
+        gradients[i] = 0.0;
+    }
+}
+
+#ifdef MLP_TRAINER_HAS_X86_KERNELS
+// Bias buffers are not padded, so every kernel finishes with a scalar tail
+
+__attribute__((target("avx2,fma")))
+void axpyAvx2(double a, const double *x, double *y, int count)
+{
+    const __m256d factor = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(factor, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    axpyScalar(a, x + i, y + i, count - i);
+}
+
+__attribute__((target("avx2,fma")))
+void momentumAvx2(double *weights, double *gradients, double *velocity, int count,
+                  const MomentumCoefficients &c)
+{
+    const __m256d scale = _mm256_set1_pd(c.scale);
+    const __m256d momentum = _mm256_set1_pd(c.momentum);
+    const __m256d rate = _mm256_set1_pd(c.rate);
+    const __m256d zero = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d g = _mm256_mul_pd(scale, _mm256_loadu_pd(gradients + i));
+        const __m256d v = _mm256_fmadd_pd(momentum, _mm256_loadu_pd(velocity + i), g);
+        _mm256_storeu_pd(velocity + i, v);
+        _mm256_storeu_pd(weights + i, _mm256_fnmadd_pd(rate, v, _mm256_loadu_pd(weights + i)));
+        _mm256_storeu_pd(gradients + i, zero);
+    }
+    momentumScalar(weights + i, gradients + i, velocity + i, count - i, c);
+}
+
+__attribute__((target("avx2,fma")))
+void adamAvx2(double *weights, double *gradients, double *first, double *second, int count,
+              const AdamCoefficients &c)
+{
+    const __m256d scale = _mm256_set1_pd(c.scale);
+    const __m256d beta1 = _mm256_set1_pd(c.beta1);
+    const __m256d beta2 = _mm256_set1_pd(c.beta2);
+    const __m256d oneMinusBeta1 = _mm256_set1_pd(1.0 - c.beta1);
+    const __m256d oneMinusBeta2 = _mm256_set1_pd(1.0 - c.beta2);
+    const __m256d stepSize = _mm256_set1_pd(c.stepSize);
+    const __m256d epsilon = _mm256_set1_pd(c.epsilon);
+    const __m256d zero = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d g = _mm256_mul_pd(scale, _mm256_loadu_pd(gradients + i));
+        const __m256d m = _mm256_fmadd_pd(beta1, _mm256_loadu_pd(first + i), _mm256_mul_pd(oneMinusBeta1, g));
+        const __m256d v = _mm256_fmadd_pd(beta2, _mm256_loadu_pd(second + i),
+                                          _mm256_mul_pd(oneMinusBeta2, _mm256_mul_pd(g, g)));
+        const __m256d update = _mm256_div_pd(_mm256_mul_pd(stepSize, m), _mm256_add_pd(_mm256_sqrt_pd(v), epsilon));
+        _mm256_storeu_pd(first + i, m);
+        _mm256_storeu_pd(second + i, v);
+        _mm256_storeu_pd(weights + i, _mm256_sub_pd(_mm256_loadu_pd(weights + i), update));
+        _mm256_storeu_pd(gradients + i, zero);
+    }
+    adamScalar(weights + i, gradients + i, first + i, second + i, count - i, c);
+}
+#endif
+
+struct Kernels {
+    AxpyKernel axpy;
+    MomentumKernel momentum;
+    AdamKernel adam;
+    const char *name;
+};
+
+Kernels selectKernels()
+{
+    Kernels selected = {axpyScalar, momentumScalar, adamScalar, "scalar"};
+#ifdef MLP_TRAINER_HAS_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        selected = {axpyAvx2, momentumAvx2, adamAvx2, "avx2"};
+    }
+#endif
+    return selected;
+}
+
+const Kernels &kernels()
+{
+    static const Kernels selected = selectKernels();
+    return selected;
+}
+
+// Zero padded copy of values in a layer's input layout
+AlignedDoubles paddedInput(const double *values, int count, const DenseLayer &layer)
+{
+    AlignedDoubles padded(static_cast<std::size_t>(layer.stride()), 0.0);
+    std::copy_n(values, qMin(count, layer.inputCount()), padded.data());
+    return padded;
+}
+
+} // namespace
+
+MlpTrainer::MlpTrainer(const Mlp &network, const TrainingOptions &options)
+    : settings(options)
+{
+    reset(network);
+}
+
+void MlpTrainer::reset(const Mlp &network)
+{
+    layers.clear();
+    shape.clear();
+    samples = 0;
+    lossSum = 0.0;
+    steps = 0;
+
+    if (network.layerCount() > 0) {
+        shape.append(network.inputSize());
+    }
+    for (int l = 0; l < network.layerCount(); ++l) {
+        const DenseLayer &layer = network.layer(l);
+        const std::size_t weightCount = static_cast<std::size_t>(layer.outputCount()) * layer.stride();
+        const std::size_t biasCount = static_cast<std::size_t>(layer.outputCount());
+        LayerState state;
+        state.weightGradient.assign(weightCount, 0.0);
+        state.biasGradient.assign(biasCount, 0.0);
+        state.weightVelocity.assign(weightCount, 0.0);
+        state.biasVelocity.assign(biasCount, 0.0);
+        if (settings.optimizer == TrainingOptimizer::Adam) {
+            state.weightSecond.assign(weightCount, 0.0);
+            state.biasSecond.assign(biasCount, 0.0);
+        }
+        layers.append(std::move(state));
+        shape.append(layer.outputCount());
+    }
+}
+
+void MlpTrainer::setOptions(const TrainingOptions &options)
+{
+    const bool optimizerChanged = options.optimizer != settings.optimizer;
+    settings = options;
+    if (!optimizerChanged) {
+        return;
+    }
+
+    // The accumulated gradient stays valid, the optimizer state does not
+    steps = 0;
+    for (LayerState &state : layers) {
+        std::fill(state.weightVelocity.begin(), state.weightVelocity.end(), 0.0);
+        std::fill(state.biasVelocity.begin(), state.biasVelocity.end(), 0.0);
+        if (settings.optimizer == TrainingOptimizer::Adam) {
+            state.weightSecond.assign(state.weightGradient.size(), 0.0);
+            state.biasSecond.assign(state.biasGradient.size(), 0.0);
+        } else {
+            state.weightSecond = AlignedDoubles();
+            state.biasSecond = AlignedDoubles();
+        }
+    }
+}
+
+bool MlpTrainer::matches(const Mlp &network) const
+{
+    if (layers.size() != network.layerCount() || shape.isEmpty() || shape.first() != network.inputSize()) {
+        return false;
+    }
+    for (int l = 0; l < network.layerCount(); ++l) {
+        if (shape[l + 1] != network.layer(l).outputCount()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double MlpTrainer::accumulate(const Mlp &network, const SparseVector &input, const QVector<double> &target)
+{
+    if (network.layerCount() == 0) {
+        return 0.0;
+    }
+    if (!matches(network)) {
+        reset(network);
+    }
+    QVector<QVector<double>> activations;
+    network.forward(input, &activations);
+    return backward(network, &input, nullptr, activations, target);
+}
+
+double MlpTrainer::accumulate(const Mlp &network, const QVector<double> &input, const QVector<double> &target)
+{
+    if (network.layerCount() == 0) {
+        return 0.0;
+    }
+    if (!matches(network)) {
+        reset(network);
+    }
+    QVector<QVector<double>> activations;
+    network.forward(input, &activations);
+    const AlignedDoubles padded = paddedInput(input.constData(), static_cast<int>(input.size()), network.layer(0));
+    return backward(network, nullptr, padded.data(), activations, target);
+}
+
+double MlpTrainer::backward(const Mlp &network, const SparseVector *sparseInput, const double *denseInput,
+                            const QVector<QVector<double>> &activations, const QVector<double> &target)
+{
+    const AxpyKernel axpy = kernels().axpy;
+
+    // Output delta: dLoss/dz = (y - t) * y * (1 - y) for a sigmoid output y
+    const QVector<double> &output = activations.last();
+    QVector<double> delta(output.size());
+    double loss = 0.0;
+    for (int i = 0; i < output.size(); ++i) {
+        const double error = output[i] - (i < target.size() ? target[i] : 0.0);
+        loss += 0.5 * error * error;
+        delta[i] = error * output[i] * (1.0 - output[i]);
+    }
+
+    for (int l = network.layerCount() - 1; l >= 0; --l) {
+        const DenseLayer &layer = network.layer(l);
+        LayerState &state = layers[l];
+        const int stride = layer.stride();
+
+        axpy(1.0, delta.constData(), state.biasGradient.data(), layer.outputCount());
+
+        if (l == 0 && sparseInput) {
+            // Only the columns of the non-zero features get a gradient
+            const int nonZero = sparseInput->nonZeroCount();
+            for (int i = 0; i < layer.outputCount(); ++i) {
+                if (delta[i] == 0.0) {
+                    continue;
+                }
+                double *gradientRow = state.weightGradient.data() + static_cast<std::size_t>(i) * stride;
+                for (int k = 0; k < nonZero; ++k) {
+                    if (sparseInput->indices[k] < static_cast<quint32>(layer.inputCount())) {
+                        gradientRow[sparseInput->indices[k]] += delta[i] * sparseInput->values[k];
+                    }
+                }
+            }
+            break;
+        }
+
+        // Dense layer input: the previous activations (or the input), padded like a weight row
+        const AlignedDoubles previous = l > 0 ? paddedInput(activations[l - 1].constData(),
+                                                            static_cast<int>(activations[l - 1].size()), layer)
+                                              : AlignedDoubles();
+        const double *layerInput = l > 0 ? previous.data() : denseInput;
+        for (int i = 0; i < layer.outputCount(); ++i) {
+            axpy(delta[i], layerInput, state.weightGradient.data() + static_cast<std::size_t>(i) * stride, stride);
+        }
+        if (l == 0) {
+            break;
+        }
+
+        // Propagate: W^T delta, row by row, then through the previous sigmoid
+        AlignedDoubles propagated(static_cast<std::size_t>(stride), 0.0);
+        for (int i = 0; i < layer.outputCount(); ++i) {
+            axpy(delta[i], layer.row(i), propagated.data(), stride);
+        }
+        const QVector<double> &hidden = activations[l - 1];
+        delta = QVector<double>(hidden.size());
+        for (int j = 0; j < hidden.size(); ++j) {
+            delta[j] = propagated[j] * hidden[j] * (1.0 - hidden[j]);
+        }
+    }
+
+    samples++;
+    lossSum += loss;
+    return loss;
+}
+
+TrainingStep MlpTrainer::step(Mlp &network, double learningRate)
+{
+    TrainingStep result;
+    if (samples == 0 || !matches(network)) {
+        return result;
+    }
+
+    steps++;
+    const double scale = 1.0 / samples;
+    if (settings.optimizer == TrainingOptimizer::Adam) {
+        const double beta1 = settings.momentum;
+        const double beta2 = settings.secondMomentDecay;
+        const double correction1 = 1.0 - std::pow(beta1, static_cast<double>(steps));
+        const double correction2 = std::sqrt(1.0 - std::pow(beta2, static_cast<double>(steps)));
+        const AdamCoefficients c = {scale, beta1, beta2, learningRate * correction2 / correction1,
+                                    settings.epsilon * correction2};
+        for (int l = 0; l < layers.size(); ++l) {
+            DenseLayer &layer = network.layer(l);
+            LayerState &state = layers[l];
+            kernels().adam(layer.row(0), state.weightGradient.data(), state.weightVelocity.data(),
+                           state.weightSecond.data(), static_cast<int>(state.weightGradient.size()), c);
+            kernels().adam(layer.biasData(), state.biasGradient.data(), state.biasVelocity.data(),
+                           state.biasSecond.data(), static_cast<int>(state.biasGradient.size()), c);
+        }
+    } else {
+        const MomentumCoefficients c = {scale, settings.momentum, learningRate};
+        for (int l = 0; l < layers.size(); ++l) {
+            DenseLayer &layer = network.layer(l);
+            LayerState &state = layers[l];
+            kernels().momentum(layer.row(0), state.weightGradient.data(), state.weightVelocity.data(),
+                               static_cast<int>(state.weightGradient.size()), c);
+            kernels().momentum(layer.biasData(), state.biasGradient.data(), state.biasVelocity.data(),
+                               static_cast<int>(state.biasGradient.size()), c);
+        }
+    }
+
+    result.samples = samples;
+    result.loss = lossSum / samples;
+    result.step = steps;
+    samples = 0;
+    lossSum = 0.0;
+    return result;
+}
+
+QString MlpTrainer::kernelName()
+{
+    return QString::fromLatin1(kernels().name);
+}
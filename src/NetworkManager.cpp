@@ -6,9 +6,16 @@
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
+#include <QtCore/QDateTime>
 #include <QtNetwork/QNetworkRequest>
 #include <QtNetwork/QNetworkReply>
 
+namespace {
+
+const QString NoSearchResults = QStringLiteral("Žiadne relevantné výsledky nenájdené.");
+
+} // namespace
+
 NetworkManager::NetworkManager(QObject *parent)
     : QObject(parent)
     , networkManager(new QNetworkAccessManager(this))
@@ -80,6 +87,12 @@ void NetworkManager::searchWeb(const QString &query)
         return;
     }
     
+    QNetworkReply *reply = networkManager->get(searchRequest(query));
+    pendingRequests[reply] = "web_search";
+}
+
+QNetworkRequest NetworkManager::searchRequest(const QString &query) const
+{
     // Use DuckDuckGo Instant Answer API
     QUrl url(searchApiUrl);
     QUrlQuery urlQuery;
@@ -91,9 +104,7 @@ void NetworkManager::searchWeb(const QString &query)
     
     QNetworkRequest request(url);
     request.setHeader(QNetworkRequest::UserAgentHeader, userAgent);
-    
-    QNetworkReply *reply = networkManager->get(request);
-    pendingRequests[reply] = "web_search";
+    return request;
 }
 
 void NetworkManager::queryAI(const QString &prompt, const QString &context)
@@ -112,18 +123,46 @@ void NetworkManager::queryAI(const QString &prompt, const QString &context)
         return;
     }
     
+    QNetworkReply *reply = networkManager->post(aiRequest(), aiRequestBody(prompt, context));
+    pendingRequests[reply] = "ai_query";
+}
+
+QNetworkRequest NetworkManager::aiRequest() const
+{
+    QNetworkRequest request(QUrl(aiApiUrl));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+    request.setHeader(QNetworkRequest::UserAgentHeader, userAgent);
+    request.setRawHeader("Authorization", QString("Bearer %1").arg(apiKey).toUtf8());
+    return request;
+}
+
+QByteArray NetworkManager::aiRequestBody(const QString &prompt, const QString &system,
+                                         const QVector<ConversationTurn> &history, bool stream) const
+{
     // Prepare OpenAI API request
     QJsonObject json;
     json["model"] = "gpt-3.5-turbo";
     
     QJsonArray messages;
-    if (!context.isEmpty()) {
+    if (!system.isEmpty()) {
         QJsonObject contextMsg;
         contextMsg["role"] = "system";
-        contextMsg["content"] = context;
+        contextMsg["content"] = system;
         messages.append(contextMsg);
     }
     
+    for (const ConversationTurn &turn : history) {
+        QJsonObject userTurn;
+        userTurn["role"] = "user";
+        userTurn["content"] = turn.message;
+        messages.append(userTurn);
+        
+        QJsonObject assistantTurn;
+        assistantTurn["role"] = "assistant";
+        assistantTurn["content"] = turn.response;
+        messages.append(assistantTurn);
+    }
+    
     QJsonObject userMsg;
     userMsg["role"] = "user";
     userMsg["content"] = prompt;
@@ -132,15 +171,77 @@ void NetworkManager::queryAI(const QString &prompt, const QString &context)
     json["messages"] = messages;
     json["max_tokens"] = 1000;
     json["temperature"] = 0.7;
-    
-    QNetworkRequest request(QUrl(aiApiUrl));
-    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
-    request.setHeader(QNetworkRequest::UserAgentHeader, userAgent);
-    request.setRawHeader("Authorization", QString("Bearer %1").arg(apiKey).toUtf8());
+    if (stream) {
+        json["stream"] = true;
+    }
     
     QJsonDocument doc(json);
-    QNetworkReply *reply = networkManager->post(request, doc.toJson());
-    pendingRequests[reply] = "ai_query";
+    return doc.toJson();
+}
+
+QNetworkReply *NetworkManager::startWebSearch(const QString &query)
+{
+    if (!connected) {
+        return nullptr;
+    }
+    return networkManager->get(searchRequest(query));
+}
+
+QNetworkReply *NetworkManager::startAIQuery(const QString &prompt, const ConversationContext &context)
+{
+    if (!connected || apiKey.isEmpty()) {
+        return nullptr;
+    }
+    return networkManager->post(aiRequest(), aiRequestBody(prompt, context.systemPrompt(), context.turns, true));
+}
+
+bool NetworkManager::hasApiKey() const
+{
+    return !apiKey.isEmpty();
+}
+
+QString NetworkManager::searchAnswer(const QByteArray &data)
+{
+    const QJsonObject results = parseResponse(data);
+    if (results.contains("error")) {
+        return QString();
+    }
+    const QString formatted = formatSearchResults(results);
+    return formatted == NoSearchResults ? QString() : formatted;
+}
+
+QString NetworkManager::aiAnswer(const QByteArray &data)
+{
+    // Extract AI response from OpenAI format
+    const QJsonArray choices = parseResponse(data)["choices"].toArray();
+    if (choices.isEmpty()) {
+        return QString();
+    }
+    return choices[0].toObject()["message"].toObject()["content"].toString();
+}
+
+QString NetworkManager::takeStreamedContent(QByteArray *buffer)
+{
+    QString content;
+    qsizetype start = 0;
+    qsizetype end;
+    while ((end = buffer->indexOf('\n', start)) >= 0) {
+        const QByteArray line = buffer->mid(start, end - start).trimmed();
+        start = end + 1;
+        if (!line.startsWith("data:")) {
+            continue;
+        }
+        const QByteArray payload = line.mid(5).trimmed();
+        if (payload == "[DONE]") {
+            continue;
+        }
+        const QJsonArray choices = QJsonDocument::fromJson(payload).object()["choices"].toArray();
+        if (!choices.isEmpty()) {
+            content += choices[0].toObject()["delta"].toObject()["content"].toString();
+        }
+    }
+    buffer->remove(0, start);
+    return content;
 }
 
 void NetworkManager::downloadCode(const QString &repository)
@@ -215,10 +316,10 @@ void NetworkManager::makeGetRequest(const QUrl &url)
     makeRequest(url, "GET");
 }
 
-void NetworkManager::onNetworkReplyFinished()
+void NetworkManager::onNetworkReplyFinished(QNetworkReply *reply)
 {
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
-    if (!reply) return;
+    // Replies handed out by startWebSearch/startAIQuery belong to the caller
+    if (!reply || !pendingRequests.contains(reply)) return;
     
     QString requestType = pendingRequests.take(reply);
     
@@ -393,7 +494,7 @@ QString NetworkManager::formatSearchResults(const QJsonObject &results)
     }
     
     if (formatted == "Výsledky vyhľadávania:\n\n") {
-        formatted = "Žiadne relevantné výsledky nenájdené.";
+        formatted = NoSearchResults;
     }
     
     return formatted;
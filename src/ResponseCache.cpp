@@ -0,0 +1,300 @@
+#include "ResponseCache.h"
+
+namespace {
+
+const int SketchRows = 4;
+const quint8 MaxFrequency = 255;
+
+inline quint64 mixHash(quint64 value)
+{
+    // splitmix64 finalizer
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+} // namespace
+
+void ResponseCache::FrequencySketch::resize(int capacity)
+{
+    int width = 16;
+    while (width < capacity) {
+        width <<= 1;
+    }
+    table = QVector<quint8>(width * SketchRows, 0);
+    mask = width - 1;
+    additions = 0;
+    sampleSize = 10 * qMax(1, capacity);
+}
+
+int ResponseCache::FrequencySketch::index(size_t hash, int row) const
+{
+    const quint64 mixed = mixHash(static_cast<quint64>(hash) + 0x9e3779b97f4a7c15ULL * (row + 1));
+    return row * (mask + 1) + static_cast<int>(mixed & static_cast<quint64>(mask));
+}
+
+void ResponseCache::FrequencySketch::increment(size_t hash)
+{
+    for (int row = 0; row < SketchRows; ++row) {
+        quint8 &counter = table[index(hash, row)];
+        if (counter < MaxFrequency) {
+            counter++;
+        }
+    }
+
+    // Aging: halve every counter after sampleSize additions
+    if (++additions >= sampleSize) {
+        for (quint8 &counter : table) {
+            counter >>= 1;
+        }
+        additions /= 2;
+    }
+}
+
+int ResponseCache::FrequencySketch::estimate(size_t hash) const
+{
+    int frequency = MaxFrequency;
+    for (int row = 0; row < SketchRows; ++row) {
+        frequency = qMin(frequency, static_cast<int>(table[index(hash, row)]));
+    }
+    return frequency;
+}
+
+ResponseCache::ResponseCache(int capacity)
+    : invalidationGeneration(0)
+{
+    updateCapacities(capacity);
+}
+
+bool ResponseCache::lookup(const QString &text, quint64 context, QString *response)
+{
+    const ResponseCacheKey key{text, context};
+
+    QMutexLocker locker(&mutex);
+    sketch.increment(qHash(key));
+
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        counters.misses++;
+        return false;
+    }
+
+    counters.hits++;
+    promote(it.value());
+    if (response) {
+        *response = it->response;
+    }
+    return true;
+}
+
+bool ResponseCache::insert(const QString &text, quint64 context, const QString &response,
+                           const QStringList &dependencies, quint64 generation)
+{
+    const ResponseCacheKey key{text, context};
+
+    QMutexLocker locker(&mutex);
+    if (generation != invalidationGeneration) {
+        return false; // May have been computed from data that has changed since
+    }
+    if (entries.contains(key)) {
+        remove(key);
+    }
+
+    windowLru.push_front(key);
+    Entry &entry = entries[key];
+    entry.response = response;
+    entry.dependencies = dependencies;
+    entry.segment = Window;
+    entry.position = windowLru.begin();
+    for (const QString &dependency : dependencies) {
+        dependents[dependency].insert(key);
+    }
+    counters.insertions++;
+
+    if (static_cast<int>(windowLru.size()) > windowCapacity) {
+        admitFromWindow();
+    }
+    return true;
+}
+
+quint64 ResponseCache::generation() const
+{
+    QMutexLocker locker(&mutex);
+    return invalidationGeneration;
+}
+
+int ResponseCache::invalidate(const QString &dependency)
+{
+    return invalidate(QStringList{dependency});
+}
+
+int ResponseCache::invalidate(const QStringList &dependencies)
+{
+    QMutexLocker locker(&mutex);
+    invalidationGeneration++;
+
+    int dropped = 0;
+    for (const QString &dependency : dependencies) {
+        const QSet<ResponseCacheKey> keys = dependents.take(dependency);
+        for (const ResponseCacheKey &key : keys) {
+            if (entries.contains(key)) {
+                remove(key);
+                dropped++;
+            }
+        }
+    }
+
+    counters.invalidations += dropped;
+    return dropped;
+}
+
+void ResponseCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    invalidationGeneration++;
+    counters.invalidations += entries.size();
+    entries.clear();
+    dependents.clear();
+    windowLru.clear();
+    probationLru.clear();
+    protectedLru.clear();
+}
+
+void ResponseCache::setCapacity(int capacity)
+{
+    QMutexLocker locker(&mutex);
+    updateCapacities(capacity);
+    evictOverflow();
+}
+
+int ResponseCache::capacity() const
+{
+    QMutexLocker locker(&mutex);
+    return maxEntries;
+}
+
+int ResponseCache::size() const
+{
+    QMutexLocker locker(&mutex);
+    return entries.size();
+}
+
+ResponseCacheStats ResponseCache::stats() const
+{
+    QMutexLocker locker(&mutex);
+    return counters;
+}
+
+void ResponseCache::resetStats()
+{
+    QMutexLocker locker(&mutex);
+    counters = ResponseCacheStats();
+}
+
+void ResponseCache::updateCapacities(int capacity)
+{
+    maxEntries = qMax(2, capacity);
+    windowCapacity = qMax(1, maxEntries / 100);
+    protectedCapacity = qMax(1, (maxEntries - windowCapacity) * 4 / 5);
+    sketch.resize(maxEntries);
+}
+
+ResponseCache::KeyList &ResponseCache::listFor(Segment segment)
+{
+    switch (segment) {
+    case Window:
+        return windowLru;
+    case Probation:
+        return probationLru;
+    case Protected:
+    default:
+        return protectedLru;
+    }
+}
+
+void ResponseCache::moveTo(Entry &entry, Segment segment)
+{
+    KeyList &target = listFor(segment);
+    target.splice(target.begin(), listFor(entry.segment), entry.position);
+    entry.segment = segment;
+    entry.position = target.begin();
+}
+
+void ResponseCache::promote(Entry &entry)
+{
+    if (entry.segment != Probation) {
+        moveTo(entry, entry.segment);
+        return;
+    }
+
+    // A second hit moves the entry to protected; its LRU tail drops back to probation
+    moveTo(entry, Protected);
+    if (static_cast<int>(protectedLru.size()) > protectedCapacity) {
+        moveTo(entries[protectedLru.back()], Probation);
+    }
+}
+
+void ResponseCache::admitFromWindow()
+{
+    const ResponseCacheKey candidate = windowLru.back();
+    moveTo(entries[candidate], Probation);
+
+    const int mainCapacity = maxEntries - windowCapacity;
+    if (static_cast<int>(probationLru.size() + protectedLru.size()) <= mainCapacity) {
+        return;
+    }
+
+    // Main segment is full: the candidate must beat the probation victim
+    ResponseCacheKey victim = probationLru.back();
+    if (victim == candidate) {
+        victim = protectedLru.back();
+    }
+
+    if (sketch.estimate(qHash(candidate)) > sketch.estimate(qHash(victim))) {
+        remove(victim);
+    } else {
+        remove(candidate);
+    }
+    counters.evictions++;
+}
+
+void ResponseCache::remove(const ResponseCacheKey &key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return;
+    }
+
+    for (const QString &dependency : std::as_const(it->dependencies)) {
+        auto dependent = dependents.find(dependency);
+        if (dependent != dependents.end()) {
+            dependent->remove(key);
+            if (dependent->isEmpty()) {
+                dependents.erase(dependent);
+            }
+        }
+    }
+
+    listFor(it->segment).erase(it->position);
+    entries.erase(it);
+}
+
+void ResponseCache::evictOverflow()
+{
+    while (entries.size() > maxEntries) {
+        const KeyList &source = !probationLru.empty() ? probationLru
+                              : !protectedLru.empty() ? protectedLru : windowLru;
+        const ResponseCacheKey victim = source.back();
+        remove(victim);
+        counters.evictions++;
+    }
+    while (static_cast<int>(windowLru.size()) > windowCapacity) {
+        moveTo(entries[windowLru.back()], Probation);
+    }
+    while (static_cast<int>(protectedLru.size()) > protectedCapacity) {
+        moveTo(entries[protectedLru.back()], Probation);
+    }
+}
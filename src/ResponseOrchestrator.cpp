@@ -0,0 +1,386 @@
+#include "ResponseOrchestrator.h"
+#include "NetworkManager.h"
+
+#include <QtCore/QDeadlineTimer>
+
+namespace {
+
+// Answer ranking: a confident local answer (learned response, fact, code)
+// beats everything, the neural fallback phrases lose to any network answer
+const int FallbackLocalScore = 0;
+const int SearchScore = 1;
+const int RemoteScore = 2;
+const int ConfidentLocalScore = 3;
+
+const int SourceScores[ResponseSourceCount] = {ConfidentLocalScore, SearchScore, RemoteScore};
+
+// Weight of the newest sample in the moving latency average
+const double LatencySmoothing = 0.2;
+
+// A too slow source is still launched every ProbeInterval-th request
+const int ProbeInterval = 10;
+
+} // namespace
+
+ResponseOrchestrator::ResponseOrchestrator(QObject *parent)
+    : QObject(parent)
+    , budgetMsec(0)
+{
+}
+
+void ResponseOrchestrator::setNetworkManager(NetworkManager *manager)
+{
+    networkManager = manager;
+}
+
+void ResponseOrchestrator::setBudget(int msec)
+{
+    budgetMsec.storeRelease(qMax(0, msec));
+}
+
+int ResponseOrchestrator::budget() const
+{
+    return budgetMsec.loadAcquire();
+}
+
+void ResponseOrchestrator::start(quint64 requestId, const QString &message, const ConversationContext &context)
+{
+    const int budget = budgetMsec.loadAcquire();
+    NetworkManager *manager = networkManager.data();
+    if (budget <= 0 || !manager || !manager->isConnected()) {
+        return;
+    }
+
+    auto race = std::make_shared<Race>();
+    race->clock.start();
+    race->budgetMsec = budget;
+
+    {
+        // Pending from now on, so a fast local answer still waits for the launch
+        QMutexLocker locker(&mutex);
+        race->candidates[int(ResponseSource::Search)].pending = shouldLaunch(ResponseSource::Search, budget);
+        race->candidates[int(ResponseSource::Remote)].pending =
+            manager->hasApiKey() && shouldLaunch(ResponseSource::Remote, budget);
+        if (bestPending(*race) == 0) {
+            return;
+        }
+        races.insert(requestId, race);
+    }
+
+    // Replies belong to the network manager's thread
+    QMetaObject::invokeMethod(this, [this, requestId, message, context]() {
+        launch(requestId, message, context);
+    });
+}
+
+void ResponseOrchestrator::launch(quint64 requestId, const QString &message, const ConversationContext &context)
+{
+    std::shared_ptr<Race> race;
+    {
+        QMutexLocker locker(&mutex);
+        race = races.value(requestId);
+    }
+    // Resolved or cancelled before the launch got its turn
+    if (!race) {
+        return;
+    }
+
+    for (int s = int(ResponseSource::Search); s < ResponseSourceCount; ++s) {
+        const ResponseSource source = static_cast<ResponseSource>(s);
+        {
+            QMutexLocker locker(&mutex);
+            if (!race->candidates[s].pending || race->cancelled) {
+                continue;
+            }
+        }
+
+        QNetworkReply *reply = nullptr;
+        if (networkManager) {
+            reply = source == ResponseSource::Search ? networkManager->startWebSearch(message)
+                                                     : networkManager->startAIQuery(message, context);
+        }
+
+        QMutexLocker locker(&mutex);
+        if (!reply) {
+            race->candidates[s].pending = false;
+            stats[s].failed++;
+            answered.wakeAll();
+            continue;
+        }
+        // Resolved or cancelled while the request was being made
+        if (!race->candidates[s].pending || race->cancelled) {
+            reply->abort();
+            reply->deleteLater();
+            continue;
+        }
+        stats[s].launched++;
+        race->replies[s] = reply;
+        if (source == ResponseSource::Remote) {
+            connect(reply, &QNetworkReply::readyRead, this, [this, requestId, reply]() {
+                onReplyReadyRead(requestId, reply);
+            });
+        }
+        connect(reply, &QNetworkReply::finished, this, [this, requestId, source, reply]() {
+            onReplyFinished(requestId, source, reply);
+        });
+    }
+}
+
+void ResponseOrchestrator::onReplyReadyRead(quint64 requestId, QNetworkReply *reply)
+{
+    const QByteArray data = reply->readAll();
+
+    QMutexLocker locker(&mutex);
+    const std::shared_ptr<Race> race = races.value(requestId);
+    if (!race || !race->candidates[int(ResponseSource::Remote)].pending) {
+        return;
+    }
+
+    // Deltas count as soon as their event line is complete
+    Candidate &candidate = race->candidates[int(ResponseSource::Remote)];
+    candidate.body.append(data);
+    candidate.buffer.append(data);
+    const QString delta = NetworkManager::takeStreamedContent(&candidate.buffer);
+    if (delta.isEmpty()) {
+        return;
+    }
+    if (candidate.streamed.isEmpty()) {
+        recordLatency(ResponseSource::Remote, race->clock.elapsed());
+    }
+    candidate.streamed += delta;
+    answered.wakeAll();
+}
+
+void ResponseOrchestrator::onReplyFinished(quint64 requestId, ResponseSource source, QNetworkReply *reply)
+{
+    reply->deleteLater();
+
+    // Aborted losers end up here too, after their race is gone
+    const bool succeeded = reply->error() == QNetworkReply::NoError && networkManager;
+    const QByteArray data = succeeded ? reply->readAll() : QByteArray();
+    QString answer;
+    if (succeeded && source == ResponseSource::Search) {
+        answer = networkManager->searchAnswer(data);
+    }
+
+    QMutexLocker locker(&mutex);
+    const std::shared_ptr<Race> race = races.value(requestId);
+    if (!race || !race->candidates[int(source)].pending) {
+        return;
+    }
+
+    Candidate &candidate = race->candidates[int(source)];
+    const bool streamStarted = !candidate.streamed.isEmpty();
+    if (succeeded && source == ResponseSource::Remote) {
+        // The rest of the event stream; a server that ignores "stream"
+        // answers with one JSON document
+        candidate.body.append(data);
+        candidate.buffer.append(data).append('\n');
+        candidate.streamed += NetworkManager::takeStreamedContent(&candidate.buffer);
+        answer = candidate.streamed.isEmpty() ? networkManager->aiAnswer(candidate.body) : candidate.streamed;
+    }
+
+    candidate.pending = false;
+    if (answer.isEmpty()) {
+        stats[int(source)].failed++;
+    } else {
+        candidate.answered = true;
+        candidate.answer = answer;
+        candidate.score = SourceScores[int(source)];
+        if (!streamStarted) {
+            recordLatency(source, race->clock.elapsed());
+        }
+    }
+    answered.wakeAll();
+}
+
+QString ResponseOrchestrator::resolve(quint64 requestId, const QString &localAnswer, bool localConfident,
+                                      ResponseSource *winner, const ChunkHandler &onChunk)
+{
+    if (winner) {
+        *winner = ResponseSource::Local;
+    }
+
+    QMutexLocker locker(&mutex);
+    const std::shared_ptr<Race> race = races.value(requestId);
+    if (!race) {
+        return localAnswer;
+    }
+
+    stats[int(ResponseSource::Local)].launched++;
+    recordLatency(ResponseSource::Local, race->clock.elapsed());
+    Candidate &local = race->candidates[int(ResponseSource::Local)];
+    local.answered = true;
+    local.answer = localAnswer;
+    local.score = localConfident ? ConfidentLocalScore : FallbackLocalScore;
+
+    // Wait while a running source could still beat the best answer in hand.
+    // The remote model scores highest of the network sources, so while it
+    // runs here it is the one that could; with its first delta in, it wins.
+    ResponseSource best = ResponseSource::Local;
+    Candidate &remote = race->candidates[int(ResponseSource::Remote)];
+    bool streaming = false;
+    while (!race->cancelled && bestPending(*race) > bestAnswer(*race, &best)) {
+        if (onChunk && remote.pending && !remote.streamed.isEmpty()) {
+            streaming = true;
+            break;
+        }
+        const qint64 remaining = race->budgetMsec - race->clock.elapsed();
+        if (remaining <= 0) {
+            break;
+        }
+        answered.wait(&mutex, QDeadlineTimer(remaining));
+    }
+    const qint64 elapsed = race->clock.elapsed();
+
+    // Pass the deltas on until the reply is complete; it stays in races for that
+    qsizetype delivered = 0;
+    while (streaming && !race->cancelled) {
+        if (remote.streamed.size() > delivered) {
+            const QString chunk = remote.streamed.mid(delivered);
+            delivered = remote.streamed.size();
+            locker.unlock();
+            onChunk(chunk);
+            locker.relock();
+        } else if (remote.pending) {
+            answered.wait(&mutex);
+        } else {
+            break;
+        }
+    }
+    bestAnswer(*race, &best);
+    if (streaming) {
+        best = ResponseSource::Remote;
+    }
+
+    if (race->cancelled) {
+        return localAnswer;
+    }
+
+    // Whatever is still running missed the deadline or cannot win any more;
+    // only a missed deadline says something about the source's latency
+    for (int s = int(ResponseSource::Search); s < ResponseSourceCount; ++s) {
+        if (race->candidates[s].pending) {
+            race->candidates[s].pending = false;
+            if (elapsed >= race->budgetMsec) {
+                stats[s].late++;
+                recordLatency(static_cast<ResponseSource>(s), elapsed);
+            }
+        }
+    }
+    stats[int(best)].wins++;
+    races.remove(requestId);
+    locker.unlock();
+
+    abortReplies(race);
+
+    // A remote answer that broke off midway ends with what was shown of it
+    const QString answer = streaming ? remote.streamed : race->candidates[int(best)].answer;
+    if (onChunk && best == ResponseSource::Remote && answer.size() > delivered) {
+        onChunk(answer.mid(delivered));
+    }
+    if (winner) {
+        *winner = best;
+    }
+    return answer;
+}
+
+void ResponseOrchestrator::cancel(quint64 requestId)
+{
+    QMutexLocker locker(&mutex);
+    const std::shared_ptr<Race> race = races.take(requestId);
+    if (!race) {
+        return;
+    }
+    race->cancelled = true;
+    answered.wakeAll();
+    locker.unlock();
+
+    abortReplies(race);
+}
+
+void ResponseOrchestrator::abortReplies(const std::shared_ptr<Race> &race)
+{
+    // Replies live on this object's thread; queued so that callers on
+    // that thread do not re-enter onReplyFinished
+    QMetaObject::invokeMethod(this, [race]() {
+        for (const QPointer<QNetworkReply> &reply : race->replies) {
+            if (reply && reply->isRunning()) {
+                reply->abort();
+            }
+        }
+    }, Qt::QueuedConnection);
+}
+
+SourceStats ResponseOrchestrator::sourceStats(ResponseSource source) const
+{
+    QMutexLocker locker(&mutex);
+    return stats[int(source)];
+}
+
+QString ResponseOrchestrator::sourceName(ResponseSource source)
+{
+    switch (source) {
+    case ResponseSource::Local:
+        return "lokálna odpoveď";
+    case ResponseSource::Search:
+        return "webové vyhľadávanie";
+    case ResponseSource::Remote:
+        return "vzdialený model";
+    }
+    return QString();
+}
+
+bool ResponseOrchestrator::shouldLaunch(ResponseSource source, int budgetMsec)
+{
+    // Called with the mutex held
+    const int s = int(source);
+    if (stats[s].latencyMsec <= budgetMsec) {
+        skipStreak[s] = 0;
+        return true;
+    }
+    if (++skipStreak[s] < ProbeInterval) {
+        stats[s].skipped++;
+        return false;
+    }
+    skipStreak[s] = 0;
+    return true;
+}
+
+void ResponseOrchestrator::recordLatency(ResponseSource source, qint64 msec)
+{
+    // Called with the mutex held
+    SourceStats &sourceStats = stats[int(source)];
+    if (sourceStats.latencyMsec == 0.0) {
+        sourceStats.latencyMsec = msec;
+    } else {
+        sourceStats.latencyMsec += LatencySmoothing * (msec - sourceStats.latencyMsec);
+    }
+}
+
+int ResponseOrchestrator::bestAnswer(const Race &race, ResponseSource *source) const
+{
+    // Ties go to the cheaper source (lower enum value)
+    int best = -1;
+    for (int s = 0; s < ResponseSourceCount; ++s) {
+        const Candidate &candidate = race.candidates[s];
+        if (candidate.answered && candidate.score > best) {
+            best = candidate.score;
+            *source = static_cast<ResponseSource>(s);
+        }
+    }
+    return best;
+}
+
+int ResponseOrchestrator::bestPending(const Race &race) const
+{
+    int best = 0;
+    for (int s = 0; s < ResponseSourceCount; ++s) {
+        if (race.candidates[s].pending) {
+            best = qMax(best, SourceScores[s]);
+        }
+    }
+    return best;
+}
+
+#include "ResponseOrchestrator.moc"
@@ -0,0 +1,137 @@
+#include "ResponseStore.h"
+
+#include <algorithm>
+
+namespace {
+
+// Rough per-entry bookkeeping: hash nodes, set node, string header
+const qint64 EntryOverhead = 96;
+
+} // namespace
+
+ResponseStore::ResponseStore(qint64 memoryLimit)
+    : index(nullptr),
+      nextFreeId(0),
+      maxBytes(memoryLimit),
+      usedBytes(0),
+      evictions(0)
+{
+}
+
+quint32 ResponseStore::intern(const QString &text)
+{
+    const size_t hash = qHash(text);
+    for (auto it = byContent.constFind(hash); it != byContent.constEnd() && it.key() == hash; ++it) {
+        auto entry = entries.find(it.value());
+        if (entry->text == text) {
+            byCount.erase({entry->count, it.value()});
+            entry->count++;
+            byCount.insert({entry->count, it.value()});
+            return it.value();
+        }
+    }
+
+    const quint32 id = nextFreeId++;
+    store(id, text, 1);
+    evictOverflow(id);
+    return id;
+}
+
+bool ResponseStore::contains(quint32 id) const
+{
+    return entries.contains(id);
+}
+
+QString ResponseStore::response(quint32 id) const
+{
+    auto it = entries.constFind(id);
+    return it != entries.constEnd() ? it->text : QString();
+}
+
+quint32 ResponseStore::count(quint32 id) const
+{
+    auto it = entries.constFind(id);
+    return it != entries.constEnd() ? it->count : 0;
+}
+
+QVector<quint32> ResponseStore::ids() const
+{
+    QVector<quint32> result = entries.keys();
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void ResponseStore::restore(quint32 id, const QString &text, quint32 count)
+{
+    if (entries.contains(id)) {
+        remove(id);
+    }
+    store(id, text, qMax<quint32>(1, count));
+    nextFreeId = qMax(nextFreeId, id + 1);
+    evictOverflow(id);
+}
+
+void ResponseStore::setNextId(quint32 id)
+{
+    nextFreeId = qMax(nextFreeId, id);
+}
+
+void ResponseStore::setMemoryLimit(qint64 bytes)
+{
+    maxBytes = qMax<qint64>(0, bytes);
+    evictOverflow(nextFreeId);
+}
+
+void ResponseStore::clear()
+{
+    entries.clear();
+    byContent.clear();
+    byCount.clear();
+    nextFreeId = 0;
+    usedBytes = 0;
+}
+
+qint64 ResponseStore::entryCost(const QString &text)
+{
+    return EntryOverhead + static_cast<qint64>(text.size()) * static_cast<qint64>(sizeof(QChar));
+}
+
+void ResponseStore::store(quint32 id, const QString &text, quint32 count)
+{
+    entries.insert(id, {text, count});
+    byContent.insert(qHash(text), id);
+    byCount.insert({count, id});
+    usedBytes += entryCost(text);
+}
+
+void ResponseStore::remove(quint32 id)
+{
+    auto it = entries.find(id);
+    if (it == entries.end()) {
+        return;
+    }
+
+    byContent.remove(qHash(it->text), id);
+    byCount.erase({it->count, id});
+    usedBytes -= entryCost(it->text);
+    entries.erase(it);
+}
+
+void ResponseStore::evictOverflow(quint32 keep)
+{
+    // Least frequent first; the entry just stored is never its own victim
+    auto victim = byCount.begin();
+    while (usedBytes > maxBytes && victim != byCount.end()) {
+        if (victim->second == keep) {
+            ++victim;
+            continue;
+        }
+        const quint32 id = victim->second;
+        ++victim;
+        remove(id);
+        if (index) {
+            index->removeDocument(id);
+        }
+        evictions++;
+    }
+}
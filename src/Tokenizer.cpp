@@ -0,0 +1,351 @@
+#include "Tokenizer.h"
+
+#include <QtCore/QChar>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define TOKENIZER_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+struct CodePoint {
+    char32_t value;
+    int units;
+};
+
+inline CodePoint readCodePoint(const char16_t *src, qsizetype i, qsizetype length)
+{
+    const char16_t unit = src[i];
+    if (QChar::isHighSurrogate(unit) && i + 1 < length && QChar::isLowSurrogate(src[i + 1])) {
+        return {QChar::surrogateToUcs4(unit, src[i + 1]), 2};
+    }
+    return {unit, 1};
+}
+
+inline void writeCodePoint(char16_t *dst, char32_t ucs4)
+{
+    if (QChar::requiresSurrogates(ucs4)) {
+        dst[0] = QChar::highSurrogate(ucs4);
+        dst[1] = QChar::lowSurrogate(ucs4);
+    } else {
+        dst[0] = static_cast<char16_t>(ucs4);
+    }
+}
+
+inline char16_t asciiLower(char32_t c)
+{
+    return static_cast<char16_t>((c >= 'A' && c <= 'Z') ? c + 0x20 : c);
+}
+
+inline bool isAsciiWord(char16_t lowered)
+{
+    return (lowered >= 'a' && lowered <= 'z') || (lowered >= '0' && lowered <= '9') || lowered == '_';
+}
+
+inline bool isAsciiSpace(char16_t c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool isCombiningMark(char32_t ucs4)
+{
+    const QChar::Category category = QChar::category(ucs4);
+    return category == QChar::Mark_NonSpacing
+        || category == QChar::Mark_SpacingCombining
+        || category == QChar::Mark_Enclosing;
+}
+
+#ifdef TOKENIZER_HAS_SSE2
+const qsizetype BlockSize = 8;
+
+inline __m128i loadBlock(const char16_t *src)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+}
+
+inline void storeBlock(char16_t *dst, __m128i block)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), block);
+}
+
+inline bool isAsciiBlock(__m128i block)
+{
+    const __m128i high = _mm_and_si128(block, _mm_set1_epi16(static_cast<short>(0xFF80)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) == 0xFFFF;
+}
+
+inline __m128i inRange(__m128i block, char low, char high)
+{
+    return _mm_and_si128(_mm_cmpgt_epi16(block, _mm_set1_epi16(low - 1)),
+                         _mm_cmplt_epi16(block, _mm_set1_epi16(high + 1)));
+}
+
+// Only valid for ASCII blocks (all lanes < 0x80)
+inline __m128i lowerAsciiBlock(__m128i block)
+{
+    return _mm_add_epi16(block, _mm_and_si128(inRange(block, 'A', 'Z'), _mm_set1_epi16(0x20)));
+}
+
+// Bit j is set when lane j of a lowered ASCII block is a word character
+inline unsigned wordMask(__m128i lowered)
+{
+    const __m128i word = _mm_or_si128(_mm_or_si128(inRange(lowered, 'a', 'z'), inRange(lowered, '0', '9')),
+                                      _mm_cmpeq_epi16(lowered, _mm_set1_epi16('_')));
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_packs_epi16(word, _mm_setzero_si128()))) & 0xFFu;
+}
+#endif
+
+// Returns false when the input contains combining marks and may need NFC
+bool scanTokens(QStringView input, QString &text, QVector<TokenSpan> &spans)
+{
+    const qsizetype length = input.size();
+    text = QString(length, Qt::Uninitialized);
+    spans.clear();
+    spans.reserve(static_cast<int>(length / 5 + 1));
+
+    const char16_t *src = input.utf16();
+    char16_t *dst = reinterpret_cast<char16_t *>(text.data());
+    qsizetype tokenStart = -1;
+    bool composed = true;
+
+    auto boundary = [&](bool word, qsizetype position) {
+        if (word) {
+            if (tokenStart < 0) {
+                tokenStart = position;
+            }
+        } else if (tokenStart >= 0) {
+            spans.append({static_cast<int>(tokenStart), static_cast<int>(position - tokenStart)});
+            tokenStart = -1;
+        }
+    };
+
+    qsizetype i = 0;
+    while (i < length) {
+#ifdef TOKENIZER_HAS_SSE2
+        if (i + BlockSize <= length) {
+            const __m128i block = loadBlock(src + i);
+            if (isAsciiBlock(block)) {
+                const __m128i lowered = lowerAsciiBlock(block);
+                storeBlock(dst + i, lowered);
+
+                const unsigned mask = wordMask(lowered);
+                if (mask == 0xFFu) {
+                    boundary(true, i);
+                } else if (mask == 0u) {
+                    boundary(false, i);
+                } else {
+                    for (qsizetype j = 0; j < BlockSize; ++j) {
+                        boundary((mask >> j) & 1u, i + j);
+                    }
+                }
+                i += BlockSize;
+                continue;
+            }
+        }
+        const qsizetype blockEnd = qMin(i + BlockSize, length);
+#else
+        const qsizetype blockEnd = i + 1;
+#endif
+        // Scalar path for mixed blocks and the tail
+        while (i < blockEnd) {
+            const CodePoint cp = readCodePoint(src, i, length);
+            bool word;
+            if (cp.value < 0x80) {
+                dst[i] = asciiLower(cp.value);
+                word = isAsciiWord(dst[i]);
+            } else {
+                writeCodePoint(dst + i, QChar::toLower(cp.value));
+                const bool mark = isCombiningMark(cp.value);
+                composed = composed && !mark;
+                word = mark || QChar::isLetterOrNumber(cp.value);
+            }
+            boundary(word, i);
+            i += cp.units;
+        }
+    }
+    boundary(false, length);
+
+    return composed;
+}
+
+bool scanNormalized(QStringView input, QString &out)
+{
+    const qsizetype length = input.size();
+    out = QString(length, Qt::Uninitialized);
+
+    const char16_t *src = input.utf16();
+    char16_t *dst = reinterpret_cast<char16_t *>(out.data());
+    qsizetype written = 0;
+    bool pendingSpace = false;
+    bool composed = true;
+
+    // Kept characters are never longer than their source, so out never grows
+    auto keep = [&]() {
+        if (pendingSpace && written > 0) {
+            dst[written++] = u' ';
+        }
+        pendingSpace = false;
+    };
+
+    qsizetype i = 0;
+    while (i < length) {
+#ifdef TOKENIZER_HAS_SSE2
+        if (i + BlockSize <= length) {
+            const __m128i block = loadBlock(src + i);
+            if (isAsciiBlock(block)) {
+                const __m128i lowered = lowerAsciiBlock(block);
+                if (wordMask(lowered) == 0xFFu) {
+                    keep();
+                    storeBlock(dst + written, lowered);
+                    written += BlockSize;
+                    i += BlockSize;
+                    continue;
+                }
+            }
+        }
+        const qsizetype blockEnd = qMin(i + BlockSize, length);
+#else
+        const qsizetype blockEnd = i + 1;
+#endif
+        while (i < blockEnd) {
+            const CodePoint cp = readCodePoint(src, i, length);
+            if (cp.value < 0x80) {
+                const char16_t lowered = asciiLower(cp.value);
+                if (isAsciiWord(lowered) || lowered == '?' || lowered == '!' || lowered == '.') {
+                    keep();
+                    dst[written++] = lowered;
+                } else if (isAsciiSpace(lowered)) {
+                    pendingSpace = true;
+                }
+            } else {
+                const bool mark = isCombiningMark(cp.value);
+                composed = composed && !mark;
+                if (mark || QChar::isLetterOrNumber(cp.value)) {
+                    keep();
+                    writeCodePoint(dst + written, QChar::toLower(cp.value));
+                    written += cp.units;
+                } else if (QChar::isSpace(cp.value)) {
+                    pendingSpace = true;
+                }
+            }
+            i += cp.units;
+        }
+    }
+
+    out.resize(written);
+    return composed;
+}
+
+} // namespace
+
+bool TokenList::contains(QStringView token) const
+{
+    for (int i = 0; i < spans.size(); ++i) {
+        if (at(i) == token) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList TokenList::toStringList() const
+{
+    QStringList tokens;
+    tokens.reserve(spans.size());
+    for (int i = 0; i < spans.size(); ++i) {
+        tokens.append(at(i).toString());
+    }
+    return tokens;
+}
+
+TokenList Tokenizer::tokenize(QStringView input)
+{
+    TokenList result;
+    if (!scanTokens(input, result.text, result.spans)) {
+        // Decomposed diacritics ("c" + combining caron): compose and rescan
+        const QString composed = input.toString().normalized(QString::NormalizationForm_C);
+        if (QStringView(composed) != input) {
+            scanTokens(composed, result.text, result.spans);
+        }
+    }
+    return result;
+}
+
+QString Tokenizer::normalize(QStringView input)
+{
+    QString result;
+    if (!scanNormalized(input, result)) {
+        const QString composed = input.toString().normalized(QString::NormalizationForm_C);
+        if (QStringView(composed) != input) {
+            scanNormalized(composed, result);
+        }
+    }
+    return result;
+}
+
+QString Tokenizer::toLower(QStringView input)
+{
+    const qsizetype length = input.size();
+    QString result(length, Qt::Uninitialized);
+
+    const char16_t *src = input.utf16();
+    char16_t *dst = reinterpret_cast<char16_t *>(result.data());
+
+    qsizetype i = 0;
+    while (i < length) {
+#ifdef TOKENIZER_HAS_SSE2
+        if (i + BlockSize <= length) {
+            const __m128i block = loadBlock(src + i);
+            if (isAsciiBlock(block)) {
+                storeBlock(dst + i, lowerAsciiBlock(block));
+                i += BlockSize;
+                continue;
+            }
+        }
+#endif
+        const CodePoint cp = readCodePoint(src, i, length);
+        if (cp.value < 0x80) {
+            dst[i] = asciiLower(cp.value);
+        } else {
+            writeCodePoint(dst + i, QChar::toLower(cp.value));
+        }
+        i += cp.units;
+    }
+
+    return result;
+}
+
+QString Tokenizer::fold(QStringView input)
+{
+    QString lowered = toLower(input);
+    bool ascii = true;
+    for (QChar c : std::as_const(lowered)) {
+        if (c.unicode() >= 0x80) {
+            ascii = false;
+            break;
+        }
+    }
+    if (ascii) {
+        return lowered;
+    }
+
+    // Decompose, then drop the combining marks ("č" -> "c" + caron -> "c")
+    const QString decomposed = lowered.normalized(QString::NormalizationForm_D);
+    QString result;
+    result.reserve(decomposed.size());
+    for (QChar c : decomposed) {
+        if (!isCombiningMark(c.unicode())) {
+            result.append(c);
+        }
+    }
+    return result;
+}
+
+bool Tokenizer::isWordCharacter(char32_t ucs4)
+{
+    if (ucs4 < 0x80) {
+        return isAsciiWord(asciiLower(ucs4));
+    }
+    return QChar::isLetterOrNumber(ucs4) || isCombiningMark(ucs4);
+}